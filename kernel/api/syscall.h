@@ -27,6 +27,8 @@ extern "C" {
     struct sockaddr;
     struct siginfo;
     struct stat;
+    struct iovec;
+    struct epoll_event;
     typedef u32 socklen_t;
 }
 
@@ -180,7 +182,19 @@ namespace Kernel {
         S(set_process_name)       \
         S(disown)                 \
         S(adjtime)                \
-        S(allocate_tls)
+        S(allocate_tls)           \
+        S(profiling_set_frequency) \
+        S(readv)                  \
+        S(pread)                  \
+        S(pwrite)                 \
+        S(preadv)                 \
+        S(pwritev)                \
+        S(epoll_create)           \
+        S(epoll_ctl)              \
+        S(epoll_wait)             \
+        S(sendfile)               \
+        S(splice)                 \
+        S(profiling_read)
 
     namespace Syscall {
 
@@ -306,7 +320,12 @@ namespace Kernel {
             const i32* userspace_address;
             int futex_op;
             i32 val;
-            const timespec* timeout;
+            union {
+                const timespec* timeout;
+                u32 val2;
+            };
+            const i32* userspace_address2;
+            i32 val3;
         };
 
         struct SC_setkeymap_params {
@@ -417,6 +436,56 @@ namespace Kernel {
             u32* out_data;
         };
 
+        struct SC_pread_params {
+            int fd;
+            MutableBufferArgument<u8, size_t> buffer;
+            off_t offset;
+        };
+
+        struct SC_pwrite_params {
+            int fd;
+            ImmutableBufferArgument<u8, size_t> buffer;
+            off_t offset;
+        };
+
+        /// @brief for both preadv and pwritev
+        struct SC_preadv_params {
+            int fd;
+            const struct iovec* iov;
+            int iov_count;
+            off_t offset;
+        };
+
+        struct SC_epoll_ctl_params {
+            int epfd;
+            int op;
+            int fd;
+            const struct epoll_event* event;
+        };
+
+        struct SC_epoll_wait_params {
+            int epfd;
+            struct epoll_event* events;
+            int max_events;
+            const struct timespec* timeout;
+        };
+
+        struct SC_sendfile_params {
+            int out_fd;
+            int in_fd;
+            off_t* offset;
+            size_t count;
+        };
+
+        struct SC_splice_params {
+            int fd_in;
+            off_t* off_in;
+            int fd_out;
+            off_t* off_out;
+            size_t length;
+            unsigned flags;
+        };
+
         void initialize();
         int sync();
 
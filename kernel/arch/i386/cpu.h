@@ -16,6 +16,7 @@
 #include <mods/noncopyable.h>
 #include <mods/vector.h>
 #include <mods/iterdecision.h>
+#include <kernel/heap/slaballocator.h>
 #include <kernel/physical_address.h>
 #include <kernel/virtual_address.h>
 
@@ -1132,6 +1133,7 @@ namespace Kernel {
     class ProcessorInfo;
     class SchedulerPerProcessorData;
     struct MemoryManagerData;
+    struct TimerQueuePerProcessorData;
     struct ProcessorMessageEntry;
 
     struct ProcessorMessage {
@@ -1207,6 +1209,8 @@ namespace Kernel {
 
         ProcessorInfo* m_info;
         MemoryManagerData* m_mm_data;
+        SlabAllocatorPerProcessorData m_slab_data;
+        TimerQueuePerProcessorData* m_timer_queue_data { nullptr };
         SchedulerPerProcessorData* m_scheduler_data;
         Thread* m_current_thread;
         Thread* m_idle_thread;
@@ -1400,6 +1404,28 @@ namespace Kernel {
             return *m_mm_data;
         }
 
+        /**
+         * @return ALWAYS_INLINE& 
+         */
+        ALWAYS_INLINE SlabAllocatorPerProcessorData& get_slab_data() {
+            return m_slab_data;
+        }
+
+        /**
+         * @param timer_queue_data 
+         * @return ALWAYS_INLINE 
+         */
+        ALWAYS_INLINE void set_timer_queue_data(TimerQueuePerProcessorData& timer_queue_data) {
+            m_timer_queue_data = &timer_queue_data;
+        }
+
+        /**
+         * @return ALWAYS_INLINE* 
+         */
+        ALWAYS_INLINE TimerQueuePerProcessorData* get_timer_queue_data() const {
+            return m_timer_queue_data;
+        }
+
         /**
          * @return ALWAYS_INLINE* 
          */
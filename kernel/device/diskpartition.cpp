@@ -10,6 +10,7 @@
  */
 
 #include <kernel/device/diskpartition.h>
+#include <kernel/device/ioscheduler.h>
 #include <kernel/filesystem/filedescription.h>
 
 namespace Kernel 
@@ -34,6 +35,7 @@ namespace Kernel
     DiskPartition::DiskPartition(BlockDevice& device, unsigned block_offset, unsigned block_limit)
         : BlockDevice(100, 0, device.block_size())
         , m_device(device)
+        , m_scheduler(IOScheduler::for_device(device))
         , m_block_offset(block_offset)
         , m_block_limit(block_limit)
     {
@@ -48,8 +50,31 @@ namespace Kernel
      */
     void DiskPartition::start_request(AsyncBlockDeviceRequest& request)
     {
-        request.add_sub_request(m_device->make_request<AsyncBlockDeviceRequest>(request.request_type(),
-            request.block_index() + m_block_offset, request.block_count(), request.buffer(), request.buffer_size()));
+        m_scheduler.submit(request, m_block_offset);
+    }
+
+    /**
+     * @param offset
+     * @param length
+     * @return true
+     * @return false
+     */
+    bool DiskPartition::is_block_aligned(size_t offset, size_t length) const
+    {
+        return length > 0 && offset % block_size() == 0 && length % block_size() == 0;
+    }
+
+    /**
+     * @param offset
+     * @param length
+     * @return size_t
+     */
+    size_t DiskPartition::clip_to_partition(size_t offset, size_t length) const
+    {
+        u64 partition_size = (u64)(m_block_limit - m_block_offset) * block_size();
+        if (offset >= partition_size)
+            return 0;
+        return min<u64>(length, partition_size - offset);
     }
 
     /**
@@ -67,6 +92,16 @@ namespace Kernel
         klog() << "DiskPartition::read offset=" << fd.offset() << " adjust=" << adjust << " len=" << len;
     #endif
 
+        len = clip_to_partition(offset, len);
+        if (!len)
+            return 0;
+
+        if (is_block_aligned(offset, len)) {
+            if (!m_scheduler.submit_and_wait(AsyncBlockDeviceRequest::Read, (offset + adjust) / block_size(), len / block_size(), outbuf))
+                return KResult(-EIO);
+            return len;
+        }
+
         return m_device->read(fd, offset + adjust, outbuf, len);
     }
 
@@ -102,6 +137,16 @@ namespace Kernel
         klog() << "DiskPartition::write offset=" << offset << " adjust=" << adjust << " len=" << len;
     #endif
 
+        len = clip_to_partition(offset, len);
+        if (!len)
+            return 0;
+
+        if (is_block_aligned(offset, len)) {
+            if (!m_scheduler.submit_and_wait(AsyncBlockDeviceRequest::Write, (offset + adjust) / block_size(), len / block_size(), inbuf))
+                return KResult(-EIO);
+            return len;
+        }
+
         return m_device->write(fd, offset + adjust, inbuf, len);
     }
 
@@ -18,6 +18,8 @@
 namespace Kernel 
 {
 
+    class IOScheduler;
+
     class DiskPartition final : public BlockDevice 
     {
     public:
@@ -70,7 +72,28 @@ namespace Kernel
          */
         DiskPartition(BlockDevice&, unsigned block_offset, unsigned block_limit);
 
+        /**
+         * @brief whole blocks go through the disk's scheduler, anything else straight to the disk
+         *
+         * @param offset
+         * @param length
+         * @return true
+         * @return false
+         */
+        bool is_block_aligned(size_t offset, size_t length) const;
+
+        /**
+         * @brief length cut down so the access ends at the partition's last block, which
+         *        m_block_limit places on the disk. 0 once offset is past it
+         *
+         * @param offset
+         * @param length
+         * @return size_t
+         */
+        size_t clip_to_partition(size_t offset, size_t length) const;
+
         NonnullRefPtr<BlockDevice> m_device;
+        IOScheduler& m_scheduler;
 
         unsigned m_block_offset;
         unsigned m_block_limit;
@@ -0,0 +1,455 @@
+/**
+ * @file ioscheduler.cpp
+ * @author Krisna Pranav
+ * @brief io scheduler
+ * @version 6.0
+ * @date 2023-09-20
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <mods/jsonarrayserializer.h>
+#include <mods/jsonobjectserialize.h>
+#include <mods/quicksort.h>
+#include <kernel/commandline.h>
+#include <kernel/device/ioscheduler.h>
+#include <kernel/kbufferbuilder.h>
+#include <kernel/lock.h>
+#include <kernel/process.h>
+#include <kernel/time/timemanagement.h>
+#include <kernel/vm/processpagingscope.h>
+
+namespace Kernel
+{
+
+    RecursiveSpinLock IOScheduler::s_all_schedulers_lock;
+    IOScheduler* IOScheduler::s_all_schedulers;
+
+    static Lock s_scheduler_creation_lock { "IOSchedulerCreation" };
+
+    /**
+     * @param a
+     * @param b
+     * @return true
+     * @return false
+     */
+    static bool ranges_overlap(const IOSchedulerRequest& a, const IOSchedulerRequest& b)
+    {
+        return a.block_index < b.block_index + b.block_count && b.block_index < a.block_index + a.block_count;
+    }
+
+    /**
+     * @param queue
+     * @param head_position
+     * @param now_ms
+     * @return size_t
+     */
+    size_t DeadlineIOSchedulerPolicy::select(const IOSchedulerQueue& queue, u32 head_position, u64 now_ms)
+    {
+        // the queue is in submission order, so the first expired request is also the oldest one
+        bool have_reads = false;
+        bool have_writes = false;
+        for (size_t i = 0; i < queue.size(); ++i) {
+            if (queue[i]->deadline_ms <= now_ms)
+                return i;
+            if (queue[i]->type == AsyncBlockDeviceRequest::Read)
+                have_reads = true;
+            else
+                have_writes = true;
+        }
+
+        auto type = AsyncBlockDeviceRequest::Read;
+        if (!have_reads || (have_writes && m_writes_starved >= max_writes_starved))
+            type = AsyncBlockDeviceRequest::Write;
+        m_writes_starved = (type == AsyncBlockDeviceRequest::Read && have_writes) ? m_writes_starved + 1 : 0;
+
+        Optional<size_t> next_ahead;
+        Optional<size_t> lowest;
+        for (size_t i = 0; i < queue.size(); ++i) {
+            auto& request = *queue[i];
+            if (request.type != type)
+                continue;
+            if (!lowest.has_value() || request.block_index < queue[lowest.value()]->block_index)
+                lowest = i;
+            if (request.block_index >= head_position
+                && (!next_ahead.has_value() || request.block_index < queue[next_ahead.value()]->block_index))
+                next_ahead = i;
+        }
+
+        return next_ahead.has_value() ? next_ahead.value() : lowest.value();
+    }
+
+    /**
+     * @param device
+     * @return IOScheduler&
+     */
+    IOScheduler& IOScheduler::for_device(BlockDevice& device)
+    {
+        LOCKER(s_scheduler_creation_lock);
+
+        IOScheduler* found = nullptr;
+        for_each([&](IOScheduler& scheduler) {
+            if (&scheduler.m_device == &device)
+                found = &scheduler;
+        });
+        if (found)
+            return *found;
+
+        OwnPtr<IOSchedulerPolicy> policy;
+        auto policy_name = kernel_command_line().lookup("io_scheduler");
+        if (policy_name.has_value() && policy_name.value() == "fifo")
+            policy = make<FIFOIOSchedulerPolicy>();
+        else
+            policy = make<DeadlineIOSchedulerPolicy>();
+
+        // schedulers live as long as the disks they drive, which is forever
+        auto* scheduler = new IOScheduler(device, policy.release_nonnull());
+
+        ScopedSpinLock lock(s_all_schedulers_lock);
+        scheduler->m_next_scheduler = s_all_schedulers;
+        if (s_all_schedulers)
+            s_all_schedulers->m_prev_scheduler = scheduler;
+        s_all_schedulers = scheduler;
+        return *scheduler;
+    }
+
+    /**
+     * @param device
+     * @param policy
+     */
+    IOScheduler::IOScheduler(BlockDevice& device, NonnullOwnPtr<IOSchedulerPolicy> policy)
+        : m_device(device)
+        , m_policy(move(policy))
+    {
+        Process::create_kernel_process(m_dispatcher, String::format("IOScheduler %u,%u", device.major(), device.minor()), [this] {
+            run();
+        });
+    }
+
+    /**
+     * @param request
+     * @param block_offset
+     */
+    void IOScheduler::submit(AsyncBlockDeviceRequest& request, u32 block_offset)
+    {
+        auto scheduler_request = adopt(*new IOSchedulerRequest(request.request_type(), request.block_index() + block_offset, request.block_count(), request.buffer()));
+        scheduler_request->async_request = request;
+        enqueue(move(scheduler_request));
+    }
+
+    /**
+     * @param type
+     * @param block_index
+     * @param block_count
+     * @param buffer
+     * @return true
+     * @return false
+     */
+    bool IOScheduler::submit_and_wait(IOSchedulerRequest::RequestType type, u32 block_index, u32 block_count, const UserOrKernelBuffer& buffer)
+    {
+        auto request = adopt(*new IOSchedulerRequest(type, block_index, block_count, buffer));
+        request->process = Process::current();
+        enqueue(request);
+
+        // complete() wakes us even if it runs before we get to wait, the wait queue remembers it
+        while (!request->completed)
+            (void)request->wait_queue.wait_on({}, "IOScheduler");
+
+        return request->result == AsyncDeviceRequest::Success;
+    }
+
+    /**
+     * @param request
+     */
+    void IOScheduler::enqueue(NonnullRefPtr<IOSchedulerRequest> request)
+    {
+        u64 now = TimeManagement::the().uptime_ms();
+        request->submitted_at_ms = now;
+        request->deadline_ms = now + (request->type == AsyncBlockDeviceRequest::Read ? read_expire_ms : write_expire_ms);
+
+        ScopedSpinLock lock(m_lock);
+        if (!request->async_request)
+            m_waiters++;
+        m_queue.append(move(request));
+        m_statistics.submitted++;
+        if (queue_depth() > m_statistics.max_queue_depth)
+            m_statistics.max_queue_depth = queue_depth();
+
+        if (should_dispatch())
+            m_dispatch_queue.wake_one();
+    }
+
+    void IOScheduler::plug()
+    {
+        ScopedSpinLock lock(m_lock);
+        m_plug_count++;
+        m_statistics.plugs++;
+    }
+
+    void IOScheduler::unplug()
+    {
+        ScopedSpinLock lock(m_lock);
+        ASSERT(m_plug_count > 0);
+        if (--m_plug_count == 0 && !m_queue.is_empty())
+            m_dispatch_queue.wake_one();
+    }
+
+    /**
+     * @brief somebody sleeping on a request would keep the queue plugged for good if its own
+     *        plug was holding that request back, so waiters always unplug
+     *
+     * @return true
+     * @return false
+     */
+    bool IOScheduler::should_dispatch() const
+    {
+        ASSERT(m_lock.is_locked());
+        if (m_queue.is_empty())
+            return false;
+        return m_plug_count == 0 || m_waiters > 0 || m_queue.size() >= unplug_threshold;
+    }
+
+    /**
+     * @return IOSchedulerQueue
+     */
+    IOSchedulerQueue IOScheduler::take_batch()
+    {
+        ASSERT(m_lock.is_locked());
+
+        // a request may not overtake an older one touching the same blocks, or a read could miss a queued write
+        auto earliest_conflict = [&](size_t index) {
+            for (size_t i = 0; i < index; ++i) {
+                if (ranges_overlap(*m_queue[i], *m_queue[index]))
+                    return i;
+            }
+            return index;
+        };
+
+        size_t index = m_policy->select(m_queue, m_head_position, TimeManagement::the().uptime_ms());
+        for (size_t conflict = earliest_conflict(index); conflict != index; conflict = earliest_conflict(index))
+            index = conflict;
+
+        IOSchedulerQueue batch;
+        batch.append(m_queue.take(index));
+
+        auto type = batch[0]->type;
+        u32 first_block = batch[0]->block_index;
+        u32 end_block = first_block + batch[0]->block_count;
+
+        for (bool merged = true; merged;) {
+            merged = false;
+            for (size_t i = 0; i < m_queue.size(); ++i) {
+                auto& candidate = *m_queue[i];
+                if (candidate.type != type || end_block - first_block + candidate.block_count > max_merge_blocks)
+                    continue;
+                if (candidate.block_index != end_block && candidate.block_index + candidate.block_count != first_block)
+                    continue;
+                if (earliest_conflict(i) != i)
+                    continue;
+
+                if (candidate.block_index == end_block)
+                    end_block += candidate.block_count;
+                else
+                    first_block = candidate.block_index;
+                batch.append(m_queue.take(i));
+                merged = true;
+                break;
+            }
+        }
+
+        quick_sort(batch, [](auto& a, auto& b) {
+            return a->block_index < b->block_index;
+        });
+
+        m_head_position = end_block;
+        m_in_flight += batch.size();
+        m_statistics.dispatched_batches++;
+        m_statistics.merged_requests += batch.size() - 1;
+        return batch;
+    }
+
+    /**
+     * @param request
+     * @param dest
+     * @param length
+     * @return true
+     * @return false
+     */
+    static bool read_request_buffer(IOSchedulerRequest& request, u8* dest, size_t length)
+    {
+        if (request.async_request)
+            return request.async_request->read_from_buffer(request.buffer, dest, length);
+        if (request.buffer.is_kernel_buffer())
+            return request.buffer.read(dest, length);
+
+        ProcessPagingScope paging_scope(*request.process);
+        return request.buffer.read(dest, length);
+    }
+
+    /**
+     * @param request
+     * @param src
+     * @param length
+     * @return true
+     * @return false
+     */
+    static bool write_request_buffer(IOSchedulerRequest& request, const u8* src, size_t length)
+    {
+        if (request.async_request)
+            return request.async_request->write_to_buffer(request.buffer, src, length);
+        if (request.buffer.is_kernel_buffer())
+            return request.buffer.write(src, length);
+
+        ProcessPagingScope paging_scope(*request.process);
+        return request.buffer.write(src, length);
+    }
+
+    /**
+     * @brief a single request for kernel memory goes to the device as it is, anything else is
+     *        staged through one kernel buffer, the device request runs in our address space
+     *
+     * @param batch
+     */
+    void IOScheduler::dispatch(IOSchedulerQueue& batch)
+    {
+        auto type = batch.first()->type;
+        u32 first_block = batch.first()->block_index;
+        u32 block_count = batch.last()->block_index + batch.last()->block_count - first_block;
+        size_t block_size = m_device.block_size();
+        size_t size = block_count * block_size;
+
+        bool bounce = batch.size() > 1 || !batch.first()->buffer.is_kernel_buffer();
+        Optional<KBuffer> staging;
+        auto target = batch.first()->buffer;
+        if (bounce) {
+            staging = KBuffer::create_with_size(size, Region::Access::Read | Region::Access::Write, "IOScheduler staging");
+            target = UserOrKernelBuffer::for_kernel_buffer(staging.value().data());
+            ScopedSpinLock lock(m_lock);
+            m_statistics.bounced_batches++;
+        }
+
+        auto result = AsyncDeviceRequest::Success;
+        if (bounce && type == AsyncBlockDeviceRequest::Write) {
+            for (auto& request : batch) {
+                u8* data = staging.value().data() + (request->block_index - first_block) * block_size;
+                if (!read_request_buffer(*request, data, request->block_count * block_size))
+                    result = AsyncDeviceRequest::MemoryFault;
+            }
+        }
+
+        if (result == AsyncDeviceRequest::Success) {
+            auto device_request = m_device.make_request<AsyncBlockDeviceRequest>(type, first_block, block_count, target, size);
+            auto wait_result = device_request->wait();
+            if (wait_result.wait_result().was_interrupted())
+                result = AsyncDeviceRequest::Failure;
+            else
+                result = wait_result.request_result();
+        }
+
+        if (result != AsyncDeviceRequest::Success) {
+            ScopedSpinLock lock(m_lock);
+            m_statistics.failed_batches++;
+        }
+
+        for (auto& request : batch) {
+            auto request_result = result;
+            if (bounce && type == AsyncBlockDeviceRequest::Read && result == AsyncDeviceRequest::Success) {
+                const u8* data = staging.value().data() + (request->block_index - first_block) * block_size;
+                if (!write_request_buffer(*request, data, request->block_count * block_size))
+                    request_result = AsyncDeviceRequest::MemoryFault;
+            }
+            complete(*request, request_result);
+        }
+    }
+
+    /**
+     * @param request
+     * @param result
+     */
+    void IOScheduler::complete(IOSchedulerRequest& request, AsyncDeviceRequest::RequestResult result)
+    {
+        {
+            ScopedSpinLock lock(m_lock);
+            u64 latency = TimeManagement::the().uptime_ms() - request.submitted_at_ms;
+            size_t bucket = 0;
+            while (bucket + 1 < IOSchedulerStatistics::latency_bucket_count && latency >= (1ull << bucket))
+                ++bucket;
+            if (request.type == AsyncBlockDeviceRequest::Read)
+                m_statistics.read_latency[bucket]++;
+            else
+                m_statistics.write_latency[bucket]++;
+
+            m_in_flight--;
+            if (!request.async_request) {
+                m_waiters--;
+                request.result = result;
+                request.completed = true;
+            }
+        }
+
+        if (request.async_request)
+            request.async_request->complete(result);
+        else
+            request.wait_queue.wake_one();
+    }
+
+    void IOScheduler::run()
+    {
+        for (;;) {
+            IOSchedulerQueue batch;
+            {
+                ScopedSpinLock lock(m_lock);
+                if (should_dispatch())
+                    batch = take_batch();
+            }
+
+            if (batch.is_empty()) {
+                (void)m_dispatch_queue.wait_on({}, "IOScheduler");
+                continue;
+            }
+
+            dispatch(batch);
+        }
+    }
+
+    /**
+     * @return Optional<KBuffer>
+     */
+    Optional<KBuffer> procfs$iosched(InodeIdentifier)
+    {
+        KBufferBuilder builder;
+        JsonArraySerializer array { builder };
+
+        IOScheduler::for_each([&](const IOScheduler& scheduler) {
+            auto& statistics = scheduler.statistics();
+
+            auto obj = array.add_object();
+            obj.add("major", scheduler.device().major());
+            obj.add("minor", scheduler.device().minor());
+            obj.add("policy", scheduler.policy_name());
+            obj.add("queue_depth", scheduler.queue_depth());
+            obj.add("max_queue_depth", statistics.max_queue_depth);
+            obj.add("submitted", statistics.submitted);
+            obj.add("dispatched_batches", statistics.dispatched_batches);
+            obj.add("merged_requests", statistics.merged_requests);
+            obj.add("bounced_batches", statistics.bounced_batches);
+            obj.add("failed_batches", statistics.failed_batches);
+            obj.add("plugs", statistics.plugs);
+
+            auto read_latency = obj.add_array("read_latency_ms_log2");
+            for (auto count : statistics.read_latency)
+                read_latency.add(count);
+            read_latency.finish();
+
+            auto write_latency = obj.add_array("write_latency_ms_log2");
+            for (auto count : statistics.write_latency)
+                write_latency.add(count);
+            write_latency.finish();
+        });
+
+        array.finish();
+        return builder.build();
+    }
+
+} // namespace Kernel
@@ -0,0 +1,317 @@
+/**
+ * @file ioscheduler.h
+ * @author Krisna Pranav
+ * @brief io scheduler
+ * @version 6.0
+ * @date 2023-09-20
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#pragma once
+
+#include <mods/nonnullrefptr.h>
+#include <mods/ownptr.h>
+#include <mods/refcounted.h>
+#include <mods/refptr.h>
+#include <mods/vector.h>
+#include <kernel/device/blockdevice.h>
+#include <kernel/kbuffer.h>
+#include <kernel/spinlock.h>
+#include <kernel/waitqueue.h>
+
+namespace Kernel
+{
+
+    class IOSchedulerRequest : public RefCounted<IOSchedulerRequest>
+    {
+    public:
+        using RequestType = AsyncBlockDeviceRequest::RequestType;
+
+        /**
+         * @param type
+         * @param block_index on the scheduler's device, partition offset already applied
+         * @param block_count
+         * @param buffer
+         */
+        IOSchedulerRequest(RequestType type, u32 block_index, u32 block_count, const UserOrKernelBuffer& buffer)
+            : type(type)
+            , block_index(block_index)
+            , block_count(block_count)
+            , buffer(buffer)
+        { }
+
+        RequestType type;
+        u32 block_index;
+        u32 block_count;
+        UserOrKernelBuffer buffer;
+
+        /// @brief completed instead of waking a waiter when the request came in through start_request
+        RefPtr<AsyncBlockDeviceRequest> async_request;
+
+        /// @brief whose address space buffer lives in, for requests that have a waiter
+        RefPtr<Process> process;
+
+        u64 submitted_at_ms { 0 };
+        u64 deadline_ms { 0 };
+
+        bool completed { false };
+        AsyncDeviceRequest::RequestResult result { AsyncDeviceRequest::Pending };
+        WaitQueue wait_queue;
+    }; // class IOSchedulerRequest
+
+    using IOSchedulerQueue = Vector<NonnullRefPtr<IOSchedulerRequest>>;
+
+    class IOSchedulerPolicy
+    {
+    public:
+        virtual ~IOSchedulerPolicy() { }
+
+        /**
+         * @return const char*
+         */
+        virtual const char* name() const = 0;
+
+        /**
+         * @param queue in submission order, never empty
+         * @param head_position block just past the last dispatched one
+         * @param now_ms
+         * @return size_t index of the request to build the next batch around
+         */
+        virtual size_t select(const IOSchedulerQueue& queue, u32 head_position, u64 now_ms) = 0;
+    }; // class IOSchedulerPolicy
+
+    /// @brief dispatch in submission order, merging only what happens to be adjacent
+    class FIFOIOSchedulerPolicy final : public IOSchedulerPolicy
+    {
+    public:
+        virtual const char* name() const override
+        {
+            return "fifo";
+        }
+
+        virtual size_t select(const IOSchedulerQueue&, u32, u64) override
+        {
+            return 0;
+        }
+    }; // class FIFOIOSchedulerPolicy
+
+    /**
+     * @brief one-way elevator over the block index, reads ahead of writes, but anything past
+     *        its deadline goes first so a stream of nearby requests can't starve a far one
+     */
+    class DeadlineIOSchedulerPolicy final : public IOSchedulerPolicy
+    {
+    public:
+        /// @brief reads are dispatched ahead of writes at most this many times in a row
+        static constexpr unsigned max_writes_starved = 2;
+
+        virtual const char* name() const override
+        {
+            return "deadline";
+        }
+
+        virtual size_t select(const IOSchedulerQueue&, u32 head_position, u64 now_ms) override;
+
+    private:
+        unsigned m_writes_starved { 0 };
+    }; // class DeadlineIOSchedulerPolicy
+
+    struct IOSchedulerStatistics
+    {
+        static constexpr size_t latency_bucket_count = 12;
+
+        u64 submitted { 0 };
+        u64 dispatched_batches { 0 };
+        u64 merged_requests { 0 };
+        u64 bounced_batches { 0 };
+        u64 failed_batches { 0 };
+        u64 plugs { 0 };
+        size_t max_queue_depth { 0 };
+
+        /// @brief bucket i counts requests that completed in under 2^i ms, the last one everything slower
+        u64 read_latency[latency_bucket_count] {};
+        u64 write_latency[latency_bucket_count] {};
+    }; // struct IOSchedulerStatistics
+
+    /**
+     * @brief sits between the partitions of a disk and the disk itself. Requests are queued,
+     *        picked by a policy, merged with whatever is adjacent and of the same type, and
+     *        handed to the device as one request by a dispatcher thread per device
+     */
+    class IOScheduler
+    {
+        MOD_MAKE_NONCOPYABLE(IOScheduler);
+        MOD_MAKE_NONMOVABLE(IOScheduler);
+
+    public:
+        static constexpr u32 max_merge_blocks = 128;
+        static constexpr u64 read_expire_ms = 500;
+        static constexpr u64 write_expire_ms = 5000;
+
+        /// @brief a plugged queue is still dispatched once this many requests pile up
+        static constexpr size_t unplug_threshold = 32;
+
+        /**
+         * @brief io_scheduler=fifo|deadline on the kernel command line picks the policy, deadline by default
+         *
+         * @param device
+         * @return IOScheduler&
+         */
+        static IOScheduler& for_device(BlockDevice& device);
+
+        /**
+         * @tparam Callback
+         * @param callback
+         */
+        template<typename Callback>
+        static void for_each(Callback callback)
+        {
+            ScopedSpinLock lock(s_all_schedulers_lock);
+            for (auto* scheduler = s_all_schedulers; scheduler; scheduler = scheduler->m_next_scheduler)
+                callback(*scheduler);
+        }
+
+        /**
+         * @brief queue request and return, it is completed from the dispatcher thread
+         *
+         * @param request
+         * @param block_offset added to the request's block index
+         */
+        void submit(AsyncBlockDeviceRequest& request, u32 block_offset);
+
+        /**
+         * @brief queue a request and block until it has been carried out
+         *
+         * @param type
+         * @param block_index
+         * @param block_count
+         * @param buffer
+         * @return true
+         * @return false
+         */
+        bool submit_and_wait(IOSchedulerRequest::RequestType type, u32 block_index, u32 block_count, const UserOrKernelBuffer& buffer);
+
+        /// @brief hold requests back so a burst of them can be sorted and merged, plugs nest
+        void plug();
+        void unplug();
+
+        /**
+         * @return const BlockDevice&
+         */
+        const BlockDevice& device() const
+        {
+            return m_device;
+        }
+
+        /**
+         * @return const char*
+         */
+        const char* policy_name() const
+        {
+            return m_policy->name();
+        }
+
+        /**
+         * @return size_t
+         */
+        size_t queue_depth() const
+        {
+            return m_queue.size() + m_in_flight;
+        }
+
+        /**
+         * @return const IOSchedulerStatistics&
+         */
+        const IOSchedulerStatistics& statistics() const
+        {
+            return m_statistics;
+        }
+
+    private:
+        /**
+         * @param device
+         * @param policy
+         */
+        IOScheduler(BlockDevice& device, NonnullOwnPtr<IOSchedulerPolicy> policy);
+
+        /**
+         * @param request
+         */
+        void enqueue(NonnullRefPtr<IOSchedulerRequest> request);
+
+        /**
+         * @return true
+         * @return false
+         */
+        bool should_dispatch() const;
+
+        /**
+         * @brief take the policy's pick off the queue together with every request it can be merged with
+         *
+         * @return IOSchedulerQueue sorted by block index
+         */
+        IOSchedulerQueue take_batch();
+
+        /**
+         * @param batch
+         */
+        void dispatch(IOSchedulerQueue& batch);
+
+        /**
+         * @param request
+         * @param result
+         */
+        void complete(IOSchedulerRequest& request, AsyncDeviceRequest::RequestResult result);
+
+        [[noreturn]] void run();
+
+        BlockDevice& m_device;
+        NonnullOwnPtr<IOSchedulerPolicy> m_policy;
+
+        mutable SpinLock<u8> m_lock;
+        IOSchedulerQueue m_queue;
+        size_t m_in_flight { 0 };
+        size_t m_plug_count { 0 };
+        size_t m_waiters { 0 };
+        u32 m_head_position { 0 };
+        WaitQueue m_dispatch_queue;
+        RefPtr<Thread> m_dispatcher;
+
+        IOSchedulerStatistics m_statistics;
+
+        IOScheduler* m_prev_scheduler { nullptr };
+        IOScheduler* m_next_scheduler { nullptr };
+
+        static RecursiveSpinLock s_all_schedulers_lock;
+        static IOScheduler* s_all_schedulers;
+    }; // class IOScheduler
+
+    class IOPlug
+    {
+    public:
+        /**
+         * @param scheduler
+         */
+        explicit IOPlug(IOScheduler& scheduler)
+            : m_scheduler(scheduler)
+        {
+            m_scheduler.plug();
+        }
+
+        ~IOPlug()
+        {
+            m_scheduler.unplug();
+        }
+
+    private:
+        IOScheduler& m_scheduler;
+    }; // class IOPlug
+
+    /**
+     * @return Optional<KBuffer>
+     */
+    Optional<KBuffer> procfs$iosched(InodeIdentifier);
+
+} // namespace Kernel
@@ -16,14 +16,15 @@ namespace Kernel
 {
 
     /**
-     * @brief ::compute_lockfree_metadata()
+     * @brief ::compute_lockfree_metadata(), while a fill is in progress the write buffer
+     *        can neither be flipped to the readers nor written to
      */
     inline void DoubleBuffer::compute_lockfree_metadata()
     {
         InterruptDisabler disabler;
         
-        m_empty = m_read_buffer_index >= m_read_buffer->size && m_write_buffer->size == 0;
-        m_space_for_writing = m_capacity - m_write_buffer->size;
+        m_empty = m_read_buffer_index >= m_read_buffer->size && (m_write_buffer->size == 0 || m_fill_in_progress);
+        m_space_for_writing = m_fill_in_progress ? 0 : m_capacity - m_write_buffer->size;
     }
 
     /**
@@ -86,6 +87,46 @@ namespace Kernel
         return (ssize_t)bytes_to_write;
     }
 
+    /**
+     * @param size
+     * @param fill
+     * @return ssize_t
+     */
+    ssize_t DoubleBuffer::write_from(size_t size, Function<ssize_t(UserOrKernelBuffer&, size_t)> fill)
+    {
+        if (!size)
+            return 0;
+
+        Locker locker(m_lock);
+
+        size_t bytes_to_write = min(size, m_space_for_writing);
+        if (!bytes_to_write)
+            return 0;
+
+        // fill may go to disk, so it runs without m_lock. Readers keep draining the read
+        // buffer meanwhile, they just can't flip the write buffer away from under fill
+        m_fill_in_progress = true;
+        compute_lockfree_metadata();
+
+        auto buffer = UserOrKernelBuffer::for_kernel_buffer(m_write_buffer->data + m_write_buffer->size);
+        locker.unlock();
+        ssize_t nfilled = fill(buffer, bytes_to_write);
+        locker.lock();
+
+        if (nfilled > 0) {
+            ASSERT((size_t)nfilled <= bytes_to_write);
+            m_write_buffer->size += nfilled;
+        }
+
+        m_fill_in_progress = false;
+        compute_lockfree_metadata();
+
+        if (m_unblock_callback)
+            m_unblock_callback();
+
+        return nfilled;
+    }
+
     /**
      * @param data 
      * @param size 
@@ -99,7 +140,7 @@ namespace Kernel
         ASSERT(size > 0);
         LOCKER(m_lock);
         
-        if (m_read_buffer_index >= m_read_buffer->size && m_write_buffer->size != 0)
+        if (m_read_buffer_index >= m_read_buffer->size && m_write_buffer->size != 0 && !m_fill_in_progress)
             flip();
 
         if (m_read_buffer_index >= m_read_buffer->size)
@@ -11,6 +11,7 @@
 
 #pragma once 
 
+#include <mods/function.h>
 #include <mods/types.h>
 #include <kernel/lock.h>
 #include <kernel/thread.h>
@@ -59,6 +60,17 @@ namespace Kernel
             return read(buffer, size);
         }
 
+        /**
+         * @brief let fill produce up to size bytes right into the buffer instead of copying
+         *        them in from somewhere else, fill returns how many it produced or an error.
+         *        fill runs without the buffer's lock, other writers wait until it is done
+         *
+         * @param size
+         * @param fill
+         * @return ssize_t
+         */
+        [[nodiscard]] ssize_t write_from(size_t size, Function<ssize_t(UserOrKernelBuffer&, size_t)> fill);
+
         /**
          * @return true 
          * @return false 
@@ -109,6 +121,7 @@ namespace Kernel
         size_t m_space_for_writing { 0 };
 
         bool m_empty { true };
+        bool m_fill_in_progress { false };
 
         mutable Lock m_lock { "DoubleBuffer" };
 
@@ -4,10 +4,903 @@
  * @brief block file system
  * @version 6.0
  * @date 2023-08-12
- * 
+ *
  * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
- * 
+ *
  */
 
+#include <mods/hashmap.h>
 #include <mods/intrusivelist.h>
-#include <kernel/filesystem/blockfilesystem.h>
\ No newline at end of file
+#include <mods/jsonarrayserializer.h>
+#include <mods/jsonobjectserialize.h>
+#include <mods/quicksort.h>
+#include <kernel/filesystem/blockfilesystem.h>
+#include <kernel/filesystem/writeback.h>
+#include <kernel/heap/kmalloc.h>
+#include <kernel/kbuffer.h>
+#include <kernel/kbufferbuilder.h>
+#include <kernel/spinlock.h>
+#include <kernel/stdlib.h>
+
+namespace Kernel
+{
+
+    struct CacheEntry
+    {
+        enum class Queue : u8
+        {
+            Free,
+            Probation,
+            Main,
+        };
+
+        IntrusiveListNode list_node;
+        u32 block_index { 0 };
+        u8* data { nullptr };
+        Queue queue { Queue::Free };
+        bool has_data { false };
+        bool is_dirty { false };
+        bool from_read_ahead { false };
+        bool is_pinned { false };
+    }; // struct CacheEntry
+
+    struct DiskCacheStatistics
+    {
+        u64 hits { 0 };
+        u64 misses { 0 };
+        u64 ghost_hits { 0 };
+        u64 evictions { 0 };
+        u64 read_ahead_blocks { 0 };
+        u64 read_ahead_hits { 0 };
+        u64 writeback_requests { 0 };
+        u64 writeback_blocks { 0 };
+    }; // struct DiskCacheStatistics
+
+    /**
+     * @brief 2Q buffer cache: blocks seen once wait in a FIFO probation queue, and only a
+     *        block asked for again after falling out of it (remembered in the ghost queue)
+     *        makes it into the LRU main queue, so one big sequential scan can't flush out
+     *        the working set. Dirty blocks sit on their own list until they are written back.
+     */
+    class DiskCache
+    {
+    public:
+        static constexpr size_t entry_count = 10000;
+        static constexpr size_t probation_capacity = entry_count / 4;
+        static constexpr size_t ghost_capacity = entry_count / 2;
+        static constexpr size_t staging_block_count = 32;
+        static constexpr size_t initial_read_ahead_blocks = 4;
+        static constexpr size_t max_read_ahead_blocks = staging_block_count - 1;
+        static constexpr size_t read_ahead_stream_count = 8;
+
+        /// @brief the dirty count is passed on to Writeback every this many blocks, not on every write
+        static constexpr size_t writeback_report_granularity = 16;
+
+        /**
+         * @param fs
+         */
+        explicit DiskCache(BlockBasedFS& fs)
+            : m_fs(fs)
+            , m_cached_block_data(KBuffer::create_with_size(entry_count * m_fs.block_size()))
+            , m_entries(KBuffer::create_with_size(entry_count * sizeof(CacheEntry)))
+            , m_staging(KBuffer::create_with_size(staging_block_count * m_fs.block_size()))
+        {
+            for (size_t i = 0; i < entry_count; ++i) {
+                auto* entry = new (&entries()[i]) CacheEntry;
+                entry->data = m_cached_block_data.data() + i * m_fs.block_size();
+                m_free_list.append(*entry);
+            }
+
+            ScopedSpinLock lock(s_all_disk_caches_lock);
+            m_next_cache = s_all_disk_caches;
+            if (s_all_disk_caches)
+                s_all_disk_caches->m_prev_cache = this;
+            s_all_disk_caches = this;
+        }
+
+        ~DiskCache()
+        {
+            {
+                ScopedSpinLock lock(s_all_disk_caches_lock);
+                if (m_prev_cache)
+                    m_prev_cache->m_next_cache = m_next_cache;
+                else
+                    s_all_disk_caches = m_next_cache;
+                if (m_next_cache)
+                    m_next_cache->m_prev_cache = m_prev_cache;
+            }
+
+            for (size_t i = 0; i < entry_count; ++i)
+                entries()[i].~CacheEntry();
+        }
+
+        /**
+         * @param callback
+         */
+        template<typename Callback>
+        static void for_each(Callback callback)
+        {
+            ScopedSpinLock lock(s_all_disk_caches_lock);
+            for (auto* cache = s_all_disk_caches; cache; cache = cache->m_next_cache)
+                callback(*cache);
+        }
+
+        /**
+         * @return const BlockBasedFS&
+         */
+        const BlockBasedFS& fs() const
+        {
+            return m_fs;
+        }
+
+        /**
+         * @return true
+         * @return false
+         */
+        bool is_dirty() const
+        {
+            return m_dirty_count > 0;
+        }
+
+        /**
+         * @return size_t
+         */
+        size_t dirty_count() const
+        {
+            return m_dirty_count;
+        }
+
+        /**
+         * @return size_t
+         */
+        size_t cached_block_count() const
+        {
+            return m_hash.size();
+        }
+
+        /**
+         * @return const DiskCacheStatistics&
+         */
+        const DiskCacheStatistics& statistics() const
+        {
+            return m_statistics;
+        }
+
+        /**
+         * @return u8*
+         */
+        u8* staging_data()
+        {
+            return m_staging.data();
+        }
+
+        /**
+         * @param entry
+         */
+        void mark_dirty(CacheEntry& entry)
+        {
+            if (entry.is_dirty)
+                return;
+            if (entry.queue == CacheEntry::Queue::Probation)
+                m_probation_count--;
+            entry.is_dirty = true;
+            m_dirty_list.append(entry);
+            m_dirty_count++;
+        }
+
+        /**
+         * @param entry
+         */
+        void mark_clean(CacheEntry& entry)
+        {
+            if (!entry.is_dirty)
+                return;
+            entry.is_dirty = false;
+            m_dirty_count--;
+            place(entry, entry.queue);
+        }
+
+        /**
+         * @brief take a clean entry off the eviction lists, so allocations for read-ahead
+         *        cannot hand it out while its own block is still being filled
+         *
+         * @param entry
+         */
+        void pin(CacheEntry& entry)
+        {
+            ASSERT(!entry.is_pinned);
+            entry.is_pinned = true;
+            if (entry.is_dirty)
+                return;
+            if (entry.queue == CacheEntry::Queue::Probation) {
+                m_probation_list.remove(entry);
+                m_probation_count--;
+            } else {
+                ASSERT(entry.queue == CacheEntry::Queue::Main);
+                m_main_list.remove(entry);
+            }
+        }
+
+        /**
+         * @param entry
+         */
+        void unpin(CacheEntry& entry)
+        {
+            ASSERT(entry.is_pinned);
+            entry.is_pinned = false;
+            place(entry, entry.queue);
+        }
+
+        void mark_all_clean()
+        {
+            while (auto* entry = m_dirty_list.first())
+                mark_clean(*entry);
+        }
+
+        /**
+         * @param callback
+         */
+        template<typename Callback>
+        void for_each_dirty_entry(Callback callback)
+        {
+            for (auto& entry : m_dirty_list)
+                callback(entry);
+        }
+
+        /**
+         * @param block_index
+         * @return CacheEntry*
+         */
+        CacheEntry* find(u32 block_index) const
+        {
+            auto it = m_hash.find(block_index);
+            if (it == m_hash.end())
+                return nullptr;
+            ASSERT(it->value->block_index == block_index);
+            return it->value;
+        }
+
+        /**
+         * @brief the cache entry for block_index, taking a free or evicted one on a miss
+         *
+         * @param block_index
+         * @return CacheEntry&
+         */
+        CacheEntry& get(u32 block_index)
+        {
+            if (auto* entry = find(block_index)) {
+                m_statistics.hits++;
+                if (entry->from_read_ahead) {
+                    m_statistics.read_ahead_hits++;
+                    entry->from_read_ahead = false;
+                }
+                if (entry->queue == CacheEntry::Queue::Main && !entry->is_dirty)
+                    m_main_list.prepend(*entry);
+                return *entry;
+            }
+
+            m_statistics.misses++;
+            auto* entry = allocate(block_index, true);
+            ASSERT(entry);
+            return *entry;
+        }
+
+        /**
+         * @brief like get() for a block nobody asked for yet, gives up instead of flushing when
+         *        everything is dirty since the caller's read-ahead data is still in the staging buffer
+         *
+         * @param block_index
+         * @return CacheEntry*
+         */
+        CacheEntry* try_get_for_read_ahead(u32 block_index)
+        {
+            ASSERT(!find(block_index));
+            auto* entry = allocate(block_index, false);
+            if (!entry)
+                return nullptr;
+            entry->from_read_ahead = true;
+            m_statistics.read_ahead_blocks++;
+            return entry;
+        }
+
+        /**
+         * @brief pick the stream a miss at block_index continues, if any, and size its window
+         *
+         * @param block_index
+         * @return size_t blocks to read, block_index included
+         */
+        size_t read_ahead_blocks_for_miss(u32 block_index)
+        {
+            ReadAheadStream* stream = nullptr;
+            for (auto& candidate : m_streams) {
+                if (candidate.last_used && candidate.next_block == block_index) {
+                    stream = &candidate;
+                    break;
+                }
+            }
+
+            if (stream) {
+                stream->window = stream->window ? min(stream->window * 2, max_read_ahead_blocks) : initial_read_ahead_blocks;
+            } else {
+                stream = &m_streams[0];
+                for (auto& candidate : m_streams) {
+                    if (candidate.last_used < stream->last_used)
+                        stream = &candidate;
+                }
+                stream->window = 0;
+            }
+
+            stream->last_used = ++m_stream_clock;
+            stream->next_block = block_index + 1;
+            m_current_stream = stream;
+            return 1 + stream->window;
+        }
+
+        /**
+         * @param block_count
+         */
+        void did_read_blocks_for_miss(size_t block_count)
+        {
+            ASSERT(m_current_stream);
+            m_current_stream->next_block += block_count - 1;
+            m_current_stream = nullptr;
+        }
+
+        /**
+         * @param block_count
+         */
+        void did_write_back(size_t block_count)
+        {
+            m_statistics.writeback_requests++;
+            m_statistics.writeback_blocks += block_count;
+        }
+
+    private:
+        struct GhostSlot
+        {
+            u32 block_index { 0 };
+            u64 sequence { 0 };
+        }; // struct GhostSlot
+
+        struct ReadAheadStream
+        {
+            u32 next_block { 0 };
+            size_t window { 0 };
+            u64 last_used { 0 };
+        }; // struct ReadAheadStream
+
+        /**
+         * @return CacheEntry*
+         */
+        CacheEntry* entries()
+        {
+            return (CacheEntry*)m_entries.data();
+        }
+
+        /**
+         * @param entry
+         * @param queue
+         */
+        void place(CacheEntry& entry, CacheEntry::Queue queue)
+        {
+            entry.queue = queue;
+            if (entry.is_dirty)
+                return;
+            if (queue == CacheEntry::Queue::Probation) {
+                m_probation_list.prepend(entry);
+                m_probation_count++;
+            } else {
+                ASSERT(queue == CacheEntry::Queue::Main);
+                m_main_list.prepend(entry);
+            }
+        }
+
+        /**
+         * @brief probation gives up its oldest block first once it is over its share
+         *
+         * @return CacheEntry*
+         */
+        CacheEntry* evict_one()
+        {
+            CacheEntry* victim = nullptr;
+            if (m_probation_count > probation_capacity || m_main_list.is_empty())
+                victim = m_probation_list.last();
+            if (!victim)
+                victim = m_main_list.last();
+            if (!victim)
+                return nullptr;
+
+            ASSERT(!victim->is_dirty);
+            if (victim->queue == CacheEntry::Queue::Probation) {
+                m_probation_list.remove(*victim);
+                m_probation_count--;
+                remember_ghost(victim->block_index);
+            } else {
+                m_main_list.remove(*victim);
+            }
+
+            m_hash.remove(victim->block_index);
+            victim->queue = CacheEntry::Queue::Free;
+            m_statistics.evictions++;
+            return victim;
+        }
+
+        /**
+         * @param block_index
+         * @param may_flush
+         * @return CacheEntry*
+         */
+        CacheEntry* allocate(u32 block_index, bool may_flush)
+        {
+            auto* entry = m_free_list.take_first();
+            if (!entry)
+                entry = evict_one();
+            if (!entry && may_flush) {
+                // NOTE: We want to make sure we only call BlockBasedFS flush here,
+                //       not some subclass flush!
+                m_fs.flush_writes_impl();
+                entry = evict_one();
+            }
+            if (!entry)
+                return nullptr;
+
+            entry->block_index = block_index;
+            entry->has_data = false;
+            entry->from_read_ahead = false;
+
+            if (take_ghost(block_index)) {
+                m_statistics.ghost_hits++;
+                place(*entry, CacheEntry::Queue::Main);
+            } else {
+                place(*entry, CacheEntry::Queue::Probation);
+            }
+
+            m_hash.set(block_index, entry);
+            return entry;
+        }
+
+        /**
+         * @param block_index
+         */
+        void remember_ghost(u32 block_index)
+        {
+            GhostSlot slot { block_index, ++m_ghost_sequence };
+            if (m_ghost_ring.size() < ghost_capacity) {
+                m_ghost_ring.append(slot);
+            } else {
+                auto& oldest = m_ghost_ring[m_ghost_head];
+                auto it = m_ghosts.find(oldest.block_index);
+                if (it != m_ghosts.end() && it->value == oldest.sequence)
+                    m_ghosts.remove(it);
+                oldest = slot;
+                m_ghost_head = (m_ghost_head + 1) % ghost_capacity;
+            }
+            m_ghosts.set(block_index, slot.sequence);
+        }
+
+        /**
+         * @param block_index
+         * @return true
+         * @return false
+         */
+        bool take_ghost(u32 block_index)
+        {
+            return m_ghosts.remove(block_index);
+        }
+
+        BlockBasedFS& m_fs;
+
+        HashMap<u32, CacheEntry*> m_hash;
+        IntrusiveList<CacheEntry, &CacheEntry::list_node> m_free_list;
+        IntrusiveList<CacheEntry, &CacheEntry::list_node> m_probation_list;
+        IntrusiveList<CacheEntry, &CacheEntry::list_node> m_main_list;
+        IntrusiveList<CacheEntry, &CacheEntry::list_node> m_dirty_list;
+        size_t m_probation_count { 0 };
+        size_t m_dirty_count { 0 };
+
+        HashMap<u32, u64> m_ghosts;
+        Vector<GhostSlot> m_ghost_ring;
+        size_t m_ghost_head { 0 };
+        u64 m_ghost_sequence { 0 };
+
+        ReadAheadStream m_streams[read_ahead_stream_count];
+        ReadAheadStream* m_current_stream { nullptr };
+        u64 m_stream_clock { 0 };
+
+        KBuffer m_cached_block_data;
+        KBuffer m_entries;
+        KBuffer m_staging;
+
+        DiskCacheStatistics m_statistics;
+
+        DiskCache* m_prev_cache { nullptr };
+        DiskCache* m_next_cache { nullptr };
+
+        static RecursiveSpinLock s_all_disk_caches_lock;
+        static DiskCache* s_all_disk_caches;
+    }; // class DiskCache
+
+    RecursiveSpinLock DiskCache::s_all_disk_caches_lock;
+    DiskCache* DiskCache::s_all_disk_caches;
+
+    /**
+     * @param file_description
+     */
+    BlockBasedFS::BlockBasedFS(FileDescription& file_description)
+        : FileBackedFS(file_description)
+    {
+        ASSERT(file_description.file().is_seekable());
+    }
+
+    /// @brief Destroy the BlockBasedFS object
+    BlockBasedFS::~BlockBasedFS()
+    {
+    }
+
+    /**
+     * @param index
+     * @param data
+     * @param count
+     * @param offset
+     * @param allow_cache
+     * @return int
+     */
+    int BlockBasedFS::write_block(unsigned index, const UserOrKernelBuffer& data, size_t count, size_t offset, bool allow_cache)
+    {
+        ASSERT(m_logical_block_size);
+        ASSERT(offset + count <= block_size());
+        LOCKER(m_lock);
+
+        if (!allow_cache) {
+            flush_specific_block_if_needed(index);
+            u32 base_offset = static_cast<u32>(index) * static_cast<u32>(block_size()) + offset;
+            file_description().seek(base_offset, SEEK_SET);
+            auto nwritten = file_description().write(data, count);
+            if (nwritten.is_error())
+                return -EIO;
+            ASSERT(nwritten.value() == count);
+            if (auto* entry = cache().find(index))
+                entry->has_data = false;
+            return 0;
+        }
+
+        auto* entry = &cache().get(index);
+        if (count < block_size() && !entry->has_data) {
+            int error = fill_cache_for_block(index);
+            if (error < 0)
+                return error;
+            entry = cache().find(index);
+            ASSERT(entry && entry->has_data);
+        }
+
+        if (!data.read(entry->data + offset, count))
+            return -EFAULT;
+
+        entry->has_data = true;
+
+        size_t dirty_before = cache().dirty_count();
+        cache().mark_dirty(*entry);
+        size_t dirty_after = cache().dirty_count();
+        if (dirty_after != dirty_before && (dirty_before == 0 || dirty_after % DiskCache::writeback_report_granularity == 0)) {
+            if (Writeback::the().fs_did_change_dirty_blocks(*this, dirty_after, DiskCache::entry_count))
+                flush_writes_impl();
+        }
+        return 0;
+    }
+
+    /**
+     * @param index
+     * @param buffer
+     * @return true
+     * @return false
+     */
+    bool BlockBasedFS::raw_read(unsigned index, UserOrKernelBuffer& buffer)
+    {
+        u32 base_offset = static_cast<u32>(index) * static_cast<u32>(m_logical_block_size);
+        file_description().seek(base_offset, SEEK_SET);
+        auto nread = file_description().read(buffer, m_logical_block_size);
+        ASSERT(!nread.is_error());
+        ASSERT(nread.value() == m_logical_block_size);
+        return true;
+    }
+
+    /**
+     * @param index
+     * @param buffer
+     * @return true
+     * @return false
+     */
+    bool BlockBasedFS::raw_write(unsigned index, const UserOrKernelBuffer& buffer)
+    {
+        u32 base_offset = static_cast<u32>(index) * static_cast<u32>(m_logical_block_size);
+        file_description().seek(base_offset, SEEK_SET);
+        auto nwritten = file_description().write(buffer, m_logical_block_size);
+        ASSERT(!nwritten.is_error());
+        ASSERT(nwritten.value() == m_logical_block_size);
+        return true;
+    }
+
+    /**
+     * @param index
+     * @param count
+     * @param buffer
+     * @return true
+     * @return false
+     */
+    bool BlockBasedFS::raw_read_blocks(unsigned index, size_t count, UserOrKernelBuffer& buffer)
+    {
+        auto current = buffer;
+        for (unsigned block = index; block < (index + count); block++) {
+            if (!raw_read(block, current))
+                return false;
+            current = current.offset(logical_block_size());
+        }
+        return true;
+    }
+
+    /**
+     * @param index
+     * @param count
+     * @param buffer
+     * @return true
+     * @return false
+     */
+    bool BlockBasedFS::raw_write_blocks(unsigned index, size_t count, const UserOrKernelBuffer& buffer)
+    {
+        auto current = buffer;
+        for (unsigned block = index; block < (index + count); block++) {
+            if (!raw_write(block, current))
+                return false;
+            current = current.offset(logical_block_size());
+        }
+        return true;
+    }
+
+    /**
+     * @param index
+     * @param count
+     * @param data
+     * @param allow_cache
+     * @return int
+     */
+    int BlockBasedFS::write_blocks(unsigned index, unsigned count, const UserOrKernelBuffer& data, bool allow_cache)
+    {
+        ASSERT(m_logical_block_size);
+        for (unsigned i = 0; i < count; ++i) {
+            int error = write_block(index + i, data.offset(i * block_size()), block_size(), 0, allow_cache);
+            if (error < 0)
+                return error;
+        }
+        return 0;
+    }
+
+    /**
+     * @param index
+     * @return int
+     */
+    int BlockBasedFS::fill_cache_for_block(unsigned index) const
+    {
+        auto& cache = this->cache();
+        ASSERT(cache.find(index));
+
+        size_t wanted_blocks = cache.read_ahead_blocks_for_miss(index);
+        size_t block_count = 1;
+        while (block_count < wanted_blocks && !cache.find(index + block_count))
+            ++block_count;
+
+        auto staging_buffer = UserOrKernelBuffer::for_kernel_buffer(cache.staging_data());
+        file_description().seek(static_cast<u32>(index) * static_cast<u32>(block_size()), SEEK_SET);
+        auto nread = file_description().read(staging_buffer, block_count * block_size());
+        if (nread.is_error())
+            return -EIO;
+
+        // a short read near the end of the device still has to produce the block we were asked for
+        size_t blocks_read = nread.value() / block_size();
+        if (blocks_read == 0)
+            return -EIO;
+
+        // the entry for index is the one our caller holds, read-ahead must not evict it
+        auto* entry = cache.find(index);
+        ASSERT(entry);
+        cache.pin(*entry);
+
+        size_t blocks_cached = 1;
+        for (; blocks_cached < blocks_read; ++blocks_cached) {
+            auto* read_ahead_entry = cache.try_get_for_read_ahead(index + blocks_cached);
+            if (!read_ahead_entry)
+                break;
+            memcpy(read_ahead_entry->data, cache.staging_data() + blocks_cached * block_size(), block_size());
+            read_ahead_entry->has_data = true;
+        }
+        cache.did_read_blocks_for_miss(blocks_cached);
+
+        cache.unpin(*entry);
+        memcpy(entry->data, cache.staging_data(), block_size());
+        entry->has_data = true;
+        return 0;
+    }
+
+    /**
+     * @param index
+     * @param buffer
+     * @param count
+     * @param offset
+     * @param allow_cache
+     * @return int
+     */
+    int BlockBasedFS::read_block(unsigned index, UserOrKernelBuffer* buffer, size_t count, size_t offset, bool allow_cache) const
+    {
+        ASSERT(m_logical_block_size);
+        ASSERT(offset + count <= block_size());
+        LOCKER(m_lock);
+
+        if (!allow_cache) {
+            const_cast<BlockBasedFS*>(this)->flush_specific_block_if_needed(index);
+            u32 base_offset = static_cast<u32>(index) * static_cast<u32>(block_size()) + offset;
+            file_description().seek(base_offset, SEEK_SET);
+            auto nread = file_description().read(*buffer, count);
+            if (nread.is_error())
+                return -EIO;
+            ASSERT(nread.value() == count);
+            return 0;
+        }
+
+        auto* entry = &cache().get(index);
+        if (!entry->has_data) {
+            int error = fill_cache_for_block(index);
+            if (error < 0)
+                return error;
+            entry = cache().find(index);
+            ASSERT(entry && entry->has_data);
+        }
+
+        if (buffer && !buffer->write(entry->data + offset, count))
+            return -EFAULT;
+        return 0;
+    }
+
+    /**
+     * @param index
+     * @param count
+     * @param buffer
+     * @param allow_cache
+     * @return int
+     */
+    int BlockBasedFS::read_blocks(unsigned index, unsigned count, UserOrKernelBuffer& buffer, bool allow_cache) const
+    {
+        ASSERT(m_logical_block_size);
+        if (!count)
+            return false;
+        if (count == 1)
+            return read_block(index, &buffer, block_size(), 0, allow_cache);
+
+        auto out = buffer;
+        for (unsigned i = 0; i < count; ++i) {
+            auto error = read_block(index + i, &out, block_size(), 0, allow_cache);
+            if (error < 0)
+                return error;
+            out = out.offset(block_size());
+        }
+        return 0;
+    }
+
+    /**
+     * @param index
+     */
+    void BlockBasedFS::flush_specific_block_if_needed(unsigned index)
+    {
+        LOCKER(m_lock);
+        auto* entry = cache().find(index);
+        if (!entry || !entry->is_dirty)
+            return;
+
+        file_description().seek(static_cast<u32>(index) * static_cast<u32>(block_size()), SEEK_SET);
+        auto entry_data_buffer = UserOrKernelBuffer::for_kernel_buffer(entry->data);
+        // FIXME: Should this error path be surfaced somehow?
+        (void)file_description().write(entry_data_buffer, block_size());
+        cache().did_write_back(1);
+        cache().mark_clean(*entry);
+        if (!cache().is_dirty())
+            Writeback::the().fs_did_change_dirty_blocks(*this, 0, DiskCache::entry_count);
+    }
+
+    /**
+     * @brief write every dirty block back in block order, one write per run of adjacent blocks
+     */
+    void BlockBasedFS::flush_writes_impl()
+    {
+        LOCKER(m_lock);
+        auto& cache = this->cache();
+        if (!cache.is_dirty())
+            return;
+
+        Vector<CacheEntry*> dirty_entries;
+        dirty_entries.ensure_capacity(cache.dirty_count());
+        cache.for_each_dirty_entry([&](CacheEntry& entry) {
+            dirty_entries.unchecked_append(&entry);
+        });
+        quick_sort(dirty_entries, [](CacheEntry* a, CacheEntry* b) {
+            return a->block_index < b->block_index;
+        });
+
+        size_t request_count = 0;
+        for (size_t i = 0; i < dirty_entries.size();) {
+            u32 first_block = dirty_entries[i]->block_index;
+            size_t run_length = 1;
+            while (i + run_length < dirty_entries.size()
+                && run_length < DiskCache::staging_block_count
+                && dirty_entries[i + run_length]->block_index == first_block + run_length)
+                ++run_length;
+
+            u8* data = dirty_entries[i]->data;
+            if (run_length > 1) {
+                data = cache.staging_data();
+                for (size_t j = 0; j < run_length; ++j)
+                    memcpy(data + j * block_size(), dirty_entries[i + j]->data, block_size());
+            }
+
+            file_description().seek(static_cast<u32>(first_block) * static_cast<u32>(block_size()), SEEK_SET);
+            auto buffer = UserOrKernelBuffer::for_kernel_buffer(data);
+            // FIXME: Should this error path be surfaced somehow?
+            (void)file_description().write(buffer, run_length * block_size());
+
+            cache.did_write_back(run_length);
+            ++request_count;
+            i += run_length;
+        }
+
+        cache.mark_all_clean();
+        Writeback::the().fs_did_change_dirty_blocks(*this, 0, DiskCache::entry_count);
+        dbg() << class_name() << ": Flushed " << dirty_entries.size() << " blocks to disk in " << request_count << " writes";
+    }
+
+    void BlockBasedFS::flush_writes()
+    {
+        flush_writes_impl();
+    }
+
+    /**
+     * @return DiskCache&
+     */
+    DiskCache& BlockBasedFS::cache() const
+    {
+        if (!m_cache)
+            m_cache = make<DiskCache>(const_cast<BlockBasedFS&>(*this));
+        return *m_cache;
+    }
+
+    /**
+     * @return Optional<KBuffer>
+     */
+    Optional<KBuffer> procfs$diskcache(InodeIdentifier)
+    {
+        KBufferBuilder builder;
+        JsonArraySerializer array { builder };
+
+        DiskCache::for_each([&](const DiskCache& cache) {
+            auto& statistics = cache.statistics();
+            u64 lookups = statistics.hits + statistics.misses;
+
+            auto obj = array.add_object();
+            obj.add("fsid", cache.fs().fsid());
+            obj.add("class_name", cache.fs().class_name());
+            obj.add("block_size", cache.fs().block_size());
+            obj.add("capacity", DiskCache::entry_count);
+            obj.add("cached_blocks", cache.cached_block_count());
+            obj.add("dirty_blocks", cache.dirty_count());
+            obj.add("hits", statistics.hits);
+            obj.add("misses", statistics.misses);
+            obj.add("hit_ratio_percent", lookups ? (unsigned)(statistics.hits * 100 / lookups) : 0u);
+            obj.add("ghost_hits", statistics.ghost_hits);
+            obj.add("evictions", statistics.evictions);
+            obj.add("read_ahead_blocks", statistics.read_ahead_blocks);
+            obj.add("read_ahead_hits", statistics.read_ahead_hits);
+            obj.add("writeback_requests", statistics.writeback_requests);
+            obj.add("writeback_blocks", statistics.writeback_blocks);
+        });
+
+        array.finish();
+        return builder.build();
+    }
+
+} // namespace Kernel
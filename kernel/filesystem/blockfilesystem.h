@@ -12,6 +12,7 @@
 #pragma once 
 
 #include <kernel/filesystem/filebackedfilesystem.h>
+#include <mods/optional.h>
 
 namespace Kernel 
 {
@@ -123,9 +124,22 @@ namespace Kernel
          */
         void flush_specific_block_if_needed(unsigned index);
 
+        /**
+         * @brief fill the cache entry for index, reading ahead of it when it continues a sequential stream
+         *
+         * @param index
+         * @return int
+         */
+        int fill_cache_for_block(unsigned index) const;
+
         /// @brief: DiskCache -> m_cache
         mutable OwnPtr<DiskCache> m_cache;
 
     }; // class BlockBasedFS
 
+    /**
+     * @return Optional<KBuffer> 
+     */
+    Optional<KBuffer> procfs$diskcache(InodeIdentifier);
+
 } // namespace Kernel
\ No newline at end of file
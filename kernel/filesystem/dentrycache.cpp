@@ -0,0 +1,272 @@
+/**
+ * @file dentrycache.cpp
+ * @author Krisna Pranav
+ * @brief dentry cache
+ * @version 6.0
+ * @date 2023-09-19
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <mods/hashfunctions.h>
+#include <mods/jsonobjectserialize.h>
+#include <mods/singleton.h>
+#include <mods/string_impl.h>
+#include <kernel/filesystem/dentrycache.h>
+#include <kernel/filesystem/inode.h>
+#include <kernel/kbufferbuilder.h>
+
+namespace Kernel
+{
+
+    static Mods::Singleton<DentryCache> s_the;
+
+    /**
+     * @return DentryCache&
+     */
+    DentryCache& DentryCache::the()
+    {
+        return *s_the;
+    }
+
+    /// @brief Construct a new DentryCache object
+    DentryCache::DentryCache()
+    {
+    }
+
+    /**
+     * @param parent
+     * @param name
+     * @return unsigned
+     */
+    unsigned DentryCache::hash_for(InodeIdentifier parent, const StringView& name)
+    {
+        return pair_int_hash(pair_int_hash(parent.fsid(), parent.index()), string_hash(name.characters_without_null_termination(), name.length()));
+    }
+
+    /**
+     * @param parent
+     * @param name
+     * @param hash
+     * @return DentryCache::Entry*
+     */
+    DentryCache::Entry* DentryCache::Shard::find(InodeIdentifier parent, const StringView& name, unsigned hash)
+    {
+        ASSERT(lock.is_locked());
+        for (auto& entry : bucket_for(hash)) {
+            if (entry.hash == hash && entry.parent == parent && entry.name == name)
+                return &entry;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @param entry
+     */
+    void DentryCache::Shard::unlink(Entry& entry)
+    {
+        ASSERT(lock.is_locked());
+        bucket_for(entry.hash).remove(entry);
+        lru_list.remove(entry);
+        size--;
+    }
+
+    /**
+     * @param parent
+     * @param name
+     * @return Optional<RefPtr<Inode>>
+     */
+    Optional<RefPtr<Inode>> DentryCache::lookup(const Inode& parent, const StringView& name)
+    {
+        auto identifier = parent.identifier();
+        unsigned hash = hash_for(identifier, name);
+        auto& shard = shard_for(hash);
+        Entry* stale = nullptr;
+
+        {
+            ScopedSpinLock lock(shard.lock);
+            auto* entry = shard.find(identifier, name, hash);
+            if (!entry) {
+                shard.statistics.misses++;
+                return {};
+            }
+
+            if (entry->is_negative) {
+                shard.statistics.negative_hits++;
+                shard.lru_list.prepend(*entry);
+                return RefPtr<Inode> {};
+            }
+
+            if (auto child = entry->child.strong_ref()) {
+                shard.statistics.hits++;
+                shard.lru_list.prepend(*entry);
+                return child;
+            }
+
+            // the child was released since, forget it and look the name up again
+            shard.unlink(*entry);
+            shard.statistics.misses++;
+            stale = entry;
+        }
+
+        delete stale;
+        return {};
+    }
+
+    /**
+     * @brief the entry is built before taking the shard lock, which must not be held across
+     *        an allocation or the release of an inode
+     *
+     * @param parent
+     * @param name
+     * @param child
+     * @param generation
+     */
+    void DentryCache::add(Inode& parent, const StringView& name, RefPtr<Inode> child, u64 generation)
+    {
+        auto identifier = parent.identifier();
+        unsigned hash = hash_for(identifier, name);
+        auto& shard = shard_for(hash);
+
+        auto* new_entry = new Entry;
+        new_entry->parent = identifier;
+        new_entry->parent_inode = parent;
+        new_entry->name = name;
+        new_entry->hash = hash;
+        new_entry->is_negative = !child;
+        if (child)
+            new_entry->child = child->make_weak_ptr();
+
+        Entry* unused = nullptr;
+        {
+            ScopedSpinLock lock(shard.lock);
+            if (m_generation.load(Mods::memory_order_relaxed) != generation) {
+                unused = new_entry;
+            } else if (auto* entry = shard.find(identifier, name, hash)) {
+                // swap so the old weak link is released with the unused entry, outside the lock
+                swap(entry->child, new_entry->child);
+                swap(entry->is_negative, new_entry->is_negative);
+                shard.lru_list.prepend(*entry);
+                unused = new_entry;
+            } else {
+                shard.bucket_for(hash).prepend(*new_entry);
+                shard.lru_list.prepend(*new_entry);
+                shard.size++;
+                shard.statistics.insertions++;
+
+                if (shard.size > max_entries_per_shard) {
+                    unused = shard.lru_list.last();
+                    shard.unlink(*unused);
+                    shard.statistics.evictions++;
+                }
+            }
+        }
+
+        delete unused;
+    }
+
+    /**
+     * @param parent
+     * @param name
+     */
+    void DentryCache::invalidate(InodeIdentifier parent, const StringView& name)
+    {
+        unsigned hash = hash_for(parent, name);
+        auto& shard = shard_for(hash);
+        Entry* entry;
+
+        {
+            ScopedSpinLock lock(shard.lock);
+            m_generation.fetch_add(1, Mods::memory_order_release);
+            entry = shard.find(parent, name, hash);
+            if (!entry)
+                return;
+            shard.unlink(*entry);
+            shard.statistics.invalidations++;
+        }
+
+        delete entry;
+    }
+
+    /**
+     * @param fsid
+     */
+    void DentryCache::invalidate_fs(u32 fsid)
+    {
+        m_generation.fetch_add(1, Mods::memory_order_release);
+
+        for (auto& shard : m_shards) {
+            // unlinked entries are chained through their lru node until the lock is dropped
+            LRUList entries;
+            {
+                ScopedSpinLock lock(shard.lock);
+                for (auto it = shard.lru_list.begin(); it != shard.lru_list.end();) {
+                    auto& entry = *it;
+                    ++it;
+                    if (entry.parent.fsid() != fsid)
+                        continue;
+                    shard.unlink(entry);
+                    entries.append(entry);
+                    shard.statistics.invalidations++;
+                }
+            }
+
+            while (auto* entry = entries.take_first())
+                delete entry;
+        }
+    }
+
+    /**
+     * @return DentryCacheStatistics
+     */
+    DentryCacheStatistics DentryCache::statistics() const
+    {
+        DentryCacheStatistics total;
+        for (auto& shard : m_shards) {
+            total.hits += shard.statistics.hits;
+            total.negative_hits += shard.statistics.negative_hits;
+            total.misses += shard.statistics.misses;
+            total.insertions += shard.statistics.insertions;
+            total.evictions += shard.statistics.evictions;
+            total.invalidations += shard.statistics.invalidations;
+        }
+        return total;
+    }
+
+    /**
+     * @return size_t
+     */
+    size_t DentryCache::size() const
+    {
+        size_t size = 0;
+        for (auto& shard : m_shards)
+            size += shard.size;
+        return size;
+    }
+
+    /**
+     * @return Optional<KBuffer>
+     */
+    Optional<KBuffer> procfs$dentrycache(InodeIdentifier)
+    {
+        auto& cache = DentryCache::the();
+        auto statistics = cache.statistics();
+        u64 lookups = statistics.hits + statistics.negative_hits + statistics.misses;
+
+        KBufferBuilder builder;
+        JsonObjectSerializer json { builder };
+        json.add("entries", cache.size());
+        json.add("capacity", DentryCache::max_entries);
+        json.add("hits", statistics.hits);
+        json.add("negative_hits", statistics.negative_hits);
+        json.add("misses", statistics.misses);
+        json.add("hit_ratio_percent", lookups ? (unsigned)((statistics.hits + statistics.negative_hits) * 100 / lookups) : 0u);
+        json.add("insertions", statistics.insertions);
+        json.add("evictions", statistics.evictions);
+        json.add("invalidations", statistics.invalidations);
+        json.finish();
+        return builder.build();
+    }
+
+} // namespace Kernel
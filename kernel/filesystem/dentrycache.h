@@ -0,0 +1,189 @@
+/**
+ * @file dentrycache.h
+ * @author Krisna Pranav
+ * @brief dentry cache
+ * @version 6.0
+ * @date 2023-09-19
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#pragma once
+
+#include <mods/atomic.h>
+#include <mods/intrusivelist.h>
+#include <mods/optional.h>
+#include <mods/refptr.h>
+#include <mods/string.h>
+#include <mods/weakptr.h>
+#include <kernel/filesystem/inodeidentifier.h>
+#include <kernel/forward.h>
+#include <kernel/spinlock.h>
+
+namespace Kernel
+{
+
+    struct DentryCacheStatistics
+    {
+        u64 hits { 0 };
+        u64 negative_hits { 0 };
+        u64 misses { 0 };
+        u64 insertions { 0 };
+        u64 evictions { 0 };
+        u64 invalidations { 0 };
+    }; // struct DentryCacheStatistics
+
+    /**
+     * @brief maps (parent directory, name) to the child inode found there, or to nothing for
+     *        names known not to exist. Children are held weakly, the cache never keeps an
+     *        inode alive, and an entry whose child has gone away counts as a miss. Only disk file systems use it, synthetic ones like
+     *        procfs change their directories without going through add_child/remove_child.
+     *        Split into shards with a spinlock each, so lookups of different names rarely
+     *        meet on a lock and none of them sleeps.
+     */
+    class DentryCache
+    {
+    public:
+        static constexpr size_t shard_count = 16;
+        static constexpr size_t bucket_count = 1024;
+        static constexpr size_t max_entries = 8192;
+        static constexpr size_t buckets_per_shard = bucket_count / shard_count;
+        static constexpr size_t max_entries_per_shard = max_entries / shard_count;
+
+        /**
+         * @return DentryCache&
+         */
+        static DentryCache& the();
+
+        DentryCache();
+
+        /**
+         * @param parent
+         * @param name
+         * @return Optional<RefPtr<Inode>> empty on a miss, a null RefPtr for a negative entry
+         */
+        Optional<RefPtr<Inode>> lookup(const Inode& parent, const StringView& name);
+
+        /**
+         * @brief bumped by every invalidation, take it before calling Inode::lookup and hand it to add()
+         *
+         * @return u64
+         */
+        u64 generation() const
+        {
+            return m_generation.load(Mods::memory_order_acquire);
+        }
+
+        /**
+         * @brief dropped if anything was invalidated since generation, the lookup result may be stale
+         *
+         * @param parent
+         * @param name
+         * @param child null to remember that name does not exist
+         * @param generation
+         */
+        void add(Inode& parent, const StringView& name, RefPtr<Inode> child, u64 generation);
+
+        /**
+         * @param parent
+         * @param name
+         */
+        void invalidate(InodeIdentifier parent, const StringView& name);
+
+        /**
+         * @brief drop every entry of a file system, for unmount
+         *
+         * @param fsid
+         */
+        void invalidate_fs(u32 fsid);
+
+        /**
+         * @brief summed over the shards, a racy snapshot
+         *
+         * @return DentryCacheStatistics
+         */
+        DentryCacheStatistics statistics() const;
+
+        /**
+         * @return size_t
+         */
+        size_t size() const;
+
+    private:
+        struct Entry
+        {
+            IntrusiveListNode bucket_node;
+            IntrusiveListNode lru_node;
+            InodeIdentifier parent;
+
+            /// @brief pinned so its identifier can't be reused while entries still name it
+            RefPtr<Inode> parent_inode;
+            String name;
+            unsigned hash { 0 };
+            bool is_negative { false };
+            WeakPtr<Inode> child;
+        }; // struct Entry
+
+        using BucketList = IntrusiveList<Entry, &Entry::bucket_node>;
+        using LRUList = IntrusiveList<Entry, &Entry::lru_node>;
+
+        struct Shard
+        {
+            SpinLock<u8> lock;
+            BucketList buckets[buckets_per_shard];
+            LRUList lru_list;
+            size_t size { 0 };
+            DentryCacheStatistics statistics;
+
+            /**
+             * @param parent
+             * @param name
+             * @param hash
+             * @return Entry*
+             */
+            Entry* find(InodeIdentifier parent, const StringView& name, unsigned hash);
+
+            /**
+             * @brief unlink entry, the caller deletes it after dropping the lock since that may free an inode
+             *
+             * @param entry
+             */
+            void unlink(Entry& entry);
+
+            /**
+             * @param hash
+             * @return BucketList&
+             */
+            BucketList& bucket_for(unsigned hash)
+            {
+                return buckets[(hash / shard_count) % buckets_per_shard];
+            }
+        }; // struct Shard
+
+        /**
+         * @param parent
+         * @param name
+         * @return unsigned
+         */
+        static unsigned hash_for(InodeIdentifier parent, const StringView& name);
+
+        /**
+         * @param hash
+         * @return Shard&
+         */
+        Shard& shard_for(unsigned hash)
+        {
+            return m_shards[hash % shard_count];
+        }
+
+        Shard m_shards[shard_count];
+        Atomic<u64> m_generation { 0 };
+    }; // class DentryCache
+
+    /**
+     * @return Optional<KBuffer>
+     */
+    Optional<KBuffer> procfs$dentrycache(InodeIdentifier);
+
+} // namespace Kernel
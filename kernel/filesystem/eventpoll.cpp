@@ -0,0 +1,321 @@
+/**
+ * @file eventpoll.cpp
+ * @author Krisna Pranav
+ * @brief event poll
+ * @version 6.0
+ * @date 2023-09-22
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <kernel/filesystem/eventpoll.h>
+#include <kernel/filesystem/filedescription.h>
+
+namespace Kernel
+{
+
+    using BlockFlags = Thread::FileBlocker::BlockFlags;
+
+    /**
+     * @brief errors and hang-ups are reported whether they were asked for or not
+     *
+     * @param events
+     * @return BlockFlags
+     */
+    static BlockFlags block_flags_for_events(u32 events)
+    {
+        u32 flags = (u32)BlockFlags::Exception;
+        if (events & EPOLLIN)
+            flags |= (u32)BlockFlags::Read | (u32)BlockFlags::Accept;
+        if (events & EPOLLPRI)
+            flags |= (u32)BlockFlags::ReadPriority;
+        if (events & EPOLLOUT)
+            flags |= (u32)BlockFlags::Write | (u32)BlockFlags::Connect;
+        return (BlockFlags)flags;
+    }
+
+    /**
+     * @param ready
+     * @param requested
+     * @return u32
+     */
+    static u32 events_for_block_flags(BlockFlags ready, u32 requested)
+    {
+        u32 flags = (u32)ready;
+        u32 events = 0;
+        if (flags & ((u32)BlockFlags::Read | (u32)BlockFlags::Accept))
+            events |= EPOLLIN;
+        if (flags & (u32)BlockFlags::ReadPriority)
+            events |= EPOLLPRI;
+        if (flags & ((u32)BlockFlags::Write | (u32)BlockFlags::Connect))
+            events |= EPOLLOUT;
+        if (flags & (u32)BlockFlags::ReadHangUp)
+            events |= EPOLLHUP | (requested & EPOLLRDHUP);
+        if (flags & (u32)BlockFlags::WriteHangUp)
+            events |= EPOLLHUP;
+        if (flags & ((u32)BlockFlags::WriteError | (u32)BlockFlags::WriteNotOpen))
+            events |= EPOLLERR;
+        return events;
+    }
+
+    /**
+     * @return NonnullRefPtr<EventPoll>
+     */
+    NonnullRefPtr<EventPoll> EventPoll::create()
+    {
+        return adopt(*new EventPoll);
+    }
+
+    /// @brief Construct a new EventPoll object
+    EventPoll::EventPoll()
+    {
+    }
+
+    /// @brief Destroy the EventPoll object
+    EventPoll::~EventPoll()
+    {
+        for (auto& it : m_interests)
+            it.value->m_file->block_condition().remove_watcher(*it.value);
+    }
+
+    /**
+     * @param fd
+     * @param description
+     * @param event
+     * @return KResult
+     */
+    KResult EventPoll::add(int fd, FileDescription& description, const epoll_event& event)
+    {
+        if (description.file().is_event_poll())
+            return KResult(-EINVAL);
+
+        LOCKER(m_lock);
+        if (auto it = m_interests.find(fd); it != m_interests.end()) {
+            if (it->value->m_description.unsafe_ptr() == &description)
+                return KResult(-EEXIST);
+
+            // fd was closed and reused without EPOLL_CTL_DEL, the old interest is unreachable
+            drop(*it->value);
+        }
+
+        auto interest = make<Interest>(*this, fd, description, event);
+        auto& interest_ref = *interest;
+        m_interests.set(fd, move(interest));
+
+        interest_ref.m_file->block_condition().add_watcher(interest_ref);
+
+        // the file may be ready already, the first wait finds out
+        make_ready(interest_ref);
+        return KSuccess;
+    }
+
+    /**
+     * @param fd
+     * @param event
+     * @return KResult
+     */
+    KResult EventPoll::modify(int fd, const epoll_event& event)
+    {
+        LOCKER(m_lock);
+        auto it = m_interests.find(fd);
+        if (it == m_interests.end())
+            return KResult(-ENOENT);
+
+        if (it->value->m_description.is_null()) {
+            drop(*it->value);
+            return KResult(-ENOENT);
+        }
+
+        {
+            ScopedSpinLock lock(m_ready_lock);
+            it->value->m_event = event;
+        }
+        make_ready(*it->value);
+        return KSuccess;
+    }
+
+    /**
+     * @param fd
+     * @return KResult
+     */
+    KResult EventPoll::remove(int fd)
+    {
+        LOCKER(m_lock);
+        auto it = m_interests.find(fd);
+        if (it == m_interests.end())
+            return KResult(-ENOENT);
+
+        bool was_closed = it->value->m_description.is_null();
+        drop(*it->value);
+        return was_closed ? KResult(-ENOENT) : KSuccess;
+    }
+
+    /**
+     * @param interest
+     */
+    void EventPoll::drop(Interest& interest)
+    {
+        ASSERT(m_lock.is_locked());
+
+        interest.m_file->block_condition().remove_watcher(interest);
+        {
+            ScopedSpinLock lock(m_ready_lock);
+            if (interest.m_on_ready_list) {
+                m_ready_list.remove(interest);
+                interest.m_on_ready_list = false;
+            }
+        }
+
+        m_interests.remove(interest.m_fd);
+    }
+
+    /**
+     * @param interest
+     */
+    void EventPoll::make_ready(Interest& interest)
+    {
+        {
+            ScopedSpinLock lock(m_ready_lock);
+            if (interest.m_on_ready_list)
+                return;
+            interest.m_on_ready_list = true;
+            m_ready_list.append(interest);
+        }
+
+        m_wait_queue.wake_all();
+        evaluate_block_conditions();
+    }
+
+    /// @brief runs under the watched file's block condition lock
+    void EventPoll::Interest::file_did_change_state()
+    {
+        m_poll.make_ready(*this);
+    }
+
+    /**
+     * @brief interests are taken off the ready list before their file is asked, so a change
+     *        racing with us puts them right back instead of getting lost. Level-triggered ones
+     *        that are still ready go back on, the next wait asks again. Interests whose
+     *        description was closed are dropped here
+     *
+     * @param events
+     * @param max_events
+     */
+    void EventPoll::collect_ready(Vector<epoll_event>& events, size_t max_events)
+    {
+        LOCKER(m_lock);
+
+        Vector<Interest*, 32> candidates;
+        {
+            ScopedSpinLock lock(m_ready_lock);
+            while (candidates.size() < max_events - events.size()) {
+                auto* interest = m_ready_list.take_first();
+                if (!interest)
+                    break;
+                interest->m_on_ready_list = false;
+                candidates.append(interest);
+            }
+        }
+
+        for (auto* interest : candidates) {
+            auto description = interest->m_description.strong_ref();
+            if (!description) {
+                drop(*interest);
+                continue;
+            }
+
+            u32 requested = interest->m_event.events;
+            auto ready = description->should_unblock(block_flags_for_events(requested));
+            u32 ready_events = events_for_block_flags(ready, requested);
+            if (!ready_events)
+                continue;
+
+            events.append({ ready_events, interest->m_event.data });
+
+            if (!(requested & EPOLLET)) {
+                ScopedSpinLock lock(m_ready_lock);
+                if (!interest->m_on_ready_list) {
+                    interest->m_on_ready_list = true;
+                    m_ready_list.append(*interest);
+                }
+            }
+        }
+    }
+
+    /**
+     * @param events
+     * @param max_events
+     * @param timeout
+     * @return KResult
+     */
+    KResult EventPoll::wait(Vector<epoll_event>& events, size_t max_events, const Thread::BlockTimeout& timeout)
+    {
+        ASSERT(max_events > 0);
+
+        for (;;) {
+            bool has_candidates;
+            do {
+                collect_ready(events, max_events);
+                ScopedSpinLock lock(m_ready_lock);
+                has_candidates = !m_ready_list.is_empty();
+            } while (events.is_empty() && has_candidates);
+
+            if (!events.is_empty() || !timeout.should_block())
+                return KSuccess;
+
+            auto result = m_wait_queue.wait_on(timeout, "EventPoll");
+            if (result.was_interrupted())
+                return KResult(-EINTR);
+            if (result.timed_out())
+                return KSuccess;
+        }
+    }
+
+    /**
+     * @return KResultOr<size_t>
+     */
+    KResultOr<size_t> EventPoll::read(FileDescription&, size_t, UserOrKernelBuffer&, size_t)
+    {
+        return KResult(-EINVAL);
+    }
+
+    /**
+     * @return KResultOr<size_t>
+     */
+    KResultOr<size_t> EventPoll::write(FileDescription&, size_t, const UserOrKernelBuffer&, size_t)
+    {
+        return KResult(-EINVAL);
+    }
+
+    /**
+     * @brief readable while something is on the ready list, so an event poll can itself be
+     *        select()ed or poll()ed
+     *
+     * @return true
+     * @return false
+     */
+    bool EventPoll::can_read(const FileDescription&, size_t) const
+    {
+        ScopedSpinLock lock(m_ready_lock);
+        return !m_ready_list.is_empty();
+    }
+
+    /**
+     * @return true
+     * @return false
+     */
+    bool EventPoll::can_write(const FileDescription&, size_t) const
+    {
+        return false;
+    }
+
+    /**
+     * @return String
+     */
+    String EventPoll::absolute_path(const FileDescription&) const
+    {
+        return "eventpoll";
+    }
+
+} // namespace Kernel
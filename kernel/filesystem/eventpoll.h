@@ -0,0 +1,151 @@
+/**
+ * @file eventpoll.h
+ * @author Krisna Pranav
+ * @brief event poll
+ * @version 6.0
+ * @date 2023-09-22
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#pragma once
+
+#include <mods/hashmap.h>
+#include <mods/intrusivelist.h>
+#include <mods/nonnullownptr.h>
+#include <mods/vector.h>
+#include <mods/weakptr.h>
+#include <kernel/filesystem/file.h>
+#include <kernel/lock.h>
+#include <kernel/spinlock.h>
+#include <kernel/thread.h>
+#include <kernel/waitqueue.h>
+
+namespace Kernel
+{
+
+    /**
+     * @brief a persistent set of descriptors to watch. Each interest hooks its file's
+     *        FileBlockCondition and moves itself onto the ready list when the file changes
+     *        state, so waiting only ever looks at files that did something
+     */
+    class EventPoll final : public File
+    {
+    public:
+        /**
+         * @return NonnullRefPtr<EventPoll>
+         */
+        static NonnullRefPtr<EventPoll> create();
+
+        /// @brief Destroy the EventPoll object
+        virtual ~EventPoll() override;
+
+        /**
+         * @brief the interest only holds description weakly. Once the last fd for it is closed
+         *        the interest is dropped the next time it is looked at, so close() implies
+         *        EPOLL_CTL_DEL and a reused fd number can be added again
+         *
+         * @param fd
+         * @param description
+         * @param event
+         * @return KResult
+         */
+        KResult add(int fd, FileDescription& description, const epoll_event& event);
+        KResult modify(int fd, const epoll_event& event);
+        KResult remove(int fd);
+
+        /**
+         * @brief fill events with up to max_events ready interests, waiting for one until timeout
+         *
+         * @param events
+         * @param max_events
+         * @param timeout
+         * @return KResult
+         */
+        KResult wait(Vector<epoll_event>& events, size_t max_events, const Thread::BlockTimeout& timeout);
+
+    private:
+        class Interest final : public FileEventWatcher
+        {
+        public:
+            /**
+             * @param poll
+             * @param fd
+             * @param description
+             * @param event
+             */
+            Interest(EventPoll& poll, int fd, FileDescription& description, const epoll_event& event)
+                : m_poll(poll)
+                , m_fd(fd)
+                , m_description(description.make_weak_ptr())
+                , m_file(description.file())
+                , m_event(event)
+            { }
+
+            virtual void file_did_change_state() override;
+
+            EventPoll& m_poll;
+            int m_fd { -1 };
+            WeakPtr<FileDescription> m_description;
+
+            /// @brief keeps the block condition the interest is hooked into alive
+            NonnullRefPtr<File> m_file;
+            epoll_event m_event;
+
+            /// @brief guarded by m_ready_lock
+            bool m_on_ready_list { false };
+            IntrusiveListNode m_ready_list_node;
+        }; // class Interest
+
+        EventPoll();
+
+        /**
+         * @param interest
+         */
+        void make_ready(Interest&);
+
+        /**
+         * @brief unhook interest from its file and destroy it, m_lock must be held
+         *
+         * @param interest
+         */
+        void drop(Interest&);
+
+        /**
+         * @brief one pass over the ready list, at most max_events interests
+         *
+         * @param events
+         * @param max_events
+         */
+        void collect_ready(Vector<epoll_event>& events, size_t max_events);
+
+        virtual KResultOr<size_t> read(FileDescription&, size_t, UserOrKernelBuffer&, size_t) override;
+        virtual KResultOr<size_t> write(FileDescription&, size_t, const UserOrKernelBuffer&, size_t) override;
+
+        virtual bool can_read(const FileDescription&, size_t) const override;
+        virtual bool can_write(const FileDescription&, size_t) const override;
+
+        virtual String absolute_path(const FileDescription&) const override;
+
+        virtual const char* class_name() const override
+        {
+            return "EventPoll";
+        }
+
+        virtual bool is_event_poll() const override
+        {
+            return true;
+        }
+
+        /// @brief serializes ctl against wait, so an interest can't go away while it is examined
+        Lock m_lock { "EventPoll" };
+        HashMap<int, NonnullOwnPtr<Interest>> m_interests;
+
+        mutable SpinLock<u8> m_ready_lock;
+        IntrusiveList<Interest, &Interest::m_ready_list_node> m_ready_list;
+
+        WaitQueue m_wait_queue;
+    }; // class EventPoll
+
+} // namespace Kernel
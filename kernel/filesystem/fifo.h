@@ -58,6 +58,26 @@ namespace Kernel
         void attach(Direction);
         void detach(Direction);
 
+        /**
+         * @brief for splicing into the pipe, fill writes straight into the pipe's buffer
+         *
+         * @param count
+         * @param fill
+         * @return KResultOr<size_t>
+         */
+        KResultOr<size_t> write_from(size_t count, Function<ssize_t(UserOrKernelBuffer&, size_t)> fill)
+        {
+            if (!m_readers)
+                return KResult(-EPIPE);
+
+            ssize_t nwritten = m_buffer.write_from(count, move(fill));
+            if (nwritten < 0)
+                return KResult(nwritten);
+            if (nwritten)
+                evaluate_block_conditions();
+            return (size_t)nwritten;
+        }
+
     private:
         /**
          * @return KResultOr<size_t> 
@@ -11,6 +11,7 @@
 
 #pragma once 
 
+#include <mods/intrusivelist.h>
 #include <mods/nonnullrefptr.h>
 #include <mods/refcounted.h>
 #include <mods/string.h>
@@ -27,6 +28,21 @@ namespace Kernel
 
     class File;
 
+    /**
+     * @brief a listener that outlives a single blocked thread, like an event poll's interest in
+     *        a file. It is told about every state change, with the condition's lock held
+     */
+    class FileEventWatcher
+    {
+    public:
+        virtual ~FileEventWatcher() { }
+
+        /// @brief must not block or take the file's own locks
+        virtual void file_did_change_state() = 0;
+
+        IntrusiveListNode watcher_list_node;
+    }; // class FileEventWatcher
+
     class FileBlockCondition : public Thread::BlockCondition 
     {
     public:
@@ -60,10 +76,32 @@ namespace Kernel
                 auto& blocker = static_cast<Thread::FileBlocker&>(b);
                 return blocker.unblock(false, data);
             });
+
+            for (auto& watcher : m_watchers)
+                watcher.file_did_change_state();
+        }
+
+        /**
+         * @param watcher
+         */
+        void add_watcher(FileEventWatcher& watcher)
+        {
+            ScopedSpinLock lock(m_lock);
+            m_watchers.append(watcher);
+        }
+
+        /**
+         * @param watcher
+         */
+        void remove_watcher(FileEventWatcher& watcher)
+        {
+            ScopedSpinLock lock(m_lock);
+            m_watchers.remove(watcher);
         }
 
     private:
         File& m_file;
+        IntrusiveList<FileEventWatcher, &FileEventWatcher::watcher_list_node> m_watchers;
     }; // class FileBlockCondition
 
     class File
@@ -170,6 +208,11 @@ namespace Kernel
             return false; 
         }
 
+        virtual bool is_event_poll() const 
+        { 
+            return false; 
+        }
+
         virtual bool is_device() const 
         { 
             return false; 
@@ -14,6 +14,7 @@
 #include <mods/badge.h>
 #include <mods/byte_buffer.h>
 #include <mods/refcounted.h>
+#include <mods/weakable.h>
 #include <kernel/kbuffer.h>
 #include <kernel/virtual_address.h>
 #include <kernel/filesystem/fifo.h>
@@ -24,7 +25,9 @@
 namespace Kernel 
 {
 
-    class FileDescription : public RefCounted<FileDescription> 
+    class FileDescription
+        : public RefCounted<FileDescription>
+        , public Weakable<FileDescription>
     {
         MAKE_SLAB_ALLOCATED(FileDescription)
     public:
@@ -96,6 +99,16 @@ namespace Kernel
         KResultOr<size_t> read(UserOrKernelBuffer&, size_t);
         KResultOr<size_t> write(const UserOrKernelBuffer& data, size_t);
 
+        /**
+         * @brief positional read/write for pread and friends, the current offset is neither
+         *        used nor moved so they don't take m_lock
+         *
+         * @param offset
+         * @return KResultOr<size_t>
+         */
+        KResultOr<size_t> read(UserOrKernelBuffer&, u64 offset, size_t);
+        KResultOr<size_t> write(const UserOrKernelBuffer& data, u64 offset, size_t);
+
         /**
          * @return KResult 
          */
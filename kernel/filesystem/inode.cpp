@@ -0,0 +1,414 @@
+/**
+ * @file inode.cpp
+ * @author Krisna Pranav
+ * @brief inode
+ * @version 6.0
+ * @date 2023-08-11
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <mods/singleton.h>
+#include <mods/string_view.h>
+#include <kernel/filesystem/custody.h>
+#include <kernel/filesystem/dentrycache.h>
+#include <kernel/filesystem/inode.h>
+#include <kernel/filesystem/inodewatcher.h>
+#include <kernel/filesystem/virtualfilesystem.h>
+#include <kernel/filesystem/writeback.h>
+#include <kernel/kbufferbuilder.h>
+#include <kernel/net/localsocket.h>
+#include <kernel/vm/sharedinodevmobject.h>
+
+namespace Kernel
+{
+
+    static SpinLock<u32> s_all_inodes_lock;
+    static Mods::Singleton<InlineLinkedList<Inode>> s_list;
+
+    /**
+     * @return SpinLock<u32>&
+     */
+    SpinLock<u32>& Inode::all_inodes_lock()
+    {
+        return s_all_inodes_lock;
+    }
+
+    /**
+     * @return InlineLinkedList<Inode>&
+     */
+    InlineLinkedList<Inode>& Inode::all_with_lock()
+    {
+        ASSERT(s_all_inodes_lock.is_locked());
+
+        return *s_list;
+    }
+
+    /// @brief only the inodes on the writeback dirty list can need a flush, so there is no need to walk all of them
+    void Inode::sync()
+    {
+        Writeback::the().flush_all_inodes();
+    }
+
+    /**
+     * @param descriptor
+     * @return KResultOr<KBuffer>
+     */
+    KResultOr<KBuffer> Inode::read_entire(FileDescription* descriptor) const
+    {
+        KBufferBuilder builder;
+
+        ssize_t nread;
+        u8 buffer[4096];
+        off_t offset = 0;
+
+        for (;;) {
+            auto buf = UserOrKernelBuffer::for_kernel_buffer(buffer);
+            nread = read_bytes(offset, sizeof(buffer), buf, descriptor);
+
+            if (nread < 0)
+                return KResult(nread);
+
+            ASSERT(nread <= (ssize_t)sizeof(buffer));
+
+            if (nread <= 0)
+                break;
+
+            builder.append((const char*)buffer, nread);
+            offset += nread;
+
+            if (nread < (ssize_t)sizeof(buffer))
+                break;
+        }
+
+        if (nread < 0) {
+            klog() << "Inode::read_entire: ERROR: " << nread;
+            return KResult(nread);
+        }
+
+        return builder.build();
+    }
+
+    /**
+     * @brief the stored contents are a path, resolved the way a symlink is expected to behave
+     *
+     * @param base
+     * @param out_parent
+     * @param options
+     * @param symlink_recursion_level
+     * @return KResultOr<NonnullRefPtr<Custody>>
+     */
+    KResultOr<NonnullRefPtr<Custody>> Inode::resolve_as_link(Custody& base, RefPtr<Custody>* out_parent, int options, int symlink_recursion_level) const
+    {
+        auto contents_or = read_entire();
+
+        if (contents_or.is_error())
+            return contents_or.error();
+
+        auto& contents = contents_or.value();
+        auto path = StringView(contents.data(), contents.size());
+
+        return VFS::the().resolve_path(path, base, out_parent, options, symlink_recursion_level);
+    }
+
+    /**
+     * @param fs
+     * @param index
+     */
+    Inode::Inode(FS& fs, unsigned index)
+        : m_fs(fs)
+        , m_index(index)
+    {
+        ScopedSpinLock all_inodes_lock(s_all_inodes_lock);
+        all_with_lock().append(this);
+    }
+
+    /// @brief Destroy the Inode object
+    Inode::~Inode()
+    {
+        ScopedSpinLock all_inodes_lock(s_all_inodes_lock);
+        all_with_lock().remove(this);
+    }
+
+    void Inode::will_be_destroyed()
+    {
+        LOCKER(m_lock);
+
+        if (m_metadata_dirty)
+            flush_metadata();
+    }
+
+    /**
+     * @param offset
+     * @param size
+     * @param data
+     */
+    void Inode::inode_contents_changed(off_t offset, ssize_t size, const UserOrKernelBuffer& data)
+    {
+        LOCKER(m_lock);
+
+        if (auto shared_vmobject = this->shared_vmobject())
+            shared_vmobject->inode_contents_changed({}, offset, size, data);
+    }
+
+    /**
+     * @param old_size
+     * @param new_size
+     */
+    void Inode::inode_size_changed(size_t old_size, size_t new_size)
+    {
+        LOCKER(m_lock);
+
+        if (auto shared_vmobject = this->shared_vmobject())
+            shared_vmobject->inode_size_changed({}, old_size, new_size);
+    }
+
+    /**
+     * @return int
+     */
+    int Inode::set_atime(time_t)
+    {
+        return -ENOTIMPL;
+    }
+
+    /**
+     * @return int
+     */
+    int Inode::set_ctime(time_t)
+    {
+        return -ENOTIMPL;
+    }
+
+    /**
+     * @return int
+     */
+    int Inode::set_mtime(time_t)
+    {
+        return -ENOTIMPL;
+    }
+
+    /**
+     * @return KResult
+     */
+    KResult Inode::increment_link_count()
+    {
+        return KResult(-ENOTIMPL);
+    }
+
+    /**
+     * @return KResult
+     */
+    KResult Inode::decrement_link_count()
+    {
+        return KResult(-ENOTIMPL);
+    }
+
+    /**
+     * @param vmobject
+     */
+    void Inode::set_shared_vmobject(SharedInodeVMObject& vmobject)
+    {
+        LOCKER(m_lock);
+        m_shared_vmobject = vmobject;
+    }
+
+    /**
+     * @param socket
+     * @return true
+     * @return false
+     */
+    bool Inode::bind_socket(LocalSocket& socket)
+    {
+        LOCKER(m_lock);
+
+        if (m_socket)
+            return false;
+
+        m_socket = socket;
+        return true;
+    }
+
+    /**
+     * @return true
+     * @return false
+     */
+    bool Inode::unbind_socket()
+    {
+        LOCKER(m_lock);
+
+        if (!m_socket)
+            return false;
+
+        m_socket = nullptr;
+        return true;
+    }
+
+    /**
+     * @param watcher
+     */
+    void Inode::register_watcher(Badge<InodeWatcher>, InodeWatcher& watcher)
+    {
+        LOCKER(m_lock);
+        ASSERT(!m_watchers.contains(&watcher));
+        m_watchers.set(&watcher);
+    }
+
+    /**
+     * @param watcher
+     */
+    void Inode::unregister_watcher(Badge<InodeWatcher>, InodeWatcher& watcher)
+    {
+        LOCKER(m_lock);
+        ASSERT(m_watchers.contains(&watcher));
+        m_watchers.remove(&watcher);
+    }
+
+    /**
+     * @return FIFO&
+     */
+    FIFO& Inode::fifo()
+    {
+        LOCKER(m_lock);
+        ASSERT(metadata().is_fifo());
+
+        if (!m_fifo)
+            m_fifo = FIFO::create(metadata().uid);
+
+        ASSERT(m_fifo);
+        return *m_fifo;
+    }
+
+    /**
+     * @brief watchers hear about the change right away, the writeback task is told so it
+     *        flushes the metadata within Writeback::dirty_expire_ms
+     *
+     * @param metadata_dirty
+     */
+    void Inode::set_metadata_dirty(bool metadata_dirty)
+    {
+        {
+            LOCKER(m_lock);
+
+            if (metadata_dirty)
+                ASSERT(!fs().is_readonly());
+
+            if (m_metadata_dirty == metadata_dirty)
+                return;
+
+            m_metadata_dirty = metadata_dirty;
+
+            if (m_metadata_dirty) {
+                for (auto& watcher : m_watchers)
+                    watcher->notify_inode_event({}, InodeWatcherEvent::Type::Modified);
+            }
+        }
+
+        if (metadata_dirty)
+            Writeback::the().inode_did_become_dirty(*this);
+        else
+            Writeback::the().inode_did_become_clean(*this);
+    }
+
+    /**
+     * @param name
+     * @return RefPtr<Inode>
+     */
+    RefPtr<Inode> Inode::cached_lookup(StringView name)
+    {
+        if (!fs().is_file_backed() || name == "." || name == "..")
+            return lookup(name);
+
+        if (auto cached = DentryCache::the().lookup(*this, name); cached.has_value())
+            return cached.value();
+
+        auto generation = DentryCache::the().generation();
+        auto child = lookup(name);
+        DentryCache::the().add(*this, name, child, generation);
+        return child;
+    }
+
+    /**
+     * @brief watchers are told first, then the dentry cache forgets the name
+     *
+     * @param child_id
+     * @param name
+     */
+    void Inode::did_add_child(const InodeIdentifier& child_id, const String& name)
+    {
+        {
+            LOCKER(m_lock);
+
+            for (auto& watcher : m_watchers)
+                watcher->notify_child_added({}, child_id);
+        }
+
+        DentryCache::the().invalidate(identifier(), name);
+    }
+
+    /**
+     * @param child_id
+     * @param name
+     */
+    void Inode::did_remove_child(const InodeIdentifier& child_id, const String& name)
+    {
+        {
+            LOCKER(m_lock);
+
+            for (auto& watcher : m_watchers)
+                watcher->notify_child_removed({}, child_id);
+        }
+
+        DentryCache::the().invalidate(identifier(), name);
+    }
+
+    /**
+     * @return KResult
+     */
+    KResult Inode::prepare_to_write_data()
+    {
+        LOCKER(m_lock);
+
+        if (fs().is_readonly())
+            return KResult(-EROFS);
+
+        auto metadata = this->metadata();
+
+        if (metadata.is_setuid() || metadata.is_setgid()) {
+            dbg() << "Inode::prepare_to_write_data(): Stripping SUID/SGID bits from " << identifier();
+            return chmod(metadata.mode & ~(04000 | 02000));
+        }
+
+        return KSuccess;
+    }
+
+    /**
+     * @return RefPtr<SharedInodeVMObject>
+     */
+    RefPtr<SharedInodeVMObject> Inode::shared_vmobject()
+    {
+        LOCKER(m_lock);
+        return m_shared_vmobject.strong_ref();
+    }
+
+    /**
+     * @return RefPtr<SharedInodeVMObject>
+     */
+    RefPtr<SharedInodeVMObject> Inode::shared_vmobject() const
+    {
+        LOCKER(m_lock);
+        return m_shared_vmobject.strong_ref();
+    }
+
+    /**
+     * @param other
+     * @return true
+     * @return false
+     */
+    bool Inode::is_shared_vmobject(const SharedInodeVMObject& other) const
+    {
+        LOCKER(m_lock);
+        return m_shared_vmobject.unsafe_ptr() == &other;
+    }
+
+} // namespace Kernel
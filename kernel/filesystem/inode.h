@@ -34,6 +34,7 @@ namespace Kernel
         , public InlineLinkedListNode<Inode> {
         friend class VFS;
         friend class FS;
+        friend class Writeback;
 
     public:
         virtual ~Inode();
@@ -139,6 +140,14 @@ namespace Kernel
          */
         virtual RefPtr<Inode> lookup(StringView name) = 0;
 
+        /**
+         * @brief lookup() through the DentryCache, path resolution should go through this
+         *
+         * @param name
+         * @return RefPtr<Inode>
+         */
+        RefPtr<Inode> cached_lookup(StringView name);
+
         /**
          * @param data 
          * @return ssize_t 
@@ -319,8 +328,8 @@ namespace Kernel
          */
         KResult prepare_to_write_data();
 
-        void did_add_child(const InodeIdentifier&);
-        void did_remove_child(const InodeIdentifier&);
+        void did_add_child(const InodeIdentifier& child_id, const String& name);
+        void did_remove_child(const InodeIdentifier& child_id, const String& name);
 
         mutable Lock m_lock { "Inode" };
 
@@ -337,6 +346,9 @@ namespace Kernel
 
         bool m_metadata_dirty { false };
 
+        /// @brief guarded by the Writeback lock, keeps the inode on its dirty list at most once
+        bool m_on_writeback_list { false };
+
         RefPtr<FIFO> m_fifo;
     }; // class Inode
 
@@ -0,0 +1,74 @@
+/**
+ * @file positionalio.cpp
+ * @author Krisna Pranav
+ * @brief positional io
+ * @version 6.0
+ * @date 2023-09-21
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <mods/check.h>
+#include <kernel/filesystem/file.h>
+#include <kernel/filesystem/filedescription.h>
+
+namespace Kernel
+{
+
+    /**
+     * @param file
+     * @param offset
+     * @param count
+     * @return KResult
+     */
+    static KResult validate_positional_range(const File& file, u64 offset, size_t count)
+    {
+        if (!file.is_seekable())
+            return KResult(-ESPIPE);
+
+        Checked<u64> end = offset;
+        end += count;
+        if (end.has_overflow() || end.value() > (u64)NumericLimits<off_t>::max())
+            return KResult(-EOVERFLOW);
+
+        return KSuccess;
+    }
+
+    /**
+     * @param buffer
+     * @param offset
+     * @param count
+     * @return KResultOr<size_t>
+     */
+    KResultOr<size_t> FileDescription::read(UserOrKernelBuffer& buffer, u64 offset, size_t count)
+    {
+        auto result = validate_positional_range(*m_file, offset, count);
+        if (result.is_error())
+            return result;
+
+        auto nread_or_error = m_file->read(*this, offset, buffer, count);
+        if (!nread_or_error.is_error())
+            evaluate_block_conditions();
+        return nread_or_error;
+    }
+
+    /**
+     * @param data
+     * @param offset
+     * @param count
+     * @return KResultOr<size_t>
+     */
+    KResultOr<size_t> FileDescription::write(const UserOrKernelBuffer& data, u64 offset, size_t count)
+    {
+        auto result = validate_positional_range(*m_file, offset, count);
+        if (result.is_error())
+            return result;
+
+        auto nwritten_or_error = m_file->write(*this, offset, data, count);
+        if (!nwritten_or_error.is_error())
+            evaluate_block_conditions();
+        return nwritten_or_error;
+    }
+
+} // namespace Kernel
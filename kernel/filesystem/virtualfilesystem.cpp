@@ -0,0 +1,293 @@
+/**
+ * @file virtualfilesystem.cpp
+ * @author Krisna Pranav
+ * @brief virtual file system
+ * @version 6.0
+ * @date 2023-08-11
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <mods/string_builder.h>
+#include <kernel/filesystem/custody.h>
+#include <kernel/filesystem/dentrycache.h>
+#include <kernel/filesystem/filesystem.h>
+#include <kernel/filesystem/inode.h>
+#include <kernel/filesystem/virtualfilesystem.h>
+#include <kernel/kresult.h>
+#include <kernel/process.h>
+
+namespace Kernel
+{
+
+    static constexpr int symlink_recursion_limit { 5 };
+
+    /**
+     * @param file_system
+     * @param mount_point
+     * @param flags
+     * @return KResult
+     */
+    KResult VFS::mount(FS& file_system, Custody& mount_point, int flags)
+    {
+        LOCKER(m_lock);
+
+        auto& inode = mount_point.inode();
+        dbg() << "VFS: Mounting " << file_system.class_name() << " at " << mount_point.absolute_path() << " (inode: " << inode.identifier() << ") with flags " << flags;
+
+        Mount mount { file_system, &mount_point, flags };
+        m_mounts.append(move(mount));
+        return KSuccess;
+    }
+
+    /**
+     * @param source
+     * @param mount_point
+     * @param flags
+     * @return KResult
+     */
+    KResult VFS::bind_mount(Custody& source, Custody& mount_point, int flags)
+    {
+        LOCKER(m_lock);
+
+        dbg() << "VFS: Bind-mounting " << source.absolute_path() << " at " << mount_point.absolute_path();
+
+        Mount mount { source.inode(), mount_point, flags };
+        m_mounts.append(move(mount));
+        return KSuccess;
+    }
+
+    /**
+     * @param mount_point
+     * @param new_flags
+     * @return KResult
+     */
+    KResult VFS::remount(Custody& mount_point, int new_flags)
+    {
+        LOCKER(m_lock);
+
+        dbg() << "VFS: Remounting " << mount_point.absolute_path();
+
+        Mount* mount = find_mount_for_guest(mount_point.inode());
+        if (!mount)
+            return KResult(-ENODEV);
+
+        mount->set_flags(new_flags);
+        return KSuccess;
+    }
+
+    /**
+     * @param guest_inode
+     * @return KResult
+     */
+    KResult VFS::unmount(Inode& guest_inode)
+    {
+        LOCKER(m_lock);
+
+        dbg() << "VFS: unmount called with inode " << guest_inode.identifier();
+
+        for (size_t i = 0; i < m_mounts.size(); ++i) {
+            auto& mount = m_mounts.at(i);
+            if (&mount.guest() != &guest_inode)
+                continue;
+
+            auto result = mount.guest_fs().prepare_to_unmount();
+            if (result.is_error()) {
+                dbg() << "VFS: Failed to unmount!";
+                return result;
+            }
+
+            auto fsid = mount.guest_fs().fsid();
+            dbg() << "VFS: found fs " << fsid << " at mount index " << i << "! Unmounting...";
+            m_mounts.unstable_take(i);
+
+            // the entries pin the file system's directories, and its fsid may be reused
+            DentryCache::the().invalidate_fs(fsid);
+            return KSuccess;
+        }
+
+        dbg() << "VFS: Nothing mounted on inode " << guest_inode.identifier();
+        return KResult(-ENODEV);
+    }
+
+    /**
+     * @brief the mount table is held Shared for the walk, callback must not mount or unmount
+     *
+     * @param callback
+     */
+    void VFS::for_each_mount(Function<void(const Mount&)> callback) const
+    {
+        LOCKER(m_lock, Lock::Mode::Shared);
+
+        for (auto& mount : m_mounts)
+            callback(mount);
+    }
+
+    /**
+     * @param inode
+     * @return VFS::Mount*
+     */
+    auto VFS::find_mount_for_host(Inode& inode) -> Mount*
+    {
+        return find_mount_for_host(inode.identifier());
+    }
+
+    /**
+     * @param id
+     * @return VFS::Mount*
+     */
+    auto VFS::find_mount_for_host(InodeIdentifier id) -> Mount*
+    {
+        ASSERT(m_lock.is_locked());
+
+        for (auto& mount : m_mounts) {
+            if (mount.host() && mount.host()->identifier() == id)
+                return &mount;
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * @param inode
+     * @return VFS::Mount*
+     */
+    auto VFS::find_mount_for_guest(Inode& inode) -> Mount*
+    {
+        return find_mount_for_guest(inode.identifier());
+    }
+
+    /**
+     * @param id
+     * @return VFS::Mount*
+     */
+    auto VFS::find_mount_for_guest(InodeIdentifier id) -> Mount*
+    {
+        ASSERT(m_lock.is_locked());
+
+        for (auto& mount : m_mounts) {
+            if (mount.guest().identifier() == id)
+                return &mount;
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * @param path
+     * @param base
+     * @param out_parent
+     * @param options
+     * @param symlink_recursion_level
+     * @return KResultOr<NonnullRefPtr<Custody>>
+     */
+    KResultOr<NonnullRefPtr<Custody>> VFS::resolve_path(StringView path, Custody& base, RefPtr<Custody>* out_parent, int options, int symlink_recursion_level)
+    {
+        auto custody_or_error = resolve_path_without_veil(path, base, out_parent, options, symlink_recursion_level);
+        if (custody_or_error.is_error())
+            return custody_or_error.error();
+
+        auto& custody = custody_or_error.value();
+        auto result = validate_path_against_process_veil(custody->absolute_path(), options);
+        if (result.is_error())
+            return result;
+
+        return custody;
+    }
+
+    /**
+     * @brief components are looked up through the DentryCache. The mount table is only
+     *        held, Shared, while a component is checked for something mounted on it, so
+     *        resolutions never wait on each other and a mount only waits for the
+     *        component checks already in progress
+     *
+     * @param path
+     * @param base
+     * @param out_parent
+     * @param options
+     * @param symlink_recursion_level
+     * @return KResultOr<NonnullRefPtr<Custody>>
+     */
+    KResultOr<NonnullRefPtr<Custody>> VFS::resolve_path_without_veil(StringView path, Custody& base, RefPtr<Custody>* out_parent, int options, int symlink_recursion_level)
+    {
+        if (symlink_recursion_level >= symlink_recursion_limit)
+            return KResult(-ELOOP);
+
+        if (path.is_empty())
+            return KResult(-EINVAL);
+
+        auto parts = path.split_view('/', true);
+        auto current_process = Process::current();
+        auto& current_root = current_process->root_directory();
+
+        NonnullRefPtr<Custody> custody = path[0] == '/' ? current_root : base;
+
+        for (size_t i = 0; i < parts.size(); ++i) {
+            Custody& parent = custody;
+            auto parent_metadata = parent.inode().metadata();
+
+            if (!parent_metadata.is_directory())
+                return KResult(-ENOTDIR);
+
+            if (!parent_metadata.may_execute(*current_process))
+                return KResult(-EACCES);
+
+            auto& part = parts[i];
+            bool have_more_parts = i + 1 < parts.size();
+
+            if (part == "..") {
+                if (custody->parent())
+                    custody = *custody->parent();
+                continue;
+            } else if (part == "." || part.is_empty()) {
+                continue;
+            }
+
+            auto child_inode = parent.inode().cached_lookup(part);
+            if (!child_inode) {
+                if (out_parent)
+                    *out_parent = have_more_parts ? nullptr : &parent;
+
+                return KResult(-ENOENT);
+            }
+
+            int mount_flags_for_child = parent.mount_flags();
+
+            {
+                LOCKER(m_lock, Lock::Mode::Shared);
+                if (auto* mount = find_mount_for_host(*child_inode)) {
+                    child_inode = mount->guest();
+                    mount_flags_for_child = mount->flags();
+                }
+            }
+
+            custody = Custody::create(&parent, part, *child_inode, mount_flags_for_child);
+
+            if (child_inode->metadata().is_symlink()) {
+                if (!have_more_parts) {
+                    if (options & O_NOFOLLOW)
+                        return KResult(-ELOOP);
+                    if (options & O_NOFOLLOW_NOERROR)
+                        break;
+                }
+
+                auto symlink_target = child_inode->resolve_as_link(parent, out_parent, options, symlink_recursion_level + 1);
+                if (symlink_target.is_error() || !have_more_parts)
+                    return symlink_target;
+
+                StringBuilder remaining_path;
+                remaining_path.append('.');
+                remaining_path.append(path.substring_view_starting_after_substring(part));
+
+                return resolve_path_without_veil(remaining_path.to_string(), *symlink_target.value(), out_parent, options, symlink_recursion_level + 1);
+            }
+        }
+
+        if (out_parent)
+            *out_parent = custody->parent();
+
+        return custody;
+    }
+
+} // namespace Kernel
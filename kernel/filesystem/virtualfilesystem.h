@@ -360,6 +360,8 @@ namespace Kernel
         KResult traverse_directory_inode(Inode&, Function<bool(const FS::DirectoryEntryView&)>);
 
         /**
+         * @brief callers hold m_lock, Shared is enough unless they change the mount
+         * 
          * @return Mount* 
          */
         Mount* find_mount_for_host(Inode&);
@@ -367,7 +369,8 @@ namespace Kernel
         Mount* find_mount_for_guest(Inode&);
         Mount* find_mount_for_guest(InodeIdentifier);
 
-        Lock m_lock { "VFSLock" };
+        /// @brief guards m_mounts, path resolution and for_each_mount read it Shared
+        mutable Lock m_lock { "VFSLock" };
 
         RefPtr<Inode> m_root_inode;
 
@@ -0,0 +1,219 @@
+/**
+ * @file writeback.cpp
+ * @author Krisna Pranav
+ * @brief writeback
+ * @version 6.0
+ * @date 2023-09-18
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <mods/singleton.h>
+#include <kernel/filesystem/filesystem.h>
+#include <kernel/filesystem/inode.h>
+#include <kernel/filesystem/writeback.h>
+#include <kernel/thread.h>
+#include <kernel/time/timemanagement.h>
+
+namespace Kernel
+{
+
+    static Mods::Singleton<Writeback> s_the;
+
+    /**
+     * @return Writeback&
+     */
+    Writeback& Writeback::the()
+    {
+        return *s_the;
+    }
+
+    /// @brief Construct a new Writeback object
+    Writeback::Writeback()
+    {
+    }
+
+    /**
+     * @param inode
+     */
+    void Writeback::inode_did_become_dirty(Inode& inode)
+    {
+        LOCKER(m_lock);
+        if (inode.m_on_writeback_list)
+            return;
+        inode.m_on_writeback_list = true;
+
+        bool was_idle = !has_dirty_work();
+        m_dirty_inodes.append({ inode, TimeManagement::the().uptime_ms() });
+        if (was_idle)
+            m_wait_queue.wake_one();
+    }
+
+    /**
+     * @param inode
+     */
+    void Writeback::inode_did_become_clean(Inode& inode)
+    {
+        LOCKER(m_lock);
+        if (!inode.m_on_writeback_list)
+            return;
+        inode.m_on_writeback_list = false;
+        m_dirty_inodes.remove_first_matching([&](auto& entry) {
+            return entry.inode.ptr() == &inode;
+        });
+    }
+
+    /**
+     * @param fs
+     * @param dirty_blocks
+     * @param capacity_blocks
+     * @return true
+     * @return false
+     */
+    bool Writeback::fs_did_change_dirty_blocks(FS& fs, size_t dirty_blocks, size_t capacity_blocks)
+    {
+        LOCKER(m_lock);
+
+        DirtyFS* entry = nullptr;
+        for (size_t i = 0; i < m_dirty_filesystems.size(); ++i) {
+            if (m_dirty_filesystems[i].fs.ptr() != &fs)
+                continue;
+            if (dirty_blocks == 0) {
+                m_dirty_filesystems.remove(i);
+                return false;
+            }
+            entry = &m_dirty_filesystems[i];
+            break;
+        }
+
+        if (dirty_blocks == 0)
+            return false;
+
+        bool was_idle = !has_dirty_work();
+        if (!entry) {
+            m_dirty_filesystems.append({ fs, TimeManagement::the().uptime_ms(), 0, 0 });
+            entry = &m_dirty_filesystems.last();
+        }
+
+        bool was_over_background = entry->dirty_blocks * 100 > entry->capacity_blocks * background_dirty_percent;
+        entry->dirty_blocks = dirty_blocks;
+        entry->capacity_blocks = capacity_blocks;
+        bool over_background = dirty_blocks * 100 > capacity_blocks * background_dirty_percent;
+
+        if (was_idle || (over_background && !was_over_background)) {
+            if (over_background)
+                m_statistics.background_wakeups++;
+            m_wait_queue.wake_one();
+        }
+
+        if (dirty_blocks * 100 > capacity_blocks * throttle_dirty_percent) {
+            m_statistics.throttled_writes++;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @return true
+     * @return false
+     */
+    bool Writeback::has_dirty_work() const
+    {
+        return !m_dirty_inodes.is_empty() || !m_dirty_filesystems.is_empty();
+    }
+
+    /**
+     * @brief take what is due off the lists and write it back without holding m_lock, writers
+     *        report to us while holding their file system's lock so we must never wait for that
+     *        lock with ours held
+     */
+    void Writeback::flush_pass()
+    {
+        Vector<NonnullRefPtr<Inode>> inodes;
+        Vector<NonnullRefPtr<FS>> filesystems;
+
+        {
+            LOCKER(m_lock);
+            u64 now = TimeManagement::the().uptime_ms();
+            m_statistics.passes++;
+
+            for (size_t i = 0; i < m_dirty_inodes.size();) {
+                auto& entry = m_dirty_inodes[i];
+                if (now - entry.dirtied_at_ms >= dirty_expire_ms) {
+                    entry.inode->m_on_writeback_list = false;
+                    inodes.append(entry.inode);
+                    m_dirty_inodes.remove(i);
+                    continue;
+                }
+                ++i;
+            }
+
+            for (size_t i = 0; i < m_dirty_filesystems.size();) {
+                auto& entry = m_dirty_filesystems[i];
+                bool over_background = entry.dirty_blocks * 100 > entry.capacity_blocks * background_dirty_percent;
+                if (over_background || now - entry.dirtied_at_ms >= dirty_expire_ms) {
+                    filesystems.append(entry.fs);
+                    m_dirty_filesystems.remove(i);
+                    continue;
+                }
+                ++i;
+            }
+
+            m_statistics.inodes_flushed += inodes.size();
+            m_statistics.filesystems_flushed += filesystems.size();
+        }
+
+        // metadata first, it lands in the block caches we flush right after
+        for (auto& inode : inodes) {
+            if (inode->is_metadata_dirty())
+                inode->flush_metadata();
+        }
+
+        for (auto& fs : filesystems)
+            fs->flush_writes();
+    }
+
+    void Writeback::flush_all_inodes()
+    {
+        Vector<NonnullRefPtr<Inode>> inodes;
+        {
+            LOCKER(m_lock);
+            for (auto& entry : m_dirty_inodes) {
+                entry.inode->m_on_writeback_list = false;
+                inodes.append(entry.inode);
+            }
+            m_dirty_inodes.clear();
+        }
+
+        for (auto& inode : inodes) {
+            if (inode->is_metadata_dirty())
+                inode->flush_metadata();
+        }
+    }
+
+    void Writeback::run()
+    {
+        dbg() << "SyncTask is running";
+
+        for (;;) {
+            bool has_work;
+            {
+                LOCKER(m_lock);
+                has_work = has_dirty_work();
+            }
+
+            if (!has_work) {
+                m_wait_queue.wait_on({}, "Writeback");
+                continue;
+            }
+
+            timespec interval = TimeManagement::ticks_to_time(writeback_interval_ms, 1000);
+            Thread::BlockTimeout timeout(false, &interval);
+            m_wait_queue.wait_on(timeout, "Writeback");
+
+            flush_pass();
+        }
+    }
+
+} // namespace Kernel
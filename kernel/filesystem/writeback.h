@@ -0,0 +1,117 @@
+/**
+ * @file writeback.h
+ * @author Krisna Pranav
+ * @brief writeback
+ * @version 6.0
+ * @date 2023-09-18
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#pragma once
+
+#include <mods/nonnullrefptr.h>
+#include <mods/vector.h>
+#include <kernel/forward.h>
+#include <kernel/lock.h>
+#include <kernel/waitqueue.h>
+
+namespace Kernel
+{
+
+    struct WritebackStatistics
+    {
+        u64 passes { 0 };
+        u64 inodes_flushed { 0 };
+        u64 filesystems_flushed { 0 };
+        u64 background_wakeups { 0 };
+        u64 throttled_writes { 0 };
+    }; // struct WritebackStatistics
+
+    /**
+     * @brief keeps the inodes with dirty metadata and the file systems with dirty cached blocks
+     *        on lists in the order they got dirty, so the sync task only touches what needs
+     *        writing and can sleep for as long as nothing is dirty
+     */
+    class Writeback
+    {
+    public:
+        /// @brief anything dirty this long is written back on the next pass
+        static constexpr u64 dirty_expire_ms = 30000;
+        static constexpr u64 writeback_interval_ms = 5000;
+
+        /// @brief share of a block cache that may be dirty before the sync task is woken early
+        static constexpr size_t background_dirty_percent = 10;
+
+        /// @brief share of a block cache that may be dirty before the writer has to flush it itself
+        static constexpr size_t throttle_dirty_percent = 20;
+
+        /**
+         * @return Writeback&
+         */
+        static Writeback& the();
+
+        Writeback();
+
+        /**
+         * @param inode
+         */
+        void inode_did_become_dirty(Inode&);
+        void inode_did_become_clean(Inode&);
+
+        /**
+         * @brief block caches report their dirty count after every change, 0 takes fs off the list
+         *
+         * @param fs
+         * @param dirty_blocks
+         * @param capacity_blocks
+         * @return true if the writer should flush fs before it dirties more
+         */
+        bool fs_did_change_dirty_blocks(FS& fs, size_t dirty_blocks, size_t capacity_blocks);
+
+        /// @brief write back every dirty inode's metadata, whatever its age
+        void flush_all_inodes();
+
+        /// @brief the sync task's loop, never returns
+        [[noreturn]] void run();
+
+        /**
+         * @return const WritebackStatistics&
+         */
+        const WritebackStatistics& statistics() const
+        {
+            return m_statistics;
+        }
+
+    private:
+        struct DirtyInode
+        {
+            NonnullRefPtr<Inode> inode;
+            u64 dirtied_at_ms;
+        }; // struct DirtyInode
+
+        struct DirtyFS
+        {
+            NonnullRefPtr<FS> fs;
+            u64 dirtied_at_ms;
+            size_t dirty_blocks;
+            size_t capacity_blocks;
+        }; // struct DirtyFS
+
+        /**
+         * @return true
+         * @return false
+         */
+        bool has_dirty_work() const;
+
+        void flush_pass();
+
+        mutable Lock m_lock { "Writeback" };
+        Vector<DirtyInode> m_dirty_inodes;
+        Vector<DirtyFS> m_dirty_filesystems;
+        WaitQueue m_wait_queue;
+        WritebackStatistics m_statistics;
+    }; // class Writeback
+
+} // namespace Kernel
@@ -22,6 +22,7 @@ namespace Kernel {
     class DoubleBuffer;
     class File;
     class FileDescription;
+    class FutexQueue;
     class IPv4Socket;
     class Inode;
     class InodeIdentifier;
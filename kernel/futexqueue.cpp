@@ -0,0 +1,226 @@
+/**
+ * @file futexqueue.cpp
+ * @author Krisna Pranav
+ * @brief futex queue
+ * @version 6.0
+ * @date 2023-09-12
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <kernel/futexqueue.h>
+#include <kernel/thread.h>
+
+namespace Kernel
+{
+
+    /**
+     * @param futex_queue
+     * @param bitset
+     * @param requeued_to
+     */
+    Thread::FutexBlocker::FutexBlocker(FutexQueue& futex_queue, u32 bitset, RefPtr<FutexQueue>& requeued_to)
+        : m_bitset(bitset)
+        , m_requeued_to(requeued_to)
+    {
+        if (!set_block_condition(futex_queue, Thread::current()))
+            m_should_block = false;
+    }
+
+    /// @brief Destroy the Futex Blocker object
+    Thread::FutexBlocker::~FutexBlocker()
+    {
+    }
+
+    /**
+     * @param futex_queue
+     */
+    void Thread::FutexBlocker::finish_requeue(FutexQueue& futex_queue)
+    {
+        ASSERT(m_lock.own_lock());
+        set_block_condition_raw_locked(&futex_queue);
+        m_requeued_to = futex_queue;
+        m_lock.unlock(m_relock_flags);
+    }
+
+    /**
+     * @param bitset
+     * @return true
+     * @return false
+     */
+    bool Thread::FutexBlocker::unblock_bitset(u32 bitset)
+    {
+        {
+            ScopedSpinLock lock(m_lock);
+            if (m_did_unblock || (bitset != FUTEX_BITSET_MATCH_ANY && (m_bitset & bitset) == 0))
+                return false;
+
+            m_did_unblock = true;
+            m_should_block = false;
+        }
+        unblock_from_blocker();
+        return true;
+    }
+
+    /**
+     * @param force
+     * @return true
+     * @return false
+     */
+    bool Thread::FutexBlocker::unblock(bool force)
+    {
+        {
+            ScopedSpinLock lock(m_lock);
+            if (m_did_unblock)
+                return force;
+
+            m_did_unblock = true;
+            m_should_block = false;
+        }
+        unblock_from_blocker();
+        return true;
+    }
+
+    /**
+     * @param user_address
+     */
+    FutexQueue::FutexQueue(FlatPtr user_address)
+        : m_user_address(user_address)
+    {
+    }
+
+    /// @brief Destroy the Futex Queue object
+    FutexQueue::~FutexQueue()
+    {
+    }
+
+    /**
+     * @param b
+     * @param data
+     * @return true
+     * @return false
+     */
+    bool FutexQueue::should_add_blocker(Thread::Blocker& b, void* data)
+    {
+        ASSERT(data != nullptr);
+        ASSERT(m_lock.is_locked());
+        ASSERT(b.blocker_type() == Thread::Blocker::Type::Futex);
+
+        ASSERT(m_imminent_waits > 0);
+        m_imminent_waits--;
+
+        if (m_pending_wakes > 0) {
+            m_pending_wakes--;
+            return false;
+        }
+        return true;
+    }
+
+    void FutexQueue::queue_imminent_wait()
+    {
+        ScopedSpinLock lock(m_lock);
+        m_imminent_waits++;
+    }
+
+    void FutexQueue::cancel_imminent_wait()
+    {
+        ScopedSpinLock lock(m_lock);
+        ASSERT(m_imminent_waits > 0);
+        m_imminent_waits--;
+        m_pending_wakes = min(m_pending_wakes, m_imminent_waits);
+    }
+
+    /**
+     * @return true
+     * @return false
+     */
+    bool FutexQueue::is_empty_and_no_imminent_waits()
+    {
+        ScopedSpinLock lock(m_lock);
+        return m_imminent_waits == 0 && do_is_empty();
+    }
+
+    /**
+     * @brief a wake that finds fewer blockers than requested is remembered for the waiters that
+     *        already checked the futex word but have not blocked yet, so it cannot be lost
+     *
+     * @param wake_count
+     * @param bitset
+     * @return u32
+     */
+    u32 FutexQueue::do_wake_n(u32 wake_count, u32 bitset)
+    {
+        ASSERT(m_lock.is_locked());
+
+        u32 did_wake = 0;
+        if (wake_count == 0)
+            return 0;
+
+        do_unblock_some([&](Thread::Blocker& b, void* data, bool& stop_iterating) {
+            ASSERT(data);
+            ASSERT(b.blocker_type() == Thread::Blocker::Type::Futex);
+            auto& blocker = static_cast<Thread::FutexBlocker&>(b);
+
+            if (blocker.unblock_bitset(bitset)) {
+                if (++did_wake == wake_count)
+                    stop_iterating = true;
+                return true;
+            }
+            return false;
+        });
+
+        if (did_wake < wake_count)
+            m_pending_wakes = min(m_pending_wakes + (wake_count - did_wake), m_imminent_waits);
+
+        return did_wake;
+    }
+
+    /**
+     * @param wake_count
+     * @param bitset
+     * @return u32
+     */
+    u32 FutexQueue::wake_n(u32 wake_count, u32 bitset)
+    {
+        ScopedSpinLock lock(m_lock);
+        return do_wake_n(wake_count, bitset);
+    }
+
+    /**
+     * @param wake_count
+     * @param target
+     * @param requeue_count
+     * @return u32
+     */
+    u32 FutexQueue::wake_n_requeue(u32 wake_count, FutexQueue& target, u32 requeue_count)
+    {
+        ASSERT(&target != this);
+
+        ScopedSpinLock lock(m_lock);
+        u32 did_wake = do_wake_n(wake_count, FUTEX_BITSET_MATCH_ANY);
+        if (requeue_count == 0)
+            return did_wake;
+
+        auto blockers_to_requeue = do_take_blockers(requeue_count);
+        if (blockers_to_requeue.is_empty())
+            return did_wake;
+
+        for (auto& info : blockers_to_requeue) {
+            ASSERT(info.blocker->blocker_type() == Thread::Blocker::Type::Futex);
+            static_cast<Thread::FutexBlocker*>(info.blocker)->begin_requeue();
+        }
+        lock.unlock();
+
+        u32 did_requeue = blockers_to_requeue.size();
+        ScopedSpinLock target_lock(target.m_lock);
+
+        auto requeued = blockers_to_requeue;
+        target.do_append_blockers(move(blockers_to_requeue));
+        for (auto& info : requeued)
+            static_cast<Thread::FutexBlocker*>(info.blocker)->finish_requeue(target);
+
+        return did_wake + did_requeue;
+    }
+
+} // namespace Kernel
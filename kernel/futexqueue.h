@@ -0,0 +1,107 @@
+/**
+ * @file futexqueue.h
+ * @author Krisna Pranav
+ * @brief futex queue
+ * @version 6.0
+ * @date 2023-09-12
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#pragma once
+
+#include <mods/refcounted.h>
+#include <kernel/spinlock.h>
+#include <kernel/thread.h>
+
+namespace Kernel
+{
+
+    class FutexQueue : public Thread::BlockCondition
+        , public RefCounted<FutexQueue>
+    {
+    public:
+        /**
+         * @brief the creator counts as the first imminent waiter
+         *
+         * @param user_address
+         */
+        explicit FutexQueue(FlatPtr user_address);
+        virtual ~FutexQueue();
+
+        /**
+         * @param wake_count
+         * @param bitset
+         * @return u32
+         */
+        u32 wake_n(u32 wake_count, u32 bitset);
+
+        /**
+         * @brief wake up to wake_count waiters, then move up to requeue_count of the rest onto target
+         *        without waking them
+         *
+         * @param wake_count
+         * @param target
+         * @param requeue_count
+         * @return u32
+         */
+        u32 wake_n_requeue(u32 wake_count, FutexQueue& target, u32 requeue_count);
+
+        /**
+         * @return FlatPtr
+         */
+        FlatPtr user_address() const
+        {
+            return m_user_address;
+        }
+
+        /**
+         * @brief if the waiter gets requeued, requeued_to is left holding the queue it was
+         *        moved to last, which is the one to clean up once the wait is over
+         *
+         * @param timeout
+         * @param bitset
+         * @param requeued_to
+         * @return Thread::BlockResult
+         */
+        Thread::BlockResult wait_on(const Thread::BlockTimeout& timeout, u32 bitset, RefPtr<FutexQueue>& requeued_to)
+        {
+            return Thread::current()->block<Thread::FutexBlocker>(timeout, *this, bitset, requeued_to);
+        }
+
+        /// @brief announce a waiter that is about to check the futex word and block
+        void queue_imminent_wait();
+
+        /// @brief the announced waiter saw a changed futex word and will not block
+        void cancel_imminent_wait();
+
+        /**
+         * @return true
+         * @return false
+         */
+        bool is_empty_and_no_imminent_waits();
+
+    protected:
+        /**
+         * @param b
+         * @param data
+         * @return true
+         * @return false
+         */
+        virtual bool should_add_blocker(Thread::Blocker& b, void* data) override;
+
+    private:
+        /**
+         * @param wake_count
+         * @param bitset
+         * @return u32
+         */
+        u32 do_wake_n(u32 wake_count, u32 bitset);
+
+        FlatPtr m_user_address { 0 };
+        size_t m_imminent_waits { 1 };
+        size_t m_pending_wakes { 0 };
+    }; // class FutexQueue
+
+} // namespace Kernel
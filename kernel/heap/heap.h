@@ -143,14 +143,45 @@ namespace Kernel
             ASSERT((u8*)a >= m_chunks && (u8*)ptr < m_chunks + m_total_chunks * CHUNK_SIZE);
             ASSERT((u8*)a + a->allocation_size_in_chunks * CHUNK_SIZE <= m_chunks + m_total_chunks * CHUNK_SIZE);
 
-            size_t old_size = a->allocation_size_in_chunks * CHUNK_SIZE;
+            size_t old_chunks = a->allocation_size_in_chunks;
+            size_t old_size = old_chunks * CHUNK_SIZE - sizeof(AllocationHeader);
+            size_t new_chunks = (new_size + sizeof(AllocationHeader) + CHUNK_SIZE - 1) / CHUNK_SIZE;
+            FlatPtr start = ((FlatPtr)a - (FlatPtr)m_chunks) / CHUNK_SIZE;
+
+            if (new_chunks == old_chunks) {
+                m_in_place_reallocations++;
+                return ptr;
+            }
+
+            if (new_chunks < old_chunks) {
+                size_t released_chunks = old_chunks - new_chunks;
+                m_bitmap.set_range(start + new_chunks, released_chunks, false);
+                m_allocated_chunks -= released_chunks;
+                a->allocation_size_in_chunks = new_chunks;
+                if constexpr (HEAP_SCRUB_BYTE_FREE != 0) {
+                    __builtin_memset(m_chunks + (start + new_chunks) * CHUNK_SIZE, HEAP_SCRUB_BYTE_FREE, released_chunks * CHUNK_SIZE);
+                }
+                m_in_place_reallocations++;
+                return ptr;
+            }
 
-            if (old_size == new_size)
+            size_t extra_chunks = new_chunks - old_chunks;
+            if (start + new_chunks <= m_total_chunks && m_bitmap.count_in_range(start + old_chunks, extra_chunks, true) == 0) {
+                m_bitmap.set_range(start + old_chunks, extra_chunks, true);
+                m_allocated_chunks += extra_chunks;
+                a->allocation_size_in_chunks = new_chunks;
+                if constexpr (HEAP_SCRUB_BYTE_ALLOC != 0) {
+                    __builtin_memset(m_chunks + (start + old_chunks) * CHUNK_SIZE, HEAP_SCRUB_BYTE_ALLOC, extra_chunks * CHUNK_SIZE);
+                }
+                m_in_place_reallocations++;
                 return ptr;
+            }
 
+            // on failure the old allocation stays valid, like realloc()
             auto* new_ptr = h.allocate(new_size);
-            if (new_ptr)
-                __builtin_memcpy(new_ptr, ptr, min(old_size, new_size));
+            if (!new_ptr)
+                return nullptr;
+            __builtin_memcpy(new_ptr, ptr, min(old_size, new_size));
             deallocate(ptr);
             return new_ptr;
         }
@@ -236,9 +267,18 @@ namespace Kernel
             return m_allocated_chunks * CHUNK_SIZE; 
         }
 
+        /**
+         * @return size_t 
+         */
+        size_t in_place_reallocations() const 
+        { 
+            return m_in_place_reallocations; 
+        }
+
     private:
         size_t m_total_chunks { 0 };
         size_t m_allocated_chunks { 0 };
+        size_t m_in_place_reallocations { 0 };
         u8* m_chunks { nullptr };
         Bitmap m_bitmap;
     }; // class Heap
@@ -532,10 +572,327 @@ namespace Kernel
             return allocated_chunks() * CHUNK_SIZE; 
         }
 
+        /**
+         * @return size_t 
+         */
+        size_t in_place_reallocations() const
+        {
+            size_t total = 0;
+            for (auto* subheap = &m_heaps; subheap; subheap = subheap->next)
+                total += subheap->heap.in_place_reallocations();
+            return total;
+        }
+
     private:
         SubHeap m_heaps;
         ExpandHeap m_expand;
         bool m_expanding { false };
     }; // class ExpandableHeap
 
+    /**
+     * @brief O(1) segregated free lists for small requests in front of a (bitmap) backing heap
+     * 
+     * @tparam BackingHeap 
+     */
+    template<typename BackingHeap>
+    class SizeClassedHeap 
+    {
+        MOD_MAKE_NONCOPYABLE(SizeClassedHeap);
+        MOD_MAKE_NONMOVABLE(SizeClassedHeap);
+
+        struct Run;
+
+        struct BlockHeader 
+        {
+            Run* run;
+            u8 data[0];
+        };
+
+        struct FreeBlock 
+        {
+            FreeBlock* next;
+        };
+
+        struct Run 
+        {
+            Run* prev { nullptr };
+            Run* next { nullptr };
+            FreeBlock* freelist { nullptr };
+            size_t class_index { 0 };
+            size_t free_blocks { 0 };
+            size_t total_blocks { 0 };
+        };
+
+        struct SizeClass 
+        {
+            size_t size { 0 };
+            Run* partial_runs { nullptr };
+            size_t allocated_blocks { 0 };
+            size_t free_blocks { 0 };
+        };
+
+        static constexpr size_t granule = 16;
+        static constexpr size_t min_run_size = 4 * KiB;
+        static constexpr size_t min_blocks_per_run = 8;
+
+    public:
+        static constexpr size_t size_classes[] = { 16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048 };
+        static constexpr size_t size_class_count = sizeof(size_classes) / sizeof(size_classes[0]);
+        static constexpr size_t max_small_size = size_classes[size_class_count - 1];
+
+#ifdef KMALLOC_SIZE_CLASS_COUNT
+        static_assert(size_class_count == KMALLOC_SIZE_CLASS_COUNT, "kmalloc_stats has one entry per size class");
+#endif
+
+        /**
+         * @tparam Args 
+         * @param args 
+         */
+        template<typename... Args>
+        SizeClassedHeap(Args&&... args)
+            : m_backing(forward<Args>(args)...)
+        {
+            size_t class_index = 0;
+            for (size_t i = 0; i <= max_small_size / granule; ++i) {
+                while (size_classes[class_index] < i * granule)
+                    ++class_index;
+                m_class_for_granule[i] = class_index;
+            }
+            for (size_t i = 0; i < size_class_count; ++i)
+                m_classes[i].size = size_classes[i];
+        }
+
+        /**
+         * @return BackingHeap& 
+         */
+        BackingHeap& backing_heap() 
+        { 
+            return m_backing; 
+        }
+
+        /**
+         * @param size 
+         * @return void* 
+         */
+        void* allocate(size_t size)
+        {
+            if (size > max_small_size)
+                return allocate_large(size);
+
+            auto& size_class = m_classes[m_class_for_granule[(size + granule - 1) / granule]];
+            Run* run = size_class.partial_runs;
+            if (!run) {
+                run = allocate_run(size_class);
+                if (!run)
+                    return allocate_large(size);
+            }
+
+            FreeBlock* block = run->freelist;
+            run->freelist = block->next;
+            if (--run->free_blocks == 0)
+                unlink_run(size_class, *run);
+
+            size_class.allocated_blocks++;
+            size_class.free_blocks--;
+
+            auto* header = (BlockHeader*)block;
+            header->run = run;
+            return header->data;
+        }
+
+        /**
+         * @param ptr 
+         */
+        void deallocate(void* ptr)
+        {
+            if (!ptr)
+                return;
+
+            auto* header = (BlockHeader*)((u8*)ptr - sizeof(BlockHeader));
+            Run* run = header->run;
+            if (!run) {
+                m_backing.deallocate(header);
+                return;
+            }
+
+            auto& size_class = m_classes[run->class_index];
+            auto* block = (FreeBlock*)header;
+            block->next = run->freelist;
+            run->freelist = block;
+            if (run->free_blocks++ == 0)
+                link_run(size_class, *run);
+
+            size_class.allocated_blocks--;
+            size_class.free_blocks++;
+
+            if (run->free_blocks == run->total_blocks && (run->prev || run->next)) {
+                unlink_run(size_class, *run);
+                size_class.free_blocks -= run->total_blocks;
+                m_backing.deallocate(run);
+            }
+        }
+
+        /**
+         * @param ptr 
+         * @param new_size 
+         * @return void* 
+         */
+        void* reallocate(void* ptr, size_t new_size)
+        {
+            if (!ptr)
+                return allocate(new_size);
+
+            auto* header = (BlockHeader*)((u8*)ptr - sizeof(BlockHeader));
+            if (!header->run) {
+                auto* new_header = (BlockHeader*)m_backing.reallocate(header, sizeof(BlockHeader) + new_size);
+                return new_header ? new_header->data : nullptr;
+            }
+
+            size_t old_size = m_classes[header->run->class_index].size;
+            if (new_size <= old_size) {
+                m_in_place_reallocations++;
+                return ptr;
+            }
+
+            void* new_ptr = allocate(new_size);
+            if (!new_ptr)
+                return nullptr;
+            __builtin_memcpy(new_ptr, ptr, old_size);
+            deallocate(ptr);
+            return new_ptr;
+        }
+
+        /**
+         * @param ptr 
+         * @return true 
+         * @return false 
+         */
+        bool contains(const void* ptr) const
+        {
+            return m_backing.contains(ptr);
+        }
+
+        /**
+         * @brief callback(size, allocated_blocks, free_blocks) for every size class
+         * 
+         * @tparam Callback 
+         * @param callback 
+         */
+        template<typename Callback>
+        void for_each_size_class(Callback callback) const
+        {
+            for (auto& size_class : m_classes)
+                callback(size_class.size, size_class.allocated_blocks, size_class.free_blocks);
+        }
+
+        /**
+         * @return size_t 
+         */
+        size_t total_bytes() const 
+        { 
+            return m_backing.total_bytes(); 
+        }
+
+        /**
+         * @return size_t 
+         */
+        size_t free_bytes() const 
+        { 
+            return m_backing.free_bytes(); 
+        }
+
+        /**
+         * @return size_t 
+         */
+        size_t allocated_bytes() const 
+        { 
+            return m_backing.allocated_bytes(); 
+        }
+
+        /**
+         * @return size_t 
+         */
+        size_t in_place_reallocations() const 
+        { 
+            return m_in_place_reallocations + m_backing.in_place_reallocations(); 
+        }
+
+    private:
+        /**
+         * @param size 
+         * @return void* 
+         */
+        void* allocate_large(size_t size)
+        {
+            auto* header = (BlockHeader*)m_backing.allocate(sizeof(BlockHeader) + size);
+            if (!header)
+                return nullptr;
+            header->run = nullptr;
+            return header->data;
+        }
+
+        /**
+         * @param size_class 
+         * @return Run* 
+         */
+        Run* allocate_run(SizeClass& size_class)
+        {
+            size_t block_size = sizeof(BlockHeader) + size_class.size;
+            size_t run_size = max(min_run_size, sizeof(Run) + min_blocks_per_run * block_size);
+            void* memory = m_backing.allocate(run_size);
+            if (!memory)
+                return nullptr;
+
+            auto* run = new (memory) Run;
+            run->class_index = &size_class - m_classes;
+            run->total_blocks = (run_size - sizeof(Run)) / block_size;
+            run->free_blocks = run->total_blocks;
+
+            u8* blocks = (u8*)(run + 1);
+            for (size_t i = run->total_blocks; i > 0; --i) {
+                auto* block = (FreeBlock*)(blocks + (i - 1) * block_size);
+                block->next = run->freelist;
+                run->freelist = block;
+            }
+
+            size_class.free_blocks += run->total_blocks;
+            link_run(size_class, *run);
+            return run;
+        }
+
+        /**
+         * @param size_class 
+         * @param run 
+         */
+        static void link_run(SizeClass& size_class, Run& run)
+        {
+            run.prev = nullptr;
+            run.next = size_class.partial_runs;
+            if (run.next)
+                run.next->prev = &run;
+            size_class.partial_runs = &run;
+        }
+
+        /**
+         * @param size_class 
+         * @param run 
+         */
+        static void unlink_run(SizeClass& size_class, Run& run)
+        {
+            if (run.prev)
+                run.prev->next = run.next;
+            else
+                size_class.partial_runs = run.next;
+            if (run.next)
+                run.next->prev = run.prev;
+            run.prev = nullptr;
+            run.next = nullptr;
+        }
+
+        BackingHeap m_backing;
+        SizeClass m_classes[size_class_count];
+        size_t m_in_place_reallocations { 0 };
+        u8 m_class_for_granule[max_small_size / granule + 1];
+    }; // class SizeClassedHeap
+
 } // namespace Kernel
@@ -0,0 +1,339 @@
+/**
+ * @file kmalloc.cpp
+ * @author Krisna Pranav
+ * @brief kmalloc
+ * @version 6.0
+ * @date 2023-06-29
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <mods/assertions.h>
+#include <mods/nonnullownptrvector.h>
+#include <mods/stdlibextra.h>
+#include <mods/temporarychange.h>
+#include <mods/types.h>
+#include <kernel/arch/i386/cpu.h>
+#include <kernel/heap/heap.h>
+#include <kernel/heap/kmalloc.h>
+#include <kernel/kstdio.h>
+#include <kernel/ksyms.h>
+#include <kernel/spinlock.h>
+#include <kernel/stdlib.h>
+#include <kernel/vm/memorymanager.h>
+
+#define CHUNK_SIZE 32
+#define POOL_SIZE (2 * MiB)
+#define ETERNAL_RANGE_SIZE (2 * MiB)
+
+namespace Kernel
+{
+
+    // recursive because dump_backtrace() may kmalloc
+    static RecursiveSpinLock s_lock;
+
+    static void kmalloc_allocate_backup_memory();
+
+    struct KmallocGlobalHeap
+    {
+        struct ExpandGlobalHeap
+        {
+            KmallocGlobalHeap& m_global_heap;
+
+            /**
+             * @param global_heap
+             */
+            ExpandGlobalHeap(KmallocGlobalHeap& global_heap)
+                : m_global_heap(global_heap)
+            {
+            }
+
+            /**
+             * @brief the backup region is added first, because by now a kmalloc for
+             *        anything else may fail. A new backup is allocated afterwards
+             *
+             * @param allocation_request
+             * @return true
+             * @return false
+             */
+            bool add_memory(size_t allocation_request)
+            {
+                if (!MemoryManager::is_initialized()) {
+                    klog() << "kmalloc(): Cannot expand heap before MM is initialized!";
+                    return false;
+                }
+
+                auto region = move(m_global_heap.m_backup_memory);
+                if (!region) {
+                    klog() << "kmalloc(): Cannot expand heap: no backup memory";
+                    return false;
+                }
+
+                klog() << "kmalloc(): Adding memory to heap at " << region->vaddr() << ", bytes: " << region->size();
+
+                auto& subheap = m_global_heap.backing_heap().add_subheap(region->vaddr().as_ptr(), region->size());
+                m_global_heap.m_subheap_memory.append(region.release_nonnull());
+
+                // the expansion may run with other spinlocks held, so the new backup is deferred
+                Processor::current().deferred_call_queue(kmalloc_allocate_backup_memory);
+
+                if (subheap.free_bytes() >= allocation_request)
+                    return true;
+
+                size_t memory_size = PAGE_ROUND_UP(BackingHeapType::calculate_memory_for_bytes(allocation_request)) + 1 * MiB;
+                region = MM.allocate_kernel_region(memory_size, "kmalloc subheap", Region::Access::Read | Region::Access::Write);
+                if (!region) {
+                    klog() << "kmalloc(): Could not expand heap to satisfy allocation of " << allocation_request << " bytes";
+                    return false;
+                }
+
+                klog() << "kmalloc(): Adding even more memory to heap at " << region->vaddr() << ", bytes: " << region->size();
+                m_global_heap.backing_heap().add_subheap(region->vaddr().as_ptr(), region->size());
+                m_global_heap.m_subheap_memory.append(region.release_nonnull());
+                return true;
+            }
+
+            /**
+             * @param memory
+             * @return true
+             * @return false
+             */
+            bool remove_memory(void* memory)
+            {
+                for (size_t i = 0; i < m_global_heap.m_subheap_memory.size(); i++) {
+                    if (m_global_heap.m_subheap_memory[i].vaddr().as_ptr() == memory) {
+                        auto region = m_global_heap.m_subheap_memory.take(i);
+                        klog() << "kmalloc(): Removing memory from heap at " << region->vaddr() << ", bytes: " << region->size();
+                        return true;
+                    }
+                }
+                klog() << "kmalloc(): Cannot remove memory from heap: " << VirtualAddress(memory);
+                return false;
+            }
+        }; // struct ExpandGlobalHeap
+
+        typedef ExpandableHeap<CHUNK_SIZE, KMALLOC_SCRUB_BYTE, KFREE_SCRUB_BYTE, ExpandGlobalHeap> BackingHeapType;
+        typedef SizeClassedHeap<BackingHeapType> HeapType;
+
+        HeapType m_heap;
+        NonnullOwnPtrVector<Region> m_subheap_memory;
+        OwnPtr<Region> m_backup_memory;
+
+        /**
+         * @param memory
+         * @param memory_size
+         */
+        KmallocGlobalHeap(u8* memory, size_t memory_size)
+            : m_heap(memory, memory_size, ExpandGlobalHeap(*this))
+        {
+        }
+
+        /**
+         * @return BackingHeapType&
+         */
+        BackingHeapType& backing_heap()
+        {
+            return m_heap.backing_heap();
+        }
+
+        void allocate_backup_memory()
+        {
+            if (m_backup_memory)
+                return;
+            m_backup_memory = MM.allocate_kernel_region(1 * MiB, "kmalloc subheap", Region::Access::Read | Region::Access::Write);
+        }
+
+        /**
+         * @return size_t
+         */
+        size_t backup_memory_bytes() const
+        {
+            return m_backup_memory ? m_backup_memory->size() : 0;
+        }
+    }; // struct KmallocGlobalHeap
+
+    static KmallocGlobalHeap* g_kmalloc_global;
+    alignas(KmallocGlobalHeap) static u8 g_kmalloc_global_heap[sizeof(KmallocGlobalHeap)];
+
+    /// @brief kmalloc_allocate_backup_memory
+    static void kmalloc_allocate_backup_memory()
+    {
+        g_kmalloc_global->allocate_backup_memory();
+    }
+
+} // namespace Kernel
+
+using namespace Kernel;
+
+// the heap is kept apart from .bss
+__attribute__((section(".heap"))) static u8 kmalloc_eternal_heap[ETERNAL_RANGE_SIZE];
+__attribute__((section(".heap"))) static u8 kmalloc_pool_heap[POOL_SIZE];
+
+u8* const kmalloc_start = kmalloc_eternal_heap;
+u8* const kmalloc_end = kmalloc_pool_heap + POOL_SIZE;
+
+static size_t g_kmalloc_bytes_eternal = 0;
+static size_t g_kmalloc_call_count;
+static size_t g_kfree_call_count;
+static size_t g_krealloc_call_count;
+bool g_dump_kmalloc_stacks;
+
+static u8* s_next_eternal_ptr;
+static u8* s_end_of_eternal_range;
+
+/// @brief kmalloc_enable_expand
+void kmalloc_enable_expand()
+{
+    g_kmalloc_global->allocate_backup_memory();
+}
+
+/// @brief kmalloc_init
+void kmalloc_init()
+{
+    memset(kmalloc_eternal_heap, 0, sizeof(kmalloc_eternal_heap));
+    memset(kmalloc_pool_heap, 0, sizeof(kmalloc_pool_heap));
+    g_kmalloc_global = new (g_kmalloc_global_heap) KmallocGlobalHeap(kmalloc_pool_heap, sizeof(kmalloc_pool_heap));
+
+    s_lock.initialize();
+
+    s_next_eternal_ptr = kmalloc_eternal_heap;
+    s_end_of_eternal_range = s_next_eternal_ptr + sizeof(kmalloc_eternal_heap);
+}
+
+/**
+ * @param size
+ * @return void*
+ */
+void* kmalloc_eternal(size_t size)
+{
+    size = round_up_to_power_of_two(size, sizeof(void*));
+
+    ScopedSpinLock lock(s_lock);
+    void* ptr = s_next_eternal_ptr;
+    s_next_eternal_ptr += size;
+    ASSERT(s_next_eternal_ptr < s_end_of_eternal_range);
+    g_kmalloc_bytes_eternal += size;
+    return ptr;
+}
+
+/**
+ * @param size
+ * @return void*
+ */
+void* kmalloc_impl(size_t size)
+{
+    ScopedSpinLock lock(s_lock);
+    ++g_kmalloc_call_count;
+
+    if (g_dump_kmalloc_stacks && Kernel::g_kernel_symbols_available) {
+        dbg() << "kmalloc(" << size << ")";
+        Kernel::dump_backtrace();
+    }
+
+    void* ptr = g_kmalloc_global->m_heap.allocate(size);
+    if (!ptr) {
+        klog() << "kmalloc(): PANIC! Out of memory (no suitable block for size " << size << ")";
+        Kernel::dump_backtrace();
+        Processor::halt();
+    }
+
+    return ptr;
+}
+
+/**
+ * @param ptr
+ */
+void kfree(void* ptr)
+{
+    if (!ptr)
+        return;
+
+    ScopedSpinLock lock(s_lock);
+    ++g_kfree_call_count;
+
+    g_kmalloc_global->m_heap.deallocate(ptr);
+}
+
+/**
+ * @param ptr
+ * @param new_size
+ * @return void*
+ */
+void* krealloc(void* ptr, size_t new_size)
+{
+    ScopedSpinLock lock(s_lock);
+    ++g_krealloc_call_count;
+    return g_kmalloc_global->m_heap.reallocate(ptr, new_size);
+}
+
+/**
+ * @param size
+ * @return void*
+ */
+void* operator new(size_t size)
+{
+    return kmalloc(size);
+}
+
+/**
+ * @param size
+ * @return void*
+ */
+void* operator new[](size_t size)
+{
+    return kmalloc(size);
+}
+
+/**
+ * @param ptr
+ */
+void operator delete(void* ptr) noexcept
+{
+    return kfree(ptr);
+}
+
+/**
+ * @param ptr
+ */
+void operator delete(void* ptr, size_t) noexcept
+{
+    return kfree(ptr);
+}
+
+/**
+ * @param ptr
+ */
+void operator delete[](void* ptr) noexcept
+{
+    return kfree(ptr);
+}
+
+/**
+ * @param ptr
+ */
+void operator delete[](void* ptr, size_t) noexcept
+{
+    return kfree(ptr);
+}
+
+/**
+ * @param stats
+ */
+void get_kmalloc_stats(kmalloc_stats& stats)
+{
+    ScopedSpinLock lock(s_lock);
+    auto& heap = g_kmalloc_global->m_heap;
+    stats.bytes_allocated = heap.allocated_bytes();
+    stats.bytes_free = heap.free_bytes() + g_kmalloc_global->backup_memory_bytes();
+    stats.bytes_eternal = g_kmalloc_bytes_eternal;
+    stats.kmalloc_call_count = g_kmalloc_call_count;
+    stats.kfree_call_count = g_kfree_call_count;
+    stats.krealloc_call_count = g_krealloc_call_count;
+    stats.krealloc_in_place_count = heap.in_place_reallocations();
+
+    size_t class_index = 0;
+    heap.for_each_size_class([&](size_t size, size_t blocks_allocated, size_t blocks_free) {
+        stats.size_classes[class_index++] = { size, blocks_allocated, blocks_free };
+    });
+}
@@ -35,12 +35,24 @@ void* krealloc(void*, size_t);
 
 void kfree(void*);
 
+/// @brief number of SizeClassedHeap size classes, checked against it in heap.h
+#define KMALLOC_SIZE_CLASS_COUNT 14
+
+struct kmalloc_size_class_stats {
+    size_t size;
+    size_t blocks_allocated;
+    size_t blocks_free;
+};
+
 struct kmalloc_stats {
     size_t bytes_allocated;
     size_t bytes_free;
     size_t bytes_eternal;
     size_t kmalloc_call_count;
     size_t kfree_call_count;
+    size_t krealloc_call_count;
+    size_t krealloc_in_place_count;
+    kmalloc_size_class_stats size_classes[KMALLOC_SIZE_CLASS_COUNT];
 };
 
 /**
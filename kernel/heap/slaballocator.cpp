@@ -0,0 +1,349 @@
+/**
+ * @file slaballocator.cpp
+ * @author Krisna Pranav
+ * @brief slaballocator
+ * @version 6.0
+ * @date 2023-07-10
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <mods/assertions.h>
+#include <kernel/arch/i386/cpu.h>
+#include <kernel/heap/kmalloc.h>
+#include <kernel/heap/slaballocator.h>
+#include <kernel/spinlock.h>
+#include <kernel/stdlib.h>
+#include <kernel/vm/region.h>
+
+namespace Kernel
+{
+
+    /**
+     * @tparam templated_slab_size
+     */
+    template<size_t templated_slab_size>
+    class SlabAllocator
+    {
+    public:
+        SlabAllocator() = default;
+
+        /**
+         * @param size
+         */
+        void init(size_t size)
+        {
+            m_base = kmalloc_eternal(size);
+            m_end = (u8*)m_base + size;
+            FreeSlab* slabs = (FreeSlab*)m_base;
+            m_slab_count = size / templated_slab_size;
+            for (size_t i = 1; i < m_slab_count; ++i) {
+                slabs[i].next = &slabs[i - 1];
+            }
+            slabs[0].next = nullptr;
+            m_freelist = &slabs[m_slab_count - 1];
+            m_num_allocated = 0;
+        }
+
+        /**
+         * @return size_t
+         */
+        constexpr size_t slab_size() const
+        {
+            return templated_slab_size;
+        }
+
+        /**
+         * @return size_t
+         */
+        size_t slab_count() const
+        {
+            return m_slab_count;
+        }
+
+        /**
+         * @param ptr
+         * @return true
+         * @return false
+         */
+        bool contains(const void* ptr) const
+        {
+            return ptr >= m_base && ptr < m_end;
+        }
+
+        /**
+         * @brief pop up to count slabs from the depot under a single lock hold
+         *
+         * @param slabs
+         * @param count
+         * @return size_t
+         */
+        size_t alloc_batch(void** slabs, size_t count)
+        {
+            ScopedSpinLock lock(m_lock);
+            size_t taken = 0;
+            while (taken < count && m_freelist) {
+                FreeSlab* free_slab = m_freelist;
+                m_freelist = free_slab->next;
+                slabs[taken++] = free_slab;
+            }
+            m_num_allocated += taken;
+            return taken;
+        }
+
+        /**
+         * @brief push count slabs back onto the depot under a single lock hold
+         *
+         * @param slabs
+         * @param count
+         */
+        void dealloc_batch(void* const* slabs, size_t count)
+        {
+            ScopedSpinLock lock(m_lock);
+            for (size_t i = 0; i < count; ++i) {
+                FreeSlab* free_slab = (FreeSlab*)slabs[i];
+                free_slab->next = m_freelist;
+                m_freelist = free_slab;
+            }
+            ASSERT(m_num_allocated >= count);
+            m_num_allocated -= count;
+        }
+
+        /**
+         * @return void*
+         */
+        void* alloc()
+        {
+            void* ptr;
+            if (!alloc_batch(&ptr, 1))
+                return kmalloc(slab_size());
+            return ptr;
+        }
+
+        /**
+         * @param ptr
+         */
+        void dealloc(void* ptr)
+        {
+            ASSERT(ptr);
+            if (!contains(ptr)) {
+                kfree(ptr);
+                return;
+            }
+            dealloc_batch(&ptr, 1);
+        }
+
+        /**
+         * @return size_t
+         */
+        size_t num_allocated() const
+        {
+            return m_num_allocated;
+        }
+
+        /**
+         * @return size_t
+         */
+        size_t num_free() const
+        {
+            return m_slab_count - m_num_allocated;
+        }
+
+    private:
+        struct FreeSlab
+        {
+            FreeSlab* next { nullptr };
+            char padding[templated_slab_size - sizeof(FreeSlab*)];
+        };
+
+        SpinLock<u8> m_lock;
+        FreeSlab* m_freelist { nullptr };
+        size_t m_num_allocated { 0 };
+        size_t m_slab_count { 0 };
+        void* m_base { nullptr };
+        void* m_end { nullptr };
+
+        static_assert(sizeof(FreeSlab) == templated_slab_size);
+    }; // class SlabAllocator
+
+    static SlabAllocator<16> s_slab_allocator_16;
+    static SlabAllocator<32> s_slab_allocator_32;
+    static SlabAllocator<64> s_slab_allocator_64;
+    static SlabAllocator<128> s_slab_allocator_128;
+
+    static_assert(sizeof(Region) <= s_slab_allocator_128.slab_size());
+
+    /**
+     * @brief the owning processor is the only writer, so a relaxed load and store is
+     *        enough and avoids a locked instruction on the fast path
+     *
+     * @param counter
+     * @param delta
+     */
+    static ALWAYS_INLINE void bump(Atomic<size_t>& counter, size_t delta = 1)
+    {
+        counter.store(counter.load(Mods::MemoryOrder::memory_order_relaxed) + delta, Mods::MemoryOrder::memory_order_relaxed);
+    }
+
+    /**
+     * @tparam Callback
+     * @param callback
+     */
+    template<typename Callback>
+    static void for_each_allocator(Callback callback)
+    {
+        callback(s_slab_allocator_16, 0);
+        callback(s_slab_allocator_32, 1);
+        callback(s_slab_allocator_64, 2);
+        callback(s_slab_allocator_128, 3);
+    }
+
+    /**
+     * @tparam Allocator
+     * @param allocator
+     * @param class_index
+     * @return void*
+     */
+    template<typename Allocator>
+    static void* magazine_alloc(Allocator& allocator, size_t class_index)
+    {
+        if (!Processor::is_initialized())
+            return allocator.alloc();
+
+        void* ptr;
+        {
+            ScopedCritical critical;
+            auto& magazine = Processor::current().get_slab_data().magazines[class_index];
+            size_t count = magazine.count.load(Mods::MemoryOrder::memory_order_relaxed);
+            if (count == 0) {
+                bump(magazine.misses);
+                count = allocator.alloc_batch(magazine.rounds, slab_magazine_batch);
+                if (count == 0)
+                    return kmalloc(allocator.slab_size());
+            } else {
+                bump(magazine.hits);
+            }
+            ptr = magazine.rounds[--count];
+            magazine.count.store(count, Mods::MemoryOrder::memory_order_relaxed);
+        }
+
+    #ifdef SANITIZE_SLABS
+        memset(ptr, SLAB_ALLOC_SCRUB_BYTE, allocator.slab_size());
+    #endif
+        return ptr;
+    }
+
+    /**
+     * @tparam Allocator
+     * @param allocator
+     * @param class_index
+     * @param ptr
+     */
+    template<typename Allocator>
+    static void magazine_dealloc(Allocator& allocator, size_t class_index, void* ptr)
+    {
+        ASSERT(ptr);
+        if (!allocator.contains(ptr)) {
+            kfree(ptr);
+            return;
+        }
+
+    #ifdef SANITIZE_SLABS
+        memset(ptr, SLAB_DEALLOC_SCRUB_BYTE, allocator.slab_size());
+    #endif
+
+        if (!Processor::is_initialized()) {
+            allocator.dealloc(ptr);
+            return;
+        }
+
+        ScopedCritical critical;
+        auto& magazine = Processor::current().get_slab_data().magazines[class_index];
+        size_t count = magazine.count.load(Mods::MemoryOrder::memory_order_relaxed);
+        if (count == slab_magazine_capacity) {
+            bump(magazine.misses);
+            allocator.dealloc_batch(magazine.rounds, slab_magazine_batch);
+            memmove(magazine.rounds, magazine.rounds + slab_magazine_batch, (slab_magazine_capacity - slab_magazine_batch) * sizeof(void*));
+            count -= slab_magazine_batch;
+        } else {
+            bump(magazine.hits);
+        }
+        magazine.rounds[count++] = ptr;
+        magazine.count.store(count, Mods::MemoryOrder::memory_order_relaxed);
+    }
+
+    /// @brief slab_alloc_init
+    void slab_alloc_init()
+    {
+        s_slab_allocator_16.init(128 * KiB);
+        s_slab_allocator_32.init(128 * KiB);
+        s_slab_allocator_64.init(512 * KiB);
+        s_slab_allocator_128.init(512 * KiB);
+    }
+
+    /**
+     * @param slab_size
+     * @return void*
+     */
+    void* slab_alloc(size_t slab_size)
+    {
+        if (slab_size <= 16)
+            return magazine_alloc(s_slab_allocator_16, 0);
+        if (slab_size <= 32)
+            return magazine_alloc(s_slab_allocator_32, 1);
+        if (slab_size <= 64)
+            return magazine_alloc(s_slab_allocator_64, 2);
+        if (slab_size <= 128)
+            return magazine_alloc(s_slab_allocator_128, 3);
+        ASSERT_NOT_REACHED();
+    }
+
+    /**
+     * @param ptr
+     * @param slab_size
+     */
+    void slab_dealloc(void* ptr, size_t slab_size)
+    {
+        if (slab_size <= 16)
+            return magazine_dealloc(s_slab_allocator_16, 0, ptr);
+        if (slab_size <= 32)
+            return magazine_dealloc(s_slab_allocator_32, 1, ptr);
+        if (slab_size <= 64)
+            return magazine_dealloc(s_slab_allocator_64, 2, ptr);
+        if (slab_size <= 128)
+            return magazine_dealloc(s_slab_allocator_128, 3, ptr);
+        ASSERT_NOT_REACHED();
+    }
+
+    /**
+     * @param callback
+     */
+    void slab_alloc_stats(Function<void(size_t slab_size, size_t allocated, size_t free)> callback)
+    {
+        for_each_allocator([&](auto& allocator, size_t class_index) {
+            size_t cached = 0;
+            Processor::for_each([&](Processor& processor) {
+                cached += processor.get_slab_data().magazines[class_index].count.load(Mods::MemoryOrder::memory_order_relaxed);
+                return IterDecision::Continue;
+            });
+            size_t allocated = allocator.num_allocated() - cached;
+            callback(allocator.slab_size(), allocated, allocator.slab_count() - allocated);
+        });
+    }
+
+    /**
+     * @param callback
+     */
+    void slab_alloc_per_cpu_stats(Function<void(u32 cpu, size_t slab_size, size_t hits, size_t misses)> callback)
+    {
+        Processor::for_each([&](Processor& processor) {
+            for_each_allocator([&](auto& allocator, size_t class_index) {
+                auto& magazine = processor.get_slab_data().magazines[class_index];
+                callback(processor.id(), allocator.slab_size(), magazine.hits.load(Mods::MemoryOrder::memory_order_relaxed), magazine.misses.load(Mods::MemoryOrder::memory_order_relaxed));
+            });
+            return IterDecision::Continue;
+        });
+    }
+
+} // namespace Kernel
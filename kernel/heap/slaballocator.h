@@ -11,6 +11,7 @@
 
 #pragma once
 
+#include <mods/atomic.h>
 #include <mods/function.h>
 #include <mods/types.h>
 
@@ -23,6 +24,29 @@ namespace Kernel
     /// @brief SLAB_DEALLOc
     #define SLAB_DEALLOC_SCRUB_BYTE 0xbc
 
+    /// @brief rounds held by one per-cpu magazine, refills and drains move half of it
+    static constexpr size_t slab_magazine_capacity = 32;
+    static constexpr size_t slab_magazine_batch = slab_magazine_capacity / 2;
+    static constexpr size_t slab_size_class_count = 4;
+
+    /**
+     * @brief only the owning processor writes a magazine, the counters are atomics so
+     *        the stats can read them from any processor without a lock
+     */
+    struct SlabMagazine
+    {
+        void* rounds[slab_magazine_capacity];
+        Atomic<size_t> count { 0 };
+        Atomic<size_t> hits { 0 };
+        Atomic<size_t> misses { 0 };
+    }; // struct SlabMagazine
+
+    /// @brief lives inside Processor, so every processor has its magazines from the start
+    struct SlabAllocatorPerProcessorData
+    {
+        SlabMagazine magazines[slab_size_class_count];
+    }; // struct SlabAllocatorPerProcessorData
+
     /**
      * @param slab_size 
      * @return void* 
@@ -43,6 +67,12 @@ namespace Kernel
      */
     void slab_alloc_stats(Function<void(size_t slab_size, size_t allocated, size_t free)>);
 
+    /**
+     * @brief per-cpu magazine hits (served without touching the depot) and misses (refill/drain)
+     * 
+     */
+    void slab_alloc_per_cpu_stats(Function<void(u32 cpu, size_t slab_size, size_t hits, size_t misses)>);
+
     /// @brief ALLOCATED(type)
     #define MAKE_SLAB_ALLOCATED(type)                                        \
     public:                                                                  \
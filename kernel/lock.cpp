@@ -0,0 +1,317 @@
+/**
+ * @file lock.cpp
+ * @author Krisna Pranav
+ * @brief lock
+ * @version 6.0
+ * @date 2023-09-14
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <kernel/lock.h>
+#include <kernel/spinlock.h>
+#include <kernel/thread.h>
+
+namespace Kernel
+{
+
+    /**
+     * @param name
+     */
+    Lock::Lock(const char* name)
+        : m_name(name)
+    {
+    }
+
+    /// @brief Destroy the Lock object
+    Lock::~Lock()
+    {
+    }
+
+    /**
+     * @param thread
+     * @return Lock::SharedHolder*
+     */
+    Lock::SharedHolder* Lock::find_shared_holder(Thread* thread)
+    {
+        for (auto& holder : m_shared_holders) {
+            if (holder.thread == thread)
+                return &holder;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @param thread
+     */
+    void Lock::add_shared_holder(Thread* thread)
+    {
+        ASSERT(m_shared_holder_count < max_shared_holders);
+        auto* holder = find_shared_holder(nullptr);
+        ASSERT(holder);
+        holder->thread = thread;
+        holder->count = 0;
+        m_shared_holder_count++;
+    }
+
+    /**
+     * @brief only called with m_lock held, which keeps m_holder alive
+     *
+     * @param current_thread
+     * @return true
+     * @return false
+     */
+    bool Lock::should_spin(Thread* current_thread) const
+    {
+        if (Processor::count() <= 1)
+            return false;
+
+        auto* holder = m_holder.ptr();
+        if (!holder || holder == current_thread)
+            return false;
+
+        return holder->state() == Thread::Running && holder->cpu() != Processor::current().id();
+    }
+
+    /**
+     * @param wake_writer
+     * @param wake_readers
+     */
+    void Lock::select_waiters_to_wake(bool& wake_writer, bool& wake_readers) const
+    {
+        ASSERT(m_lock.load(Mods::memory_order_relaxed));
+        ASSERT(m_mode == Mode::Unlocked);
+        wake_writer = m_exclusive_waiters > 0;
+        wake_readers = !wake_writer && m_shared_waiters > 0;
+    }
+
+    /**
+     * @param mode
+     */
+    void Lock::lock(Mode mode)
+    {
+        ASSERT(mode != Mode::Unlocked);
+        ASSERT(!Processor::current().in_irq());
+
+        auto current_thread = Thread::current();
+        bool contended = false;
+        bool did_sleep = false;
+        bool waiting = false;
+        u32 spins = 0;
+        u64 wait_start = 0;
+
+        for (;;) {
+            bool spin;
+            {
+                ScopedCritical critical;
+                bool expected = false;
+                if (!m_lock.compare_exchange_strong(expected, true, Mods::memory_order_acq_rel)) {
+                    Processor::wait_check();
+                    continue;
+                }
+
+                if (waiting) {
+                    if (mode == Mode::Exclusive)
+                        m_exclusive_waiters--;
+                    else
+                        m_shared_waiters--;
+                    waiting = false;
+                }
+
+                bool can_lock = false;
+                switch (m_mode) {
+                case Mode::Unlocked:
+                    can_lock = mode == Mode::Exclusive || m_exclusive_waiters == 0;
+                    break;
+                case Mode::Shared: {
+                    auto* holder = find_shared_holder(current_thread);
+                    ASSERT(mode == Mode::Shared || !holder);
+                    can_lock = mode == Mode::Shared && (holder || (m_exclusive_waiters == 0 && m_shared_holder_count < max_shared_holders));
+                    break;
+                }
+                case Mode::Exclusive:
+                    can_lock = m_holder == current_thread;
+                    break;
+                }
+
+                if (can_lock) {
+                    if (m_mode == Mode::Exclusive) {
+                        ASSERT(m_times_locked > 0);
+                    } else if (mode == Mode::Exclusive) {
+                        ASSERT(m_times_locked == 0);
+                        m_mode = Mode::Exclusive;
+                        m_holder = current_thread;
+                    } else {
+                        m_mode = Mode::Shared;
+                        auto* holder = find_shared_holder(current_thread);
+                        if (!holder) {
+                            add_shared_holder(current_thread);
+                            holder = find_shared_holder(current_thread);
+                        }
+                        holder->count++;
+                    }
+                    m_times_locked++;
+
+                    m_statistics.acquisitions++;
+                    if (contended) {
+                        m_statistics.contended_acquisitions++;
+                        if (!did_sleep)
+                            m_statistics.spin_acquisitions++;
+                        m_statistics.wait_cycles += read_tsc() - wait_start;
+                    }
+
+                    // a wake_all that raced with a reader going to sleep is only remembered
+                    // once by m_shared_queue, so each admitted reader passes it on
+                    bool wake_readers = m_mode == Mode::Shared && m_shared_waiters > 0 && m_exclusive_waiters == 0 && m_shared_holder_count < max_shared_holders;
+                    m_lock.store(false, Mods::memory_order_release);
+                    if (wake_readers)
+                        m_shared_queue.wake_all();
+                    return;
+                }
+
+                if (!contended) {
+                    contended = true;
+                    wait_start = read_tsc();
+                }
+
+                spin = spins < adaptive_spin_limit && should_spin(current_thread);
+                if (!spin) {
+                    waiting = true;
+                    if (mode == Mode::Exclusive)
+                        m_exclusive_waiters++;
+                    else
+                        m_shared_waiters++;
+                }
+                m_lock.store(false, Mods::memory_order_release);
+            }
+
+            if (spin) {
+                ++spins;
+                for (size_t i = 0; i < (1u << min(spins, 5u)); ++i)
+                    asm volatile("pause");
+                continue;
+            }
+
+            did_sleep = true;
+            if (mode == Mode::Exclusive)
+                m_queue.wait_on({}, m_name);
+            else
+                m_shared_queue.wait_on({}, m_name);
+        }
+    }
+
+#ifdef LOCK_DEBUG
+    /**
+     * @param file
+     * @param line
+     * @param mode
+     */
+    void Lock::lock(const char* file, int line, Mode mode)
+    {
+        dbg() << "Lock @ " << this << " (" << m_name << "): locked from " << file << ":" << line;
+        lock(mode);
+    }
+#endif
+
+    void Lock::unlock()
+    {
+        auto current_thread = Thread::current();
+        bool wake_writer = false;
+        bool wake_readers = false;
+
+        {
+            ScopedCritical critical;
+            for (;;) {
+                bool expected = false;
+                if (m_lock.compare_exchange_strong(expected, true, Mods::memory_order_acq_rel))
+                    break;
+                Processor::wait_check();
+            }
+
+            ASSERT(m_mode != Mode::Unlocked);
+            ASSERT(m_times_locked);
+
+            bool freed_shared_slot = false;
+            if (m_mode == Mode::Exclusive) {
+                ASSERT(m_holder == current_thread);
+            } else {
+                auto* holder = find_shared_holder(current_thread);
+                ASSERT(holder && holder->count > 0);
+                if (--holder->count == 0) {
+                    holder->thread = nullptr;
+                    m_shared_holder_count--;
+                    freed_shared_slot = true;
+                }
+            }
+
+            if (--m_times_locked > 0) {
+                // a reader that waited for a free slot can come in now
+                wake_readers = freed_shared_slot && m_shared_waiters > 0 && m_exclusive_waiters == 0;
+                m_lock.store(false, Mods::memory_order_release);
+                if (wake_readers)
+                    m_shared_queue.wake_all();
+                return;
+            }
+
+            ASSERT(m_shared_holder_count == 0);
+            m_holder = nullptr;
+            m_mode = Mode::Unlocked;
+            select_waiters_to_wake(wake_writer, wake_readers);
+            m_lock.store(false, Mods::memory_order_release);
+        }
+
+        if (wake_writer)
+            m_queue.wake_one();
+        else if (wake_readers)
+            m_shared_queue.wake_all();
+    }
+
+    /**
+     * @return true
+     * @return false
+     */
+    bool Lock::force_unlock_if_locked()
+    {
+        bool wake_writer = false;
+        bool wake_readers = false;
+
+        {
+            ScopedCritical critical;
+            for (;;) {
+                bool expected = false;
+                if (m_lock.compare_exchange_strong(expected, true, Mods::memory_order_acq_rel))
+                    break;
+                Processor::wait_check();
+            }
+
+            ASSERT(m_mode != Mode::Shared);
+            if (m_holder != Thread::current()) {
+                m_lock.store(false, Mods::memory_order_release);
+                return false;
+            }
+
+            ASSERT(m_mode == Mode::Exclusive);
+            ASSERT(m_times_locked == 1);
+            m_holder = nullptr;
+            m_mode = Mode::Unlocked;
+            m_times_locked = 0;
+            select_waiters_to_wake(wake_writer, wake_readers);
+            m_lock.store(false, Mods::memory_order_release);
+        }
+
+        if (wake_writer)
+            m_queue.wake_one();
+        else if (wake_readers)
+            m_shared_queue.wake_all();
+        return true;
+    }
+
+    void Lock::clear_waiters()
+    {
+        ASSERT(m_mode != Mode::Shared);
+        m_queue.wake_all();
+        m_shared_queue.wake_all();
+    }
+
+} // namespace Kernel
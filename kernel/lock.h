@@ -16,24 +16,44 @@
 #include <kernel/thread.h>
 #include <kernel/waitqueue.h>
 #include <mods/atomic.h>
+#include <mods/function.h>
 #include <mods/types.h>
 #include <mods/assertions.h>
 
 namespace Kernel 
 {
 
+    struct LockStatistics 
+    {
+        u64 acquisitions { 0 };
+        u64 contended_acquisitions { 0 };
+        u64 spin_acquisitions { 0 };
+        u64 wait_cycles { 0 };
+    }; // struct LockStatistics
+
     class Lock 
     {
     public:
+        /**
+         * @brief a contended locker keeps retrying for up to this many pause rounds while the
+         *        holder is running on another processor, before it sleeps on m_queue
+         * 
+         */
+        static constexpr u32 adaptive_spin_limit = 64;
+
+        /**
+         * @brief distinct threads that can hold the lock Shared at once, further readers wait
+         *        for a slot like they would for a writer
+         * 
+         */
+        static constexpr size_t max_shared_holders = 16;
+
         /**
          * @param name 
          */
-        Lock(const char* name = nullptr)
-            : m_name(name)
-        {
-        }
+        Lock(const char* name = nullptr);
 
-        ~Lock() { }
+        ~Lock();
 
         enum class Mode 
         {
@@ -42,6 +62,13 @@ namespace Kernel
             Exclusive
         }; // enum 
         
+        /**
+         * @brief up to max_shared_holders threads may hold the lock Shared at once. Writers are preferred:
+         *        while one is waiting, new readers queue behind it unless they already hold the
+         *        lock Shared. The Exclusive holder may re-enter in either mode, but a Shared
+         *        holder may not upgrade.
+         * 
+         */
         void lock(Mode = Mode::Exclusive);
 
     #ifdef LOCK_DEBUG
@@ -67,7 +94,7 @@ namespace Kernel
          */
         bool is_locked() const 
         { 
-            return m_holder; 
+            return m_mode != Mode::Unlocked; 
         }
 
         void clear_waiters();
@@ -80,18 +107,73 @@ namespace Kernel
             return m_name; 
         }
 
+        /**
+         * @brief counters are only updated under m_lock, readers get a racy snapshot
+         * 
+         * @return const LockStatistics& 
+         */
+        const LockStatistics& statistics() const 
+        { 
+            return m_statistics; 
+        }
+
     private:
+        struct SharedHolder 
+        {
+            Thread* thread { nullptr };
+            u32 count { 0 };
+        }; // struct SharedHolder
+
+        /**
+         * @brief called with m_lock held
+         * 
+         * @param thread 
+         * @return SharedHolder* 
+         */
+        SharedHolder* find_shared_holder(Thread* thread);
+
+        /**
+         * @brief called with m_lock held, there has to be a free slot
+         * 
+         * @param thread 
+         */
+        void add_shared_holder(Thread* thread);
+
+        /**
+         * @param current_thread 
+         * @return true 
+         * @return false 
+         */
+        bool should_spin(Thread* current_thread) const;
+
+        /**
+         * @brief pick who to wake once the lock became free, called with m_lock held
+         * 
+         * @param wake_writer 
+         * @param wake_readers 
+         */
+        void select_waiters_to_wake(bool& wake_writer, bool& wake_readers) const;
+
         Atomic<bool> m_lock { false };
 
         const char* m_name { nullptr };
         
         WaitQueue m_queue;
+        WaitQueue m_shared_queue;
 
         Mode m_mode { Mode::Unlocked };
 
         u32 m_times_locked { 0 };
 
+        u32 m_exclusive_waiters { 0 };
+        u32 m_shared_waiters { 0 };
+
         RefPtr<Thread> m_holder;
+
+        SharedHolder m_shared_holders[max_shared_holders];
+        u32 m_shared_holder_count { 0 };
+
+        LockStatistics m_statistics;
     }; // class Lock 
 
     class Locker 
@@ -195,10 +277,36 @@ namespace Kernel
          */
         T lock_and_copy()
         {
-            LOCKER(m_lock);
+            LOCKER(m_lock, Lock::Mode::Shared);
             return m_resource;
         }
 
+        /**
+         * @brief run a read-only callback with the lock held Shared
+         * 
+         * @tparam Callback 
+         * @param callback 
+         * @return decltype(auto) 
+         */
+        template<typename Callback>
+        decltype(auto) with_shared(Callback callback)
+        {
+            LOCKER(m_lock, Lock::Mode::Shared);
+            return callback(const_cast<const T&>(m_resource));
+        }
+
+        /**
+         * @tparam Callback 
+         * @param callback 
+         * @return decltype(auto) 
+         */
+        template<typename Callback>
+        decltype(auto) with_exclusive(Callback callback)
+        {
+            LOCKER(m_lock);
+            return callback(m_resource);
+        }
+
     private:
 
         T m_resource;
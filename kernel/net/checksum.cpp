@@ -0,0 +1,242 @@
+/**
+ * @file checksum.cpp
+ * @author Krisna Pranav
+ * @brief internet checksum
+ * @version 6.0
+ * @date 2023-09-27
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <mods/simd.h>
+#include <mods/stdlibextra.h>
+#include <kernel/net/checksum.h>
+
+namespace Kernel
+{
+
+    /// @brief user memory copied and summed at a time, small enough to still be in L1 for the sum
+    static constexpr size_t user_copy_chunk_size = 1 * KiB;
+
+    /**
+     * @brief the sum only ever grows by 16-bit words and 2^16 is 1 mod 0xffff, so folding the
+     *        carries back in at the end gives the same result as doing it word by word
+     *
+     * @param sum
+     * @return u32
+     */
+    static u32 fold(u64 sum)
+    {
+        while (sum >> 16)
+            sum = (sum & 0xffff) + (sum >> 16);
+        return sum;
+    }
+
+#if defined(__SSE2__) || defined(__ARM_NEON)
+    /**
+     * @brief 32 bytes per round, split into the low and high word of every 32-bit lane so
+     *        the lanes can't overflow for max_rounds rounds. Words are summed in memory
+     *        order, byte order only matters once the folded sum is turned into a checksum
+     *
+     * @tparam copy
+     * @param source
+     * @param destination
+     * @param size
+     * @return u64
+     */
+    template<bool copy>
+    static u64 accumulate_vectors(const u8*& source, u8*& destination, size_t& size)
+    {
+        using Mods::SIMD::u32x4;
+
+        // each round adds at most 2 * 0xffff to a lane
+        static constexpr size_t max_rounds = 0x8000;
+
+        u64 sum = 0;
+        while (size >= 32) {
+            size_t rounds = min(size / 32, max_rounds);
+            u32x4 low = {};
+            u32x4 high = {};
+
+            for (size_t i = 0; i < rounds; ++i) {
+                u32x4 a;
+                u32x4 b;
+                __builtin_memcpy(&a, source, sizeof(a));
+                __builtin_memcpy(&b, source + sizeof(a), sizeof(b));
+                if constexpr (copy) {
+                    __builtin_memcpy(destination, &a, sizeof(a));
+                    __builtin_memcpy(destination + sizeof(a), &b, sizeof(b));
+                    destination += 32;
+                }
+                low += (a & 0xffff) + (b & 0xffff);
+                high += (a >> 16) + (b >> 16);
+                source += 32;
+            }
+
+            for (size_t lane = 0; lane < 4; ++lane)
+                sum += (u64)low[lane] + high[lane];
+            size -= rounds * 32;
+        }
+        return sum;
+    }
+#endif
+
+    /**
+     * @tparam copy
+     * @param source
+     * @param destination
+     * @param size
+     * @param initial
+     * @return u32
+     */
+    template<bool copy>
+    static u32 accumulate(const u8* source, u8* destination, size_t size, u32 initial)
+    {
+        u64 sum = initial;
+
+#if defined(__SSE2__) || defined(__ARM_NEON)
+        sum += accumulate_vectors<copy>(source, destination, size);
+#endif
+
+        while (size >= 4) {
+            u32 word;
+            __builtin_memcpy(&word, source, sizeof(word));
+            if constexpr (copy) {
+                __builtin_memcpy(destination, &word, sizeof(word));
+                destination += 4;
+            }
+            sum += word;
+            source += 4;
+            size -= 4;
+        }
+
+        if (size >= 2) {
+            u16 word;
+            __builtin_memcpy(&word, source, sizeof(word));
+            if constexpr (copy) {
+                __builtin_memcpy(destination, &word, sizeof(word));
+                destination += 2;
+            }
+            sum += word;
+            source += 2;
+            size -= 2;
+        }
+
+        // a trailing byte is the first byte of a word padded with zero
+        if (size) {
+            u16 word = 0;
+            __builtin_memcpy(&word, source, 1);
+            if constexpr (copy)
+                *destination = *source;
+            sum += word;
+        }
+
+        return fold(sum);
+    }
+
+    /**
+     * @param data
+     * @param size
+     * @param initial
+     * @return u32
+     */
+    u32 internet_checksum_partial(const void* data, size_t size, u32 initial)
+    {
+        return accumulate<false>((const u8*)data, nullptr, size, initial);
+    }
+
+    /**
+     * @brief the sum was taken over words as they sit in memory, on a little-endian host
+     *        it comes out byte-swapped, which one swap of the folded result undoes
+     *
+     * @param partial
+     * @return NetworkOrdered<u16>
+     */
+    NetworkOrdered<u16> internet_checksum_finish(u32 partial)
+    {
+        u16 checksum = ~fold(partial) & 0xffff;
+        return convert_between_host_and_network_endian(checksum);
+    }
+
+    /**
+     * @param data
+     * @param size
+     * @return NetworkOrdered<u16>
+     */
+    NetworkOrdered<u16> internet_checksum(const void* data, size_t size)
+    {
+        return internet_checksum_finish(internet_checksum_partial(data, size));
+    }
+
+    /**
+     * @param destination
+     * @param source
+     * @param size
+     * @param initial
+     * @return u32
+     */
+    u32 copy_and_checksum(void* destination, const void* source, size_t size, u32 initial)
+    {
+        return accumulate<true>((const u8*)source, (u8*)destination, size, initial);
+    }
+
+    /**
+     * @param destination
+     * @param source
+     * @param size
+     * @param initial
+     * @return KResultOr<u32>
+     */
+    KResultOr<u32> copy_and_checksum(void* destination, const UserOrKernelBuffer& source, size_t size, u32 initial)
+    {
+        if (source.is_kernel_buffer())
+            return copy_and_checksum(destination, source.user_or_kernel_ptr(), size, initial);
+
+        static_assert(user_copy_chunk_size % 2 == 0);
+
+        auto* bytes = (u8*)destination;
+        u32 sum = initial;
+        for (size_t offset = 0; offset < size; offset += user_copy_chunk_size) {
+            size_t chunk = min(user_copy_chunk_size, size - offset);
+            if (!source.read(bytes + offset, offset, chunk))
+                return KResult(-EFAULT);
+            sum = internet_checksum_partial(bytes + offset, chunk, sum);
+        }
+        return sum;
+    }
+
+    /**
+     * @brief HC' = ~(~HC + ~m + m'), eqn. 3 of RFC 1624, which unlike eqn. 2 never turns a
+     *        checksum into -0
+     *
+     * @param checksum
+     * @param old_value
+     * @param new_value
+     * @return NetworkOrdered<u16>
+     */
+    NetworkOrdered<u16> internet_checksum_update(NetworkOrdered<u16> checksum, u16 old_value, u16 new_value)
+    {
+        u32 sum = (u16)~(u16)checksum;
+        sum += (u16)~old_value;
+        sum += new_value;
+        return (u16)~fold(sum);
+    }
+
+    /**
+     * @param checksum
+     * @param old_value
+     * @param new_value
+     * @return NetworkOrdered<u16>
+     */
+    NetworkOrdered<u16> internet_checksum_update32(NetworkOrdered<u16> checksum, u32 old_value, u32 new_value)
+    {
+        u32 sum = (u16)~(u16)checksum;
+        sum += (u16)~(old_value >> 16);
+        sum += (u16)~(old_value & 0xffff);
+        sum += new_value >> 16;
+        sum += new_value & 0xffff;
+        return (u16)~fold(sum);
+    }
+
+} // namespace Kernel
@@ -0,0 +1,91 @@
+/**
+ * @file checksum.h
+ * @author Krisna Pranav
+ * @brief internet checksum
+ * @version 6.0
+ * @date 2023-09-27
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#pragma once
+
+#include <mods/endian.h>
+#include <mods/types.h>
+#include <kernel/kresult.h>
+#include <kernel/userorkernelbuffer.h>
+
+namespace Kernel
+{
+
+    /**
+     * @brief the one's complement sum of a range, folded to 16 bits but not complemented.
+     *        Pass the result of one range as initial for the next to sum a packet in
+     *        pieces; every piece but the last must have an even length
+     *
+     * @param data
+     * @param size
+     * @param initial
+     * @return u32
+     */
+    u32 internet_checksum_partial(const void* data, size_t size, u32 initial = 0);
+
+    /**
+     * @brief completes a partial sum into the checksum that goes into a header
+     *
+     * @param partial
+     * @return NetworkOrdered<u16>
+     */
+    NetworkOrdered<u16> internet_checksum_finish(u32 partial);
+
+    /**
+     * @return NetworkOrdered<u16>
+     */
+    NetworkOrdered<u16> internet_checksum(const void*, size_t);
+
+    /**
+     * @brief copies size bytes from source to destination and sums them on the way
+     *
+     * @param destination
+     * @param source
+     * @param size
+     * @param initial
+     * @return u32
+     */
+    u32 copy_and_checksum(void* destination, const void* source, size_t size, u32 initial = 0);
+
+    /**
+     * @brief userspace sources are copied in small chunks, each one summed while it is still
+     *        in the cache
+     *
+     * @param destination
+     * @param source
+     * @param size
+     * @param initial
+     * @return KResultOr<u32>
+     */
+    KResultOr<u32> copy_and_checksum(void* destination, const UserOrKernelBuffer& source, size_t size, u32 initial = 0);
+
+    /**
+     * @brief RFC 1624 incremental update, for a 16-bit field that went from old_value to
+     *        new_value. Values are in host order, as read out of the header
+     *
+     * @param checksum
+     * @param old_value
+     * @param new_value
+     * @return NetworkOrdered<u16>
+     */
+    NetworkOrdered<u16> internet_checksum_update(NetworkOrdered<u16> checksum, u16 old_value, u16 new_value);
+
+    /**
+     * @brief the same for a 32-bit field, such as an address
+     *
+     * @param checksum
+     * @param old_value
+     * @param new_value
+     * @return NetworkOrdered<u16>
+     */
+    NetworkOrdered<u16> internet_checksum_update32(NetworkOrdered<u16> checksum, u32 old_value, u32 new_value);
+
+} // namespace Kernel
@@ -18,6 +18,7 @@
 #include <mods/types.h>
 #include <mods/platform.h>
 #include <mods/string_view.h>
+#include <kernel/net/checksum.h>
 
 namespace Kernel {
     /// @brief IPv4Protocol
@@ -35,11 +36,6 @@ namespace Kernel {
         MoreFragments = 0x2000,
     };
 
-    /**
-     * @return NetworkOrdered<u16> 
-     */
-    NetworkOrdered<u16> internet_checksum(const void*, size_t);
-
     class [[gnu::packed]] IPv4Packet
     {
     public:
@@ -124,6 +120,20 @@ namespace Kernel {
             m_ttl = ttl; 
         }
 
+        /**
+         * @brief for rewriting a header that already has its checksum, patches it instead
+         *        of summing the header again
+         * 
+         * @param ttl 
+         */
+        void set_ttl_and_update_checksum(u8 ttl) 
+        { 
+            u16 old_word = (m_ttl << 8) | (u8)m_protocol;
+            m_ttl = ttl;
+            u16 new_word = (m_ttl << 8) | (u8)m_protocol;
+            m_checksum = internet_checksum_update(m_checksum, old_word, new_word);
+        }
+
         /**
          * @return u8 
          */
@@ -297,24 +307,4 @@ namespace Kernel {
      */
     const LogStream& operator<<(const LogStream& stream, const IPv4Packet& packet);
 
-    /**
-     * @param ptr 
-     * @param count 
-     * @return NetworkOrdered<u16> 
-     */
-    inline NetworkOrdered<u16> internet_checksum(const void* ptr, size_t count)
-    {
-        u32 checksum = 0;
-        auto* w = (const u16*)ptr;
-        while (count > 1) {
-            checksum += Mods::convert_between_host_and_network_endian(*w++);
-            if (checksum & 0x80000000)
-                checksum = (checksum & 0xffff) | (checksum >> 16);
-            count -= 2;
-        }
-        while (checksum >> 16)
-            checksum = (checksum & 0xffff) + (checksum >> 16);
-        return ~checksum & 0xffff;
-    }
-
 }
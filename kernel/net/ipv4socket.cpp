@@ -0,0 +1,210 @@
+/**
+ * @file ipv4socket.cpp
+ * @author Krisna Pranav
+ * @brief ipv4 socket
+ * @version 6.0
+ * @date 2023-09-24
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <kernel/net/ipv4socket.h>
+#include <kernel/net/ipv4socket_demux.h>
+#include <kernel/process.h>
+#include <kernel/stdlib.h>
+
+namespace Kernel
+{
+
+    /// @brief packets a packet-buffered socket holds before it starts dropping. Each one pins
+    ///        a pool slot, so a socket that isn't read can only take a small share of the pool
+    static constexpr size_t max_queued_packets = PacketBufferPool::slot_count / 16;
+
+    /**
+     * @brief the demux table entry goes first. Lookups racing with this already fail to
+     *        take a reference, the table lock makes sure none is still looking at us
+     */
+    IPv4Socket::~IPv4Socket()
+    {
+        leave_demux();
+
+        LOCKER(all_sockets().lock());
+        all_sockets().resource().remove(this);
+    }
+
+    /**
+     * @param user_address
+     * @param address_size
+     * @return KResult
+     */
+    KResult IPv4Socket::bind(Userspace<const sockaddr*> user_address, socklen_t address_size)
+    {
+        ASSERT(setup_state() == SetupState::Unstarted);
+        if (address_size != sizeof(sockaddr_in))
+            return KResult(-EINVAL);
+
+        sockaddr_in address;
+        if (!copy_from_user(&address, user_address, sizeof(sockaddr_in)))
+            return KResult(-EFAULT);
+
+        if (address.sin_family != AF_INET)
+            return KResult(-EINVAL);
+
+        auto requested_local_port = ntohs(address.sin_port);
+        if (!Process::current()->is_superuser() && requested_local_port && requested_local_port < 1024) {
+            dbg() << "UID " << Process::current()->uid() << " attempted to bind " << class_name() << " to port " << requested_local_port;
+            return KResult(-EACCES);
+        }
+
+        leave_demux();
+        m_local_address = IPv4Address((const u8*)&address.sin_addr.s_addr);
+        m_local_port = requested_local_port;
+
+        auto result = protocol_bind();
+        if (result.is_error())
+            return result;
+
+        // port 0 asks for an ephemeral one, which joins the demux once it is picked
+        if (!m_local_port && type() == SOCK_DGRAM) {
+            int port = allocate_local_port_if_needed();
+            return port < 0 ? KResult(port) : KResult(KSuccess);
+        }
+
+        return join_demux();
+    }
+
+    /**
+     * @param description
+     * @param address
+     * @param address_size
+     * @param should_block
+     * @return KResult
+     */
+    KResult IPv4Socket::connect(FileDescription& description, Userspace<const sockaddr*> address, socklen_t address_size, ShouldBlock should_block)
+    {
+        if (address_size != sizeof(sockaddr_in))
+            return KResult(-EINVAL);
+
+        sockaddr_in safe_address;
+        if (!copy_from_user(&safe_address, address, sizeof(sockaddr_in)))
+            return KResult(-EFAULT);
+
+        if (safe_address.sin_family != AF_INET)
+            return KResult(-EINVAL);
+
+        if (m_role == Role::Connected)
+            return KResult(-EISCONN);
+
+        leave_demux();
+        m_peer_address = IPv4Address((const u8*)&safe_address.sin_addr.s_addr);
+        m_peer_port = ntohs(safe_address.sin_port);
+
+        auto result = protocol_connect(description, should_block);
+        if (result.is_error())
+            return result;
+
+        return join_demux();
+    }
+
+    /**
+     * @brief a socket sending before it was bound gets its port here, and only then can
+     *        replies find it
+     *
+     * @return int
+     */
+    int IPv4Socket::allocate_local_port_if_needed()
+    {
+        if (m_local_port)
+            return m_local_port;
+
+        int port = protocol_allocate_local_port();
+        if (port <= 0)
+            return port;
+
+        m_local_port = (u16)port;
+
+        auto result = join_demux();
+        if (result.is_error())
+            return result;
+
+        return port;
+    }
+
+    /**
+     * @brief datagram sockets are the ones NetworkTask delivers to: a connected socket
+     *        by its whole tuple, any other by the port it is bound to. Stream sockets
+     *        aren't entered, tcp segments need the tcp state machine to see them first
+     *
+     * @return KResult
+     */
+    KResult IPv4Socket::join_demux()
+    {
+        if (type() != SOCK_DGRAM || !m_local_port)
+            return KSuccess;
+
+        leave_demux();
+
+        auto& demux = IPv4SocketDemux::udp();
+        if (m_peer_port)
+            return demux.add_established(*this);
+
+        return demux.add_listening(*this);
+    }
+
+    /**
+     * @brief called before the tuple changes, the tables find the entry by it
+     */
+    void IPv4Socket::leave_demux()
+    {
+        if (m_demux)
+            m_demux->remove(*this);
+    }
+
+    /**
+     * @brief packet-buffered sockets keep the slice itself, so the datagram stays in the
+     *        buffer the adapter received it into until recvfrom() copies it out
+     *
+     * @param source_address
+     * @param source_port
+     * @param packet
+     * @param packet_timestamp
+     * @return true
+     * @return false
+     */
+    bool IPv4Socket::did_receive(const IPv4Address& source_address, u16 source_port, PacketSlice packet, const timeval& packet_timestamp)
+    {
+        LOCKER(lock());
+
+        if (is_shut_down_for_reading())
+            return false;
+
+        auto packet_size = packet.size();
+
+        if (buffer_mode() == BufferMode::Bytes) {
+            if (packet_size > m_receive_buffer.space_for_writing())
+                return false;
+
+            auto scratch_buffer = UserOrKernelBuffer::for_kernel_buffer(m_scratch_buffer.value().data());
+            auto nreceived_or_error = protocol_receive(packet.bytes(), scratch_buffer, m_scratch_buffer.value().size(), 0);
+            if (nreceived_or_error.is_error())
+                return false;
+
+            ssize_t nwritten = m_receive_buffer.write(scratch_buffer, nreceived_or_error.value());
+            if (nwritten < 0)
+                return false;
+
+            set_can_read(!m_receive_buffer.is_empty());
+        } else {
+            if (m_receive_queue.size() >= max_queued_packets)
+                return false;
+
+            m_receive_queue.append({ source_address, source_port, packet_timestamp, move(packet) });
+            set_can_read(true);
+        }
+
+        m_bytes_received += packet_size;
+        return true;
+    }
+
+} // namespace Kernel
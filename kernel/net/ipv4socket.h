@@ -12,17 +12,20 @@
 #pragma once 
 
 #include <mods/hashmap.h>
+#include <mods/intrusivelist.h>
 #include <mods/singlelinkedlist.h>
 #include <kernel/doublebuffer.h>
 #include <kernel/kbuffer.h>
 #include <kernel/lock.h>
 #include <kernel/net/ipv4.h>
 #include <kernel/net/ipv4socket_tuple.h>
+#include <kernel/net/packetbuffer.h>
 #include <kernel/net/socket.h>
 
 namespace Kernel 
 {
 
+    class IPv4SocketDemux;
     class NetworkAdapter;
     class TCPPacket;
     class TCPSocket;
@@ -42,6 +45,9 @@ namespace Kernel
         virtual ~IPv4Socket() override;
 
         /**
+         * @brief every ipv4 socket, for enumerating them. Incoming segments find theirs
+         *        through IPv4SocketDemux instead
+         * 
          * @return Lockable<HashTable<IPv4Socket*>>& 
          */
         static Lockable<HashTable<IPv4Socket*>>& all_sockets();
@@ -99,12 +105,15 @@ namespace Kernel
         virtual int ioctl(FileDescription&, unsigned request, FlatPtr arg) override;
 
         /**
+         * @brief packet is the whole ipv4 packet, queued as a slice of the adapter's buffer
+         * 
          * @param peer_address 
          * @param peer_port 
+         * @param packet 
          * @return true 
          * @return false 
          */
-        bool did_receive(const IPv4Address& peer_address, u16 peer_port, KBuffer&&, const timeval&);
+        bool did_receive(const IPv4Address& peer_address, u16 peer_port, PacketSlice packet, const timeval&);
 
         /**
          * @return const IPv4Address& 
@@ -225,7 +234,7 @@ namespace Kernel
         }
         
         virtual KResult protocol_listen() { return KSuccess; }
-        virtual KResultOr<size_t> protocol_receive(const KBuffer&, UserOrKernelBuffer&, size_t, int) { return -ENOTIMPL; }
+        virtual KResultOr<size_t> protocol_receive(ReadonlyBytes raw_ipv4_packet, UserOrKernelBuffer&, size_t, int) { return -ENOTIMPL; }
         virtual KResultOr<size_t> protocol_send(const UserOrKernelBuffer&, size_t) { return -ENOTIMPL; }
         virtual KResult protocol_connect(FileDescription&, ShouldBlock) { return KSuccess; }
         virtual int protocol_allocate_local_port() { return 0; }
@@ -237,6 +246,8 @@ namespace Kernel
         void set_peer_address(IPv4Address address) { m_peer_address = address; }
 
     private:
+        friend class IPv4SocketDemux;
+
         virtual bool is_ipv4() const override { return true; }
 
         KResultOr<size_t> receive_byte_buffered(FileDescription&, UserOrKernelBuffer& buffer, size_t buffer_length, int flags, Userspace<sockaddr*>, Userspace<socklen_t*>);
@@ -244,6 +255,14 @@ namespace Kernel
 
         void set_can_read(bool);
 
+        /**
+         * @brief enter the IPv4SocketDemux table that matches the socket's tuple
+         * 
+         * @return KResult 
+         */
+        KResult join_demux();
+        void leave_demux();
+
         IPv4Address m_local_address;
         IPv4Address m_peer_address;
 
@@ -251,7 +270,7 @@ namespace Kernel
             IPv4Address peer_address;
             u16 peer_port;
             timeval timestamp;
-            Optional<KBuffer> data;
+            Optional<PacketSlice> data;
         };
 
         SinglyLinkedListWithCount<ReceivedPacket> m_receive_queue;
@@ -270,6 +289,18 @@ namespace Kernel
         BufferMode m_buffer_mode { BufferMode::Packets };
 
         Optional<KBuffer> m_scratch_buffer;
+
+        enum class DemuxTable : u8 
+        {
+            None,
+            Established,
+            Listening,
+        }; // enum
+
+        /// @brief which IPv4SocketDemux table the socket is linked into, only IPv4SocketDemux changes it
+        IPv4SocketDemux* m_demux { nullptr };
+        DemuxTable m_demux_table { DemuxTable::None };
+        IntrusiveListNode m_demux_list_node;
     };
 
 }
@@ -0,0 +1,216 @@
+/**
+ * @file ipv4socket_demux.cpp
+ * @author Krisna Pranav
+ * @brief ipv4 socket demux
+ * @version 6.0
+ * @date 2023-09-26
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <mods/hashfunctions.h>
+#include <mods/singleton.h>
+#include <kernel/net/ipv4socket_demux.h>
+
+namespace Kernel
+{
+
+    static Mods::Singleton<IPv4SocketDemux> s_udp;
+
+    static_assert((IPv4SocketDemux::established_bucket_count & (IPv4SocketDemux::established_bucket_count - 1)) == 0);
+    static_assert((IPv4SocketDemux::listening_bucket_count & (IPv4SocketDemux::listening_bucket_count - 1)) == 0);
+
+    /**
+     * @return IPv4SocketDemux&
+     */
+    IPv4SocketDemux& IPv4SocketDemux::udp()
+    {
+        return *s_udp;
+    }
+
+    /**
+     * @brief table entries don't own a reference. A socket whose last one is already gone
+     *        is waiting in its destructor to remove itself, so it counts as not there
+     *
+     * @param socket
+     * @return RefPtr<IPv4Socket>
+     */
+    static RefPtr<IPv4Socket> try_ref_socket(IPv4Socket& socket)
+    {
+        if (!socket.try_ref())
+            return nullptr;
+        return RefPtr<IPv4Socket>(RefPtr<IPv4Socket>::Adopt, socket);
+    }
+
+    /// @brief Construct a new IPv4SocketDemux object
+    IPv4SocketDemux::IPv4SocketDemux()
+    {
+    }
+
+    /**
+     * @param tuple
+     * @return IPv4SocketDemux::Bucket&
+     */
+    IPv4SocketDemux::Bucket& IPv4SocketDemux::established_bucket(const IPv4SocketTuple& tuple)
+    {
+        return m_established[Traits<IPv4SocketTuple>::hash(tuple) & (established_bucket_count - 1)];
+    }
+
+    /**
+     * @brief specific and wildcard binds of one port share a bucket, so the fallback from
+     *        one to the other stays within a single chain
+     *
+     * @param local_port
+     * @return IPv4SocketDemux::Bucket&
+     */
+    IPv4SocketDemux::Bucket& IPv4SocketDemux::listening_bucket(u16 local_port)
+    {
+        return m_listening[int_hash(local_port) & (listening_bucket_count - 1)];
+    }
+
+    /**
+     * @param socket
+     * @return KResult
+     */
+    KResult IPv4SocketDemux::add_established(IPv4Socket& socket)
+    {
+        ASSERT(socket.m_demux_table == IPv4Socket::DemuxTable::None);
+
+        auto tuple = socket.tuple();
+        auto& bucket = established_bucket(tuple);
+        ScopedSpinLock lock(bucket.lock);
+        for (auto& other : bucket.sockets) {
+            if (other.tuple() == tuple)
+                return KResult(-EADDRINUSE);
+        }
+
+        bucket.sockets.append(socket);
+        socket.m_demux = this;
+        socket.m_demux_table = IPv4Socket::DemuxTable::Established;
+        m_established_count++;
+        return KSuccess;
+    }
+
+    /**
+     * @param socket
+     * @return KResult
+     */
+    KResult IPv4SocketDemux::add_listening(IPv4Socket& socket)
+    {
+        ASSERT(socket.m_demux_table == IPv4Socket::DemuxTable::None);
+
+        auto& bucket = listening_bucket(socket.local_port());
+        ScopedSpinLock lock(bucket.lock);
+        for (auto& other : bucket.sockets) {
+            if (other.local_port() == socket.local_port() && other.local_address() == socket.local_address())
+                return KResult(-EADDRINUSE);
+        }
+
+        bucket.sockets.append(socket);
+        socket.m_demux = this;
+        socket.m_demux_table = IPv4Socket::DemuxTable::Listening;
+        m_listening_count++;
+        return KSuccess;
+    }
+
+    /**
+     * @param socket
+     */
+    void IPv4SocketDemux::remove(IPv4Socket& socket)
+    {
+        ASSERT(!socket.m_demux || socket.m_demux == this);
+
+        Bucket* bucket = nullptr;
+        switch (socket.m_demux_table) {
+        case IPv4Socket::DemuxTable::None:
+            return;
+        case IPv4Socket::DemuxTable::Established:
+            bucket = &established_bucket(socket.tuple());
+            m_established_count--;
+            break;
+        case IPv4Socket::DemuxTable::Listening:
+            bucket = &listening_bucket(socket.local_port());
+            m_listening_count--;
+            break;
+        }
+
+        ScopedSpinLock lock(bucket->lock);
+        bucket->sockets.remove(socket);
+        socket.m_demux = nullptr;
+        socket.m_demux_table = IPv4Socket::DemuxTable::None;
+    }
+
+    /**
+     * @param tuple
+     * @return RefPtr<IPv4Socket>
+     */
+    RefPtr<IPv4Socket> IPv4SocketDemux::lookup_established(const IPv4SocketTuple& tuple)
+    {
+        auto& bucket = established_bucket(tuple);
+        ScopedSpinLock lock(bucket.lock);
+        for (auto& socket : bucket.sockets) {
+            if (socket.tuple() == tuple)
+                return try_ref_socket(socket);
+        }
+        return nullptr;
+    }
+
+    /**
+     * @param local_address
+     * @param local_port
+     * @return RefPtr<IPv4Socket>
+     */
+    RefPtr<IPv4Socket> IPv4SocketDemux::lookup_listening(const IPv4Address& local_address, u16 local_port)
+    {
+        auto& bucket = listening_bucket(local_port);
+        ScopedSpinLock lock(bucket.lock);
+
+        IPv4Socket* wildcard = nullptr;
+        for (auto& socket : bucket.sockets) {
+            if (socket.local_port() != local_port)
+                continue;
+            if (socket.local_address() == local_address) {
+                if (auto ref = try_ref_socket(socket))
+                    return ref;
+                continue;
+            }
+            if (!socket.local_address().to_u32())
+                wildcard = &socket;
+        }
+        return wildcard ? try_ref_socket(*wildcard) : nullptr;
+    }
+
+    /**
+     * @param tuple
+     * @return RefPtr<IPv4Socket>
+     */
+    RefPtr<IPv4Socket> IPv4SocketDemux::lookup(const IPv4SocketTuple& tuple)
+    {
+        m_lookups++;
+
+        if (auto socket = lookup_established(tuple))
+            return socket;
+
+        m_listening_fallbacks++;
+        auto socket = lookup_listening(tuple.local_address(), tuple.local_port());
+        if (!socket)
+            m_misses++;
+        return socket;
+    }
+
+    /**
+     * @return IPv4SocketDemux::Statistics
+     */
+    IPv4SocketDemux::Statistics IPv4SocketDemux::statistics() const
+    {
+        Statistics statistics;
+        statistics.established = m_established_count.load(Mods::MemoryOrder::memory_order_relaxed);
+        statistics.listening = m_listening_count.load(Mods::MemoryOrder::memory_order_relaxed);
+        statistics.lookups = m_lookups.load(Mods::MemoryOrder::memory_order_relaxed);
+        statistics.listening_fallbacks = m_listening_fallbacks.load(Mods::MemoryOrder::memory_order_relaxed);
+        statistics.misses = m_misses.load(Mods::MemoryOrder::memory_order_relaxed);
+        return statistics;
+    }
+
+} // namespace Kernel
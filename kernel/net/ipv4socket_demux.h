@@ -0,0 +1,134 @@
+/**
+ * @file ipv4socket_demux.h
+ * @author Krisna Pranav
+ * @brief ipv4 socket demux
+ * @version 6.0
+ * @date 2023-09-26
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#pragma once
+
+#include <mods/atomic.h>
+#include <mods/intrusivelist.h>
+#include <mods/refptr.h>
+#include <kernel/net/ipv4.h>
+#include <kernel/net/ipv4socket.h>
+#include <kernel/net/ipv4socket_tuple.h>
+#include <kernel/spinlock.h>
+
+namespace Kernel
+{
+
+    /**
+     * @brief finds the socket an incoming segment belongs to. Connected sockets sit in an
+     *        established table keyed by the full 4-tuple, bound ones in a listening table
+     *        keyed by local port, where a specific local address wins over a wildcard one.
+     *        Both tables have a fixed bucket count with a spinlock per bucket, so a lookup
+     *        hashes once and walks one short chain. It never takes a table-wide lock.
+     *        Only udp has one, IPv4Socket enters datagram sockets on bind and connect
+     */
+    class IPv4SocketDemux
+    {
+    public:
+        static constexpr size_t established_bucket_count = 8192;
+        static constexpr size_t listening_bucket_count = 1024;
+
+        /**
+         * @return IPv4SocketDemux&
+         */
+        static IPv4SocketDemux& udp();
+
+        /// @brief Construct a new IPv4SocketDemux object
+        IPv4SocketDemux();
+
+        /**
+         * @brief socket.tuple() must not change until the socket is removed again
+         *
+         * @param socket
+         * @return KResult
+         */
+        KResult add_established(IPv4Socket& socket);
+
+        /**
+         * @brief keyed by socket.local_address() and local_port(), EADDRINUSE if both are taken
+         *
+         * @param socket
+         * @return KResult
+         */
+        KResult add_listening(IPv4Socket& socket);
+
+        /**
+         * @brief does nothing for sockets that were never added
+         *
+         * @param socket
+         */
+        void remove(IPv4Socket& socket);
+
+        /**
+         * @param tuple
+         * @return RefPtr<IPv4Socket>
+         */
+        RefPtr<IPv4Socket> lookup_established(const IPv4SocketTuple& tuple);
+
+        /**
+         * @param local_address
+         * @param local_port
+         * @return RefPtr<IPv4Socket>
+         */
+        RefPtr<IPv4Socket> lookup_listening(const IPv4Address& local_address, u16 local_port);
+
+        /**
+         * @brief the established socket for tuple, or else the one listening on its local end
+         *
+         * @param tuple
+         * @return RefPtr<IPv4Socket>
+         */
+        RefPtr<IPv4Socket> lookup(const IPv4SocketTuple& tuple);
+
+        struct Statistics
+        {
+            u32 established { 0 };
+            u32 listening { 0 };
+            u64 lookups { 0 };
+            u64 listening_fallbacks { 0 };
+            u64 misses { 0 };
+        }; // struct Statistics
+
+        /**
+         * @return Statistics
+         */
+        Statistics statistics() const;
+
+    private:
+        struct Bucket
+        {
+            mutable SpinLock<u8> lock;
+            IntrusiveList<IPv4Socket, &IPv4Socket::m_demux_list_node> sockets;
+        }; // struct Bucket
+
+        /**
+         * @param tuple
+         * @return Bucket&
+         */
+        Bucket& established_bucket(const IPv4SocketTuple& tuple);
+
+        /**
+         * @param local_port
+         * @return Bucket&
+         */
+        Bucket& listening_bucket(u16 local_port);
+
+        Bucket m_established[established_bucket_count];
+        Bucket m_listening[listening_bucket_count];
+
+        Atomic<u32> m_established_count { 0 };
+        Atomic<u32> m_listening_count { 0 };
+        Atomic<u64> m_lookups { 0 };
+        Atomic<u64> m_listening_fallbacks { 0 };
+        Atomic<u64> m_misses { 0 };
+    }; // class IPv4SocketDemux
+
+} // namespace Kernel
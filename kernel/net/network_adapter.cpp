@@ -0,0 +1,346 @@
+/**
+ * @file network_adapter.cpp
+ * @author Krisna Pranav
+ * @brief network adapter
+ * @version 6.0
+ * @date 2023-09-24
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <kernel/net/checksum.h>
+#include <kernel/net/ethernetframeheader.h>
+#include <kernel/net/ethertype.h>
+#include <kernel/net/network_adapter.h>
+#include <kernel/process.h>
+#include <kernel/stdlib.h>
+
+namespace Kernel
+{
+
+    /// @brief what the tcp checksum covers besides the segment itself
+    struct [[gnu::packed]] TCPPseudoHeader
+    {
+        IPv4Address source;
+        IPv4Address destination;
+        u8 zero { 0 };
+        u8 protocol { 0 };
+        NetworkOrdered<u16> tcp_length;
+    }; // struct TCPPseudoHeader
+
+    static_assert(sizeof(TCPPseudoHeader) == 12);
+
+    /**
+     * @brief the one copy a frame gets on its way in, out of the driver's receive buffer
+     *        into a packet buffer that everything after this shares. Only the frame that
+     *        finds the adapter idle notifies, the rest are picked up by the running poll.
+     *        Usually runs in the receive interrupt, so a frame that finds the pool empty
+     *        or the queue full is dropped rather than allocated for
+     *
+     * @param payload
+     */
+    void NetworkAdapter::did_receive(ReadonlyBytes payload)
+    {
+        auto buffer = PacketBufferPool::the().copy(payload);
+
+        bool should_notify = false;
+        {
+            ScopedSpinLock lock(m_packet_queue_lock);
+            m_packets_in++;
+            m_bytes_in += payload.size();
+
+            if (!buffer && payload.size() > PacketBufferPool::slot_size) {
+                m_oversized_packets_dropped++;
+                return;
+            }
+
+            // tail drop: the frames already queued are older and closer to being handled
+            if (!buffer || m_packet_queue_size >= max_queued_packets) {
+                m_packets_dropped++;
+                return;
+            }
+
+            buffer->timestamp = kgettimeofday();
+            m_packet_copies++;
+            m_packet_bytes_copied += payload.size();
+
+            m_packet_queue.append(buffer.leak_ref());
+            m_packet_queue_size++;
+
+            if (!m_receive_scheduled) {
+                m_receive_scheduled = true;
+                m_receive_notifications++;
+                should_notify = true;
+            }
+        }
+
+        if (should_notify && on_receive)
+            on_receive();
+    }
+
+    /**
+     * @param batch
+     * @param budget
+     * @return true
+     * @return false
+     */
+    bool NetworkAdapter::dequeue_packets(Vector<NonnullRefPtr<PacketBuffer>>& batch, size_t budget)
+    {
+        ScopedSpinLock lock(m_packet_queue_lock);
+        for (size_t i = 0; i < budget; ++i) {
+            auto* buffer = m_packet_queue.take_first();
+            if (!buffer)
+                break;
+            m_packet_queue_size--;
+            batch.append(adopt(*buffer));
+        }
+
+        if (!m_packet_queue.is_empty())
+            return false;
+
+        m_receive_scheduled = false;
+        return true;
+    }
+
+    /**
+     * @return RefPtr<PacketBuffer>
+     */
+    RefPtr<PacketBuffer> NetworkAdapter::dequeue_packet()
+    {
+        ScopedSpinLock lock(m_packet_queue_lock);
+        auto* buffer = m_packet_queue.take_first();
+        if (m_packet_queue.is_empty())
+            m_receive_scheduled = false;
+        if (!buffer)
+            return nullptr;
+        m_packet_queue_size--;
+        return adopt(*buffer);
+    }
+
+    /**
+     * @param buffer
+     * @param buffer_size
+     * @param packet_timestamp
+     * @return size_t
+     */
+    size_t NetworkAdapter::dequeue_packet(u8* buffer, size_t buffer_size, timeval& packet_timestamp)
+    {
+        auto packet = dequeue_packet();
+        if (!packet)
+            return 0;
+
+        size_t packet_size = packet->size();
+        ASSERT(packet_size <= buffer_size);
+        memcpy(buffer, packet->data(), packet_size);
+        packet_timestamp = packet->timestamp;
+
+        ScopedSpinLock lock(m_packet_queue_lock);
+        m_packet_copies++;
+        m_packet_bytes_copied += packet_size;
+        return packet_size;
+    }
+
+    /**
+     * @param destination_mac
+     * @param destination_ipv4
+     * @param protocol
+     * @param payload
+     * @param payload_size
+     * @param ttl
+     * @return int
+     */
+    int NetworkAdapter::send_ipv4(const MACAddress& destination_mac, const IPv4Address& destination_ipv4, IPv4Protocol protocol, const UserOrKernelBuffer& payload, size_t payload_size, u8 ttl)
+    {
+        size_t ipv4_packet_size = sizeof(IPv4Packet) + payload_size;
+        if (ipv4_packet_size > mtu())
+            return send_ipv4_fragmented(destination_mac, destination_ipv4, protocol, payload, payload_size, ttl);
+
+        size_t ethernet_frame_size = sizeof(EthernetFrameHeader) + ipv4_packet_size;
+        auto buffer = ByteBuffer::create_zeroed(ethernet_frame_size);
+
+        auto& eth = *(EthernetFrameHeader*)buffer.data();
+        eth.set_source(mac_address());
+        eth.set_destination(destination_mac);
+        eth.set_ether_type(EtherType::IPv4);
+
+        auto& ipv4 = *(IPv4Packet*)eth.payload();
+        ipv4.set_version(4);
+        ipv4.set_internet_header_length(5);
+        ipv4.set_source(ipv4_address());
+        ipv4.set_destination(destination_ipv4);
+        ipv4.set_protocol((u8)protocol);
+        ipv4.set_length(ipv4_packet_size);
+        ipv4.set_ident(next_ipv4_ident());
+        ipv4.set_ttl(ttl);
+        ipv4.set_checksum(ipv4.compute_checksum());
+
+        if (!payload.read(ipv4.payload(), payload_size))
+            return -EFAULT;
+
+        m_packets_out++;
+        m_bytes_out += ethernet_frame_size;
+        send_raw({ (const u8*)&eth, ethernet_frame_size });
+        return 0;
+    }
+
+    /**
+     * @brief every fragment carries the datagram's one ident. Fragment offsets count
+     *        8-byte blocks, so all but the last fragment carry a multiple of 8 bytes
+     *
+     * @param destination_mac
+     * @param destination_ipv4
+     * @param protocol
+     * @param payload
+     * @param payload_size
+     * @param ttl
+     * @return int
+     */
+    int NetworkAdapter::send_ipv4_fragmented(const MACAddress& destination_mac, const IPv4Address& destination_ipv4, IPv4Protocol protocol, const UserOrKernelBuffer& payload, size_t payload_size, u8 ttl)
+    {
+        if (mtu() < sizeof(IPv4Packet) + 8)
+            return -EINVAL;
+
+        size_t fragment_payload_size = (min<size_t>(mtu(), 0xffff) - sizeof(IPv4Packet)) & ~(size_t)7;
+        size_t fragment_count = (payload_size + fragment_payload_size - 1) / fragment_payload_size;
+        if ((fragment_count - 1) * fragment_payload_size / 8 > 0x1fff)
+            return -EMSGSIZE;
+
+        u16 ident = next_ipv4_ident();
+        auto buffer = ByteBuffer::create_zeroed(sizeof(EthernetFrameHeader) + sizeof(IPv4Packet) + fragment_payload_size);
+
+        for (size_t index = 0; index < fragment_count; ++index) {
+            size_t offset = index * fragment_payload_size;
+            bool is_last = index + 1 == fragment_count;
+            size_t size = is_last ? payload_size - offset : fragment_payload_size;
+            size_t ethernet_frame_size = sizeof(EthernetFrameHeader) + sizeof(IPv4Packet) + size;
+
+            auto& eth = *(EthernetFrameHeader*)buffer.data();
+            eth.set_source(mac_address());
+            eth.set_destination(destination_mac);
+            eth.set_ether_type(EtherType::IPv4);
+
+            auto& ipv4 = *(IPv4Packet*)eth.payload();
+            ipv4.set_version(4);
+            ipv4.set_internet_header_length(5);
+            ipv4.set_source(ipv4_address());
+            ipv4.set_destination(destination_ipv4);
+            ipv4.set_protocol((u8)protocol);
+            ipv4.set_length(sizeof(IPv4Packet) + size);
+            ipv4.set_has_more_fragments(!is_last);
+            ipv4.set_ident(ident);
+            ipv4.set_ttl(ttl);
+            ipv4.set_fragment_offset(offset / 8);
+            ipv4.set_checksum(0);
+            ipv4.set_checksum(ipv4.compute_checksum());
+
+            if (!payload.read(ipv4.payload(), offset, size))
+                return -EFAULT;
+
+            m_packets_out++;
+            m_bytes_out += ethernet_frame_size;
+            send_raw({ (const u8*)&eth, ethernet_frame_size });
+        }
+
+        return 0;
+    }
+
+    /**
+     * @brief the ethernet and ipv4 headers are written once, then every segment only
+     *        rewrites length, ident, sequence number and flags. The payload is copied in
+     *        by copy_and_checksum, so it is summed for the tcp checksum on the way
+     *
+     * @param destination_mac
+     * @param destination_ipv4
+     * @param header
+     * @param payload
+     * @param payload_size
+     * @param ttl
+     * @return KResultOr<size_t>
+     */
+    KResultOr<size_t> NetworkAdapter::send_tcp_segments(const MACAddress& destination_mac, const IPv4Address& destination_ipv4, const TCPPacket& header, const UserOrKernelBuffer& payload, size_t payload_size, u8 ttl)
+    {
+        size_t tcp_header_size = header.header_size();
+        size_t headers_size = sizeof(IPv4Packet) + tcp_header_size;
+        if (tcp_header_size < sizeof(TCPPacket) || mtu() <= headers_size)
+            return KResult(-EINVAL);
+        if (!payload_size)
+            return 0;
+
+        // the ipv4 length field is 16 bits, which the loopback's mtu alone would overflow
+        size_t max_segment_size = min<size_t>(mtu(), 0xffff) - headers_size;
+        size_t frame_capacity = sizeof(EthernetFrameHeader) + headers_size + max_segment_size;
+
+        LOCKER(m_segmentation_lock);
+
+        if (!m_segment_buffer.has_value() || m_segment_buffer.value().size() < frame_capacity)
+            m_segment_buffer = KBuffer::create_with_size(frame_capacity, Region::Access::Read | Region::Access::Write, "Segmentation");
+
+        u8* frame = m_segment_buffer.value().data();
+        memset(frame, 0, sizeof(EthernetFrameHeader) + headers_size);
+
+        auto& eth = *(EthernetFrameHeader*)frame;
+        eth.set_source(mac_address());
+        eth.set_destination(destination_mac);
+        eth.set_ether_type(EtherType::IPv4);
+
+        auto& ipv4 = *(IPv4Packet*)eth.payload();
+        ipv4.set_version(4);
+        ipv4.set_internet_header_length(5);
+        ipv4.set_source(ipv4_address());
+        ipv4.set_destination(destination_ipv4);
+        ipv4.set_protocol((u8)IPv4Protocol::TCP);
+        ipv4.set_ttl(ttl);
+
+        auto& tcp = *(TCPPacket*)ipv4.payload();
+        memcpy(&tcp, &header, tcp_header_size);
+
+        u32 first_sequence_number = header.sequence_number();
+        u16 last_flags = header.flags();
+        u16 flags = last_flags & ~(TCPFlags::FIN | TCPFlags::PUSH);
+
+        TCPPseudoHeader pseudo_header;
+        pseudo_header.source = ipv4_address();
+        pseudo_header.destination = destination_ipv4;
+        pseudo_header.protocol = (u8)IPv4Protocol::TCP;
+
+        size_t offset = 0;
+        while (offset < payload_size) {
+            size_t segment_size = min(payload_size - offset, max_segment_size);
+            bool is_last = offset + segment_size == payload_size;
+            u16 ipv4_length = headers_size + segment_size;
+
+            ipv4.set_length(ipv4_length);
+            ipv4.set_ident(next_ipv4_ident());
+            ipv4.set_checksum(0);
+            ipv4.set_checksum(ipv4.compute_checksum());
+
+            tcp.set_sequence_number(first_sequence_number + offset);
+            tcp.set_flags(is_last ? last_flags : flags);
+            tcp.set_checksum(0);
+
+            pseudo_header.tcp_length = tcp_header_size + segment_size;
+            u32 sum = internet_checksum_partial(&pseudo_header, sizeof(pseudo_header));
+            sum = internet_checksum_partial(&tcp, tcp_header_size, sum);
+
+            auto sum_or_error = copy_and_checksum(tcp.payload(), payload.offset(offset), segment_size, sum);
+            if (sum_or_error.is_error()) {
+                if (offset)
+                    return offset;
+                return sum_or_error.error();
+            }
+            tcp.set_checksum(internet_checksum_finish(sum_or_error.value()));
+
+            size_t frame_size = sizeof(EthernetFrameHeader) + ipv4_length;
+            send_raw({ frame, frame_size });
+
+            m_packets_out++;
+            m_bytes_out += frame_size;
+            offset += segment_size;
+        }
+
+        m_super_segments_out++;
+        return payload_size;
+    }
+
+} // namespace Kernel
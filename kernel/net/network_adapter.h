@@ -13,14 +13,19 @@
 
 #include <kernel/userorkernelbuffer.h>
 #include <kernel/kbuffer.h>
+#include <kernel/kresult.h>
+#include <kernel/lock.h>
 #include <kernel/net/ipv4.h>
 #include <kernel/net/icmp.h>
-#include <kernel/net/ipv4.h>
+#include <kernel/net/packetbuffer.h>
+#include <kernel/net/tcp.h>
+#include <kernel/spinlock.h>
 #include <mods/byte_buffer.h>
 #include <mods/function.h>
+#include <mods/intrusivelist.h>
 #include <mods/mac_address.h>
-#include <mods/singlelinkedlist.h>
 #include <mods/types.h>
+#include <mods/vector.h>
 #include <mods/weakable.h>
 #include <mods/weakptr.h>
 
@@ -32,6 +37,9 @@ namespace Kernel
     class NetworkAdapter : public RefCounted<NetworkAdapter> 
     {
     public:
+        /// @brief receive queue bound, a quarter of the packet buffer pool so one busy adapter can't hold all of it
+        static constexpr size_t max_queued_packets = PacketBufferPool::slot_count / 4;
+
         /// @breif: for_each
         static void for_each(Function<void(NetworkAdapter&)>);
 
@@ -117,6 +125,33 @@ namespace Kernel
         int send_ipv4_fragmented(const MACAddress&, const IPv4Address&, IPv4Protocol, const UserOrKernelBuffer& payload, size_t payload_size, u8 ttl);
 
         /**
+         * @brief software segmentation offload: header is the tcp header, options included,
+         *        that every segment starts from, and payload is cut into as many mtu-sized
+         *        segments as it takes. Each gets the next sequence number and its own ipv4
+         *        and tcp checksums, only the last one keeps PUSH and FIN
+         * 
+         * @param header 
+         * @param payload 
+         * @param payload_size 
+         * @param ttl 
+         * @return KResultOr<size_t> the bytes sent, short if a fault stopped it after the first segment
+         */
+        KResultOr<size_t> send_tcp_segments(const MACAddress&, const IPv4Address&, const TCPPacket& header, const UserOrKernelBuffer& payload, size_t payload_size, u8 ttl);
+
+        /**
+         * @brief the one ipv4 ident counter of the adapter, send_ipv4, send_ipv4_fragmented
+         *        and send_tcp_segments all take theirs from it
+         * 
+         * @return u16 
+         */
+        u16 next_ipv4_ident() 
+        { 
+            return m_next_ipv4_ident.fetch_add(1, Mods::MemoryOrder::memory_order_relaxed); 
+        }
+
+        /**
+         * @brief copies the frame out, for callers that want it in a buffer of their own
+         * 
          * @param buffer 
          * @param buffer_size 
          * @param packet_timestamp 
@@ -124,12 +159,30 @@ namespace Kernel
          */
         size_t dequeue_packet(u8* buffer, size_t buffer_size, timeval& packet_timestamp);
 
+        /**
+         * @brief hands the queued frame over as is, the buffer carries its receive timestamp
+         * 
+         * @return RefPtr<PacketBuffer> 
+         */
+        RefPtr<PacketBuffer> dequeue_packet();
+
+        /**
+         * @brief takes up to budget frames under one lock acquisition. Once the queue is
+         *        empty the adapter goes back to notifying through on_receive
+         * 
+         * @param batch 
+         * @param budget 
+         * @return true when the queue was drained
+         */
+        bool dequeue_packets(Vector<NonnullRefPtr<PacketBuffer>>& batch, size_t budget);
+
         /**
          * @return true 
          * @return false 
          */
         bool has_queued_packets() const 
         { 
+            ScopedSpinLock lock(m_packet_queue_lock);
             return !m_packet_queue.is_empty(); 
         }
 
@@ -169,6 +222,65 @@ namespace Kernel
             return m_bytes_out; 
         }
 
+        /**
+         * @brief received frames dropped because the packet buffer pool was empty or the
+         *        receive queue already held max_queued_packets
+         * 
+         * @return u64 
+         */
+        u64 packets_dropped() const 
+        { 
+            return m_packets_dropped; 
+        }
+
+        /**
+         * @brief received frames dropped because they were larger than a pool slot and
+         *        arrived in interrupt context, where no buffer can be allocated for them
+         * 
+         * @return u64 
+         */
+        u64 oversized_packets_dropped() const 
+        { 
+            return m_oversized_packets_dropped; 
+        }
+
+        /**
+         * @brief every time a received frame's bytes were copied, the copy out of the
+         *        driver included
+         * 
+         * @return u64 
+         */
+        u64 packet_copies() const 
+        { 
+            return m_packet_copies; 
+        }
+
+        u64 packet_bytes_copied() const 
+        { 
+            return m_packet_bytes_copied; 
+        }
+
+        /**
+         * @brief how often on_receive fired, frames that arrive while the queue is being
+         *        polled don't fire it again
+         * 
+         * @return u64 
+         */
+        u64 receive_notifications() const 
+        { 
+            return m_receive_notifications; 
+        }
+
+        /**
+         * @brief send_tcp_segments calls, the segments they produced are in packets_out
+         * 
+         * @return u64 
+         */
+        u64 super_segments_out() const 
+        { 
+            return m_super_segments_out; 
+        }
+
         Function<void()> on_receive;
 
     protected:
@@ -203,16 +315,13 @@ namespace Kernel
         IPv4Address m_ipv4_netmask;
         IPv4Address m_ipv4_gateway;
 
-        struct PacketWithTimestamp 
-        {
-            KBuffer packet;
-            timeval timestamp;
-        }; // struct
+        /// @brief every queued buffer holds one reference, taken over by dequeue_packet()
+        mutable SpinLock<u8> m_packet_queue_lock;
+        IntrusiveList<PacketBuffer, &PacketBuffer::m_list_node> m_packet_queue;
+        size_t m_packet_queue_size { 0 };
 
-        SinglyLinkedList<PacketWithTimestamp> m_packet_queue;
-        SinglyLinkedList<KBuffer> m_unused_packet_buffers;
-        
-        size_t m_unused_packet_buffers_count { 0 };
+        /// @brief set from the first queued frame until a poll drains the queue, guarded by m_packet_queue_lock
+        bool m_receive_scheduled { false };
 
         String m_name;
 
@@ -222,6 +331,18 @@ namespace Kernel
         u32 m_bytes_out { 0 };
         u32 m_mtu { 1500 };
 
+        u64 m_packets_dropped { 0 };
+        u64 m_oversized_packets_dropped { 0 };
+        u64 m_packet_copies { 0 };
+        u64 m_packet_bytes_copied { 0 };
+        u64 m_receive_notifications { 0 };
+
+        /// @brief serializes send_tcp_segments, which builds every segment in m_segment_buffer
+        Lock m_segmentation_lock { "NetworkAdapter" };
+        Optional<KBuffer> m_segment_buffer;
+        Atomic<u16> m_next_ipv4_ident { 1 };
+        u64 m_super_segments_out { 0 };
+
     }; // class NetworkAdapter
 
 } // namespace Kernel
@@ -0,0 +1,252 @@
+/**
+ * @file network_task.cpp
+ * @author Krisna Pranav
+ * @brief network task
+ * @version 6.0
+ * @date 2023-09-25
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <mods/vector.h>
+#include <kernel/net/checksum.h>
+#include <kernel/net/ethernetframeheader.h>
+#include <kernel/net/ethertype.h>
+#include <kernel/net/ipv4socket.h>
+#include <kernel/net/ipv4socket_demux.h>
+#include <kernel/net/network_adapter.h>
+#include <kernel/net/network_task.h>
+#include <kernel/net/packetbuffer.h>
+#include <kernel/net/udp.h>
+#include <kernel/process.h>
+#include <kernel/scheduler.h>
+#include <kernel/spinlock.h>
+#include <kernel/waitqueue.h>
+
+namespace Kernel
+{
+
+    static WaitQueue* s_receive_wait_queue;
+
+    /// @brief reused every round, so polling doesn't allocate once it has grown to adapter_weight
+    static Vector<NonnullRefPtr<PacketBuffer>> s_batch;
+
+    /// @brief raw sockets an icmp packet is delivered to, reused like s_batch
+    static Vector<NonnullRefPtr<IPv4Socket>> s_raw_sockets;
+
+    static SpinLock<u8> s_statistics_lock;
+    static NetworkTask::Statistics s_statistics;
+
+    void NetworkTask::spawn()
+    {
+        RefPtr<Thread> thread;
+        Process::create_kernel_process(thread, "NetworkTask", [] {
+            NetworkTask::run();
+        });
+    }
+
+    /**
+     * @return NetworkTask::Statistics
+     */
+    NetworkTask::Statistics NetworkTask::statistics()
+    {
+        ScopedSpinLock lock(s_statistics_lock);
+        return s_statistics;
+    }
+
+    /**
+     * @brief adapters only notify for the first frame after a poll drained them, so under
+     *        load the task keeps polling and yielding between rounds instead of waking up
+     *        once per frame. It goes back to sleep once a round finds everything drained
+     */
+    void NetworkTask::run()
+    {
+        s_receive_wait_queue = new WaitQueue;
+        s_batch.ensure_capacity(adapter_weight);
+
+        NetworkAdapter::for_each([](NetworkAdapter& adapter) {
+            adapter.on_receive = [] {
+                s_receive_wait_queue->wake_all();
+            };
+        });
+
+        for (;;) {
+            if (poll_adapters()) {
+                Scheduler::yield();
+                continue;
+            }
+
+            (void)s_receive_wait_queue->wait_on({}, "NetworkTask");
+
+            ScopedSpinLock lock(s_statistics_lock);
+            s_statistics.wakeups++;
+        }
+    }
+
+    /**
+     * @return true
+     * @return false
+     */
+    bool NetworkTask::poll_adapters()
+    {
+        size_t handled = 0;
+        size_t unhandled = 0;
+        bool pending = false;
+
+        NetworkAdapter::for_each([&](NetworkAdapter& adapter) {
+            if (handled >= round_budget) {
+                pending |= adapter.has_queued_packets();
+                return;
+            }
+
+            s_batch.clear_with_capacity();
+            bool drained = adapter.dequeue_packets(s_batch, min(adapter_weight, round_budget - handled));
+            for (auto& buffer : s_batch) {
+                if (!handle_frame(adapter, PacketSlice(buffer)))
+                    unhandled++;
+            }
+
+            handled += s_batch.size();
+            if (!drained)
+                pending = true;
+        });
+
+        s_batch.clear_with_capacity();
+
+        ScopedSpinLock lock(s_statistics_lock);
+        s_statistics.frames += handled;
+        s_statistics.unhandled += unhandled;
+        s_statistics.rounds++;
+        if (pending)
+            s_statistics.budget_exhausted++;
+        return pending;
+    }
+
+    /**
+     * @param adapter
+     * @param frame
+     * @return true
+     * @return false
+     */
+    bool NetworkTask::handle_frame(NetworkAdapter& adapter, PacketSlice frame)
+    {
+        if (frame.size() < sizeof(EthernetFrameHeader)) {
+            klog() << "NetworkTask: Frame too small (" << frame.size() << " bytes) on " << adapter.name();
+            return false;
+        }
+
+        auto& eth = frame.as<EthernetFrameHeader>();
+        switch (eth.ether_type()) {
+        case EtherType::IPv4:
+            return handle_ipv4(adapter, frame.slice(sizeof(EthernetFrameHeader)));
+        default:
+            return false;
+        }
+    }
+
+    /**
+     * @brief the adapter's own address, the limited broadcast address or the adapter's
+     *        subnet broadcast
+     *
+     * @param adapter
+     * @param destination
+     * @return true
+     * @return false
+     */
+    static bool is_addressed_to(const NetworkAdapter& adapter, const IPv4Address& destination)
+    {
+        if (destination == adapter.ipv4_address() || destination == IPv4Address(255, 255, 255, 255))
+            return true;
+
+        u32 netmask = adapter.ipv4_netmask().to_u32();
+        if (!netmask || netmask == 0xffffffff)
+            return false;
+
+        return destination.to_u32() == (adapter.ipv4_address().to_u32() | ~netmask);
+    }
+
+    /**
+     * @param adapter
+     * @param packet
+     * @return true
+     * @return false
+     */
+    bool NetworkTask::handle_ipv4(NetworkAdapter& adapter, PacketSlice packet)
+    {
+        if (packet.size() < sizeof(IPv4Packet))
+            return false;
+
+        auto& ipv4 = packet.as<IPv4Packet>();
+        if (ipv4.version() != 4 || ipv4.internet_header_length() != 5)
+            return false;
+        if (ipv4.length() < sizeof(IPv4Packet) || ipv4.length() > packet.size())
+            return false;
+        if (internet_checksum(&ipv4, sizeof(IPv4Packet)) != 0)
+            return false;
+        if (ipv4.is_a_fragment() || !is_addressed_to(adapter, ipv4.destination()))
+            return false;
+
+        // the ethernet minimum frame size may have padded the packet
+        packet = packet.slice(0, ipv4.length());
+
+        switch ((IPv4Protocol)ipv4.protocol()) {
+        case IPv4Protocol::ICMP:
+            return handle_icmp(move(packet));
+        case IPv4Protocol::UDP:
+            break;
+        default:
+            // tcp segments need the tcp state machine, which doesn't run here
+            return false;
+        }
+
+        if (ipv4.payload_size() < sizeof(UDPPacket))
+            return false;
+
+        auto& udp = *static_cast<const UDPPacket*>(ipv4.payload());
+        u16 source_port = udp.source_port();
+        u16 destination_port = udp.destination_port();
+
+        auto socket = IPv4SocketDemux::udp().lookup({ ipv4.destination(), destination_port, ipv4.source(), source_port });
+        if (!socket)
+            return false;
+
+        auto timestamp = packet.timestamp();
+        auto source = ipv4.source();
+        return socket->did_receive(source, source_port, move(packet), timestamp);
+    }
+
+    /**
+     * @brief the socket set is only read here, so it is held Shared and the packet is
+     *        delivered after dropping it
+     *
+     * @param packet
+     * @return true
+     * @return false
+     */
+    bool NetworkTask::handle_icmp(PacketSlice packet)
+    {
+        s_raw_sockets.clear_with_capacity();
+        IPv4Socket::all_sockets().with_shared([](auto& sockets) {
+            for (auto* socket : sockets) {
+                if (socket->type() != SOCK_RAW || socket->protocol() != IPPROTO_ICMP)
+                    continue;
+                // a socket being destroyed waits for the lock to leave the set, skip it
+                if (socket->try_ref())
+                    s_raw_sockets.append(adopt(*socket));
+            }
+        });
+
+        auto& ipv4 = packet.as<IPv4Packet>();
+        auto source = ipv4.source();
+        auto timestamp = packet.timestamp();
+
+        bool delivered = false;
+        for (auto& socket : s_raw_sockets)
+            delivered |= socket->did_receive(source, 0, packet.slice(0), timestamp);
+
+        s_raw_sockets.clear_with_capacity();
+        return delivered;
+    }
+
+} // namespace Kernel
@@ -11,13 +11,78 @@
 
 #pragma once 
 
+#include <mods/types.h>
+
 namespace Kernel 
 {
+
+    class NetworkAdapter;
+    class PacketSlice;
     
     class NetworkTask 
     {
     public:
         static void spawn();
+
+        /// @brief frames taken from one adapter before moving on to the next
+        static constexpr size_t adapter_weight = 64;
+
+        /// @brief frames handled per round before the task yields the cpu
+        static constexpr size_t round_budget = 300;
+
+        struct Statistics 
+        {
+            u64 frames { 0 };
+            u64 rounds { 0 };
+            u64 wakeups { 0 };
+
+            /// @brief rounds that ended with frames still queued, the task yields instead of sleeping
+            u64 budget_exhausted { 0 };
+
+            /// @brief frames dropped as malformed, or because no protocol or socket took them
+            u64 unhandled { 0 };
+        }; // struct Statistics
+
+        /**
+         * @return Statistics 
+         */
+        static Statistics statistics();
+
+    private:
+        [[noreturn]] static void run();
+
+        /**
+         * @brief one round over every adapter, until they are all drained or the budget is used up
+         * 
+         * @return true when frames are still queued
+         */
+        static bool poll_adapters();
+
+        /**
+         * @param adapter 
+         * @param frame 
+         * @return true when the frame was handed to a protocol
+         */
+        static bool handle_frame(NetworkAdapter&, PacketSlice frame);
+
+        /**
+         * @brief hands udp packets addressed to adapter, or broadcast on its subnet, to the
+         *        socket IPv4SocketDemux finds for them, and icmp to the raw sockets. tcp and
+         *        fragments are left unhandled
+         *
+         * @param adapter
+         * @param packet
+         * @return true when a socket took the packet
+         */
+        static bool handle_ipv4(NetworkAdapter&, PacketSlice packet);
+
+        /**
+         * @brief hands an icmp packet to every raw icmp socket
+         *
+         * @param packet
+         * @return true when a socket took the packet
+         */
+        static bool handle_icmp(PacketSlice packet);
     }; // class NetworkTask
 
 } // namespace Kernel
@@ -0,0 +1,142 @@
+/**
+ * @file packetbuffer.cpp
+ * @author Krisna Pranav
+ * @brief packet buffer
+ * @version 6.0
+ * @date 2023-09-24
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <mods/singleton.h>
+#include <kernel/arch/i386/cpu.h>
+#include <kernel/heap/kmalloc.h>
+#include <kernel/net/packetbuffer.h>
+#include <kernel/stdlib.h>
+
+namespace Kernel
+{
+
+    static Mods::Singleton<PacketBufferPool> s_the;
+
+    /**
+     * @return PacketBufferPool&
+     */
+    PacketBufferPool& PacketBufferPool::the()
+    {
+        return *s_the;
+    }
+
+    /// @brief Construct a new PacketBufferPool object
+    PacketBufferPool::PacketBufferPool()
+    {
+        m_region = KBuffer::create_with_size(slot_size * slot_count, Region::Access::Read | Region::Access::Write, "Packet buffers");
+
+        for (size_t i = 0; i < slot_count; ++i) {
+            auto& buffer = m_buffers[i];
+            buffer.m_data = m_region.value().data() + i * slot_size;
+            buffer.m_capacity = slot_size;
+            m_free_list.append(buffer);
+        }
+        m_free_slots = slot_count;
+    }
+
+    /**
+     * @brief called from the receive interrupt, where it never falls back to the heap
+     *
+     * @param bytes
+     * @return RefPtr<PacketBuffer>
+     */
+    RefPtr<PacketBuffer> PacketBufferPool::copy(ReadonlyBytes bytes)
+    {
+        if (bytes.size() > slot_size)
+            return copy_to_heap(bytes);
+
+        PacketBuffer* buffer = nullptr;
+        {
+            ScopedSpinLock lock(m_lock);
+            buffer = m_free_list.take_first();
+            if (buffer)
+                --m_free_slots;
+        }
+
+        if (!buffer) {
+            m_pool_failures.fetch_add(1, Mods::MemoryOrder::memory_order_relaxed);
+            return nullptr;
+        }
+
+        m_pool_allocations.fetch_add(1, Mods::MemoryOrder::memory_order_relaxed);
+
+        ASSERT(buffer->ref_count() == 0);
+        memcpy(buffer->m_data, bytes.data(), bytes.size());
+        buffer->m_size = bytes.size();
+        buffer->timestamp = {};
+        buffer->m_ref_count.store(1, Mods::MemoryOrder::memory_order_relaxed);
+        return adopt(*buffer);
+    }
+
+    /**
+     * @brief a buffer sized to the frame, for adapters whose mtu is larger than a slot.
+     *        The loopback hands its frames over from the sending thread, a driver's
+     *        receive interrupt can't allocate and drops them
+     *
+     * @param bytes
+     * @return RefPtr<PacketBuffer>
+     */
+    RefPtr<PacketBuffer> PacketBufferPool::copy_to_heap(ReadonlyBytes bytes)
+    {
+        if (Processor::current().in_irq()) {
+            m_oversized_failures.fetch_add(1, Mods::MemoryOrder::memory_order_relaxed);
+            return nullptr;
+        }
+
+        m_heap_allocations.fetch_add(1, Mods::MemoryOrder::memory_order_relaxed);
+
+        auto* buffer = new PacketBuffer;
+        buffer->m_data = static_cast<u8*>(kmalloc(bytes.size()));
+        buffer->m_capacity = bytes.size();
+        buffer->m_is_heap_allocated = true;
+        memcpy(buffer->m_data, bytes.data(), bytes.size());
+        buffer->m_size = bytes.size();
+        buffer->m_ref_count.store(1, Mods::MemoryOrder::memory_order_relaxed);
+        return adopt(*buffer);
+    }
+
+    /**
+     * @param buffer
+     */
+    void PacketBufferPool::release(PacketBuffer& buffer)
+    {
+        ScopedSpinLock lock(m_lock);
+        m_free_list.append(buffer);
+        ++m_free_slots;
+    }
+
+    /**
+     * @return size_t
+     */
+    size_t PacketBufferPool::free_slots() const
+    {
+        ScopedSpinLock lock(m_lock);
+        return m_free_slots;
+    }
+
+    void PacketBuffer::unref() const
+    {
+        auto* self = const_cast<PacketBuffer*>(this);
+        auto old_ref_count = m_ref_count.fetch_sub(1, Mods::MemoryOrder::memory_order_acq_rel);
+        ASSERT(old_ref_count > 0);
+        if (old_ref_count != 1)
+            return;
+
+        if (m_is_heap_allocated) {
+            kfree(self->m_data);
+            delete self;
+            return;
+        }
+
+        PacketBufferPool::the().release(*self);
+    }
+
+} // namespace Kernel
@@ -0,0 +1,295 @@
+/**
+ * @file packetbuffer.h
+ * @author Krisna Pranav
+ * @brief packet buffer
+ * @version 6.0
+ * @date 2023-09-24
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#pragma once
+
+#include <mods/atomic.h>
+#include <mods/intrusivelist.h>
+#include <mods/noncopyable.h>
+#include <mods/nonnullrefptr.h>
+#include <mods/optional.h>
+#include <mods/span.h>
+#include <mods/types.h>
+#include <kernel/kbuffer.h>
+#include <kernel/spinlock.h>
+#include <kernel/unixtypes.h>
+
+namespace Kernel
+{
+
+    class PacketBufferPool;
+
+    /**
+     * @brief one received frame. Buffers are refcounted by hand instead of through
+     *        RefCounted, so the last unref hands the slot back to its pool instead of
+     *        freeing it. Only frames too large for a slot get a buffer of their own
+     */
+    class PacketBuffer
+    {
+        MOD_MAKE_NONCOPYABLE(PacketBuffer);
+        MOD_MAKE_NONMOVABLE(PacketBuffer);
+
+    public:
+        void ref() const
+        {
+            m_ref_count.fetch_add(1, Mods::MemoryOrder::memory_order_relaxed);
+        }
+
+        void unref() const;
+
+        /**
+         * @return u32
+         */
+        u32 ref_count() const
+        {
+            return m_ref_count.load(Mods::MemoryOrder::memory_order_relaxed);
+        }
+
+        /**
+         * @return u8*
+         */
+        u8* data()
+        {
+            return m_data;
+        }
+
+        /**
+         * @return const u8*
+         */
+        const u8* data() const
+        {
+            return m_data;
+        }
+
+        /**
+         * @return size_t
+         */
+        size_t size() const
+        {
+            return m_size;
+        }
+
+        /**
+         * @return size_t
+         */
+        size_t capacity() const
+        {
+            return m_capacity;
+        }
+
+        /**
+         * @param size
+         */
+        void set_size(size_t size)
+        {
+            ASSERT(size <= m_capacity);
+            m_size = size;
+        }
+
+        /**
+         * @return ReadonlyBytes
+         */
+        ReadonlyBytes bytes() const
+        {
+            return { m_data, m_size };
+        }
+
+        timeval timestamp {};
+
+        /// @brief links the buffer into its pool's free list or an adapter's receive queue
+        IntrusiveListNode m_list_node;
+
+    private:
+        friend class PacketBufferPool;
+
+        PacketBuffer() { }
+
+        mutable Atomic<u32> m_ref_count { 0 };
+        u8* m_data { nullptr };
+        size_t m_size { 0 };
+        size_t m_capacity { 0 };
+        bool m_is_heap_allocated { false };
+    }; // class PacketBuffer
+
+    /**
+     * @brief a window into a packet buffer that keeps it alive. Each layer narrows the
+     *        slice it was handed to its payload, so ethernet, ip, tcp and the socket
+     *        queue all look at the bytes the driver wrote, without copying them
+     */
+    class PacketSlice
+    {
+    public:
+        /**
+         * @param buffer
+         */
+        explicit PacketSlice(NonnullRefPtr<PacketBuffer> buffer)
+            : m_buffer(move(buffer))
+            , m_offset(0)
+            , m_size(m_buffer->size())
+        {
+        }
+
+        /**
+         * @return const u8*
+         */
+        const u8* data() const
+        {
+            return m_buffer->data() + m_offset;
+        }
+
+        /**
+         * @return size_t
+         */
+        size_t size() const
+        {
+            return m_size;
+        }
+
+        /**
+         * @return ReadonlyBytes
+         */
+        ReadonlyBytes bytes() const
+        {
+            return { data(), m_size };
+        }
+
+        /**
+         * @return const timeval&
+         */
+        const timeval& timestamp() const
+        {
+            return m_buffer->timestamp;
+        }
+
+        /**
+         * @param offset
+         * @param size
+         * @return PacketSlice
+         */
+        PacketSlice slice(size_t offset, size_t size) const
+        {
+            ASSERT(offset <= m_size && size <= m_size - offset);
+            return PacketSlice(m_buffer, m_offset + offset, size);
+        }
+
+        /**
+         * @param offset
+         * @return PacketSlice
+         */
+        PacketSlice slice(size_t offset) const
+        {
+            ASSERT(offset <= m_size);
+            return slice(offset, m_size - offset);
+        }
+
+        /**
+         * @brief a header at the front of the slice, callers check the size first
+         *
+         * @tparam T
+         * @return const T&
+         */
+        template<typename T>
+        const T& as() const
+        {
+            ASSERT(sizeof(T) <= m_size);
+            return *reinterpret_cast<const T*>(data());
+        }
+
+    private:
+        /**
+         * @param buffer
+         * @param offset
+         * @param size
+         */
+        PacketSlice(NonnullRefPtr<PacketBuffer> buffer, size_t offset, size_t size)
+            : m_buffer(move(buffer))
+            , m_offset(offset)
+            , m_size(size)
+        {
+        }
+
+        NonnullRefPtr<PacketBuffer> m_buffer;
+        size_t m_offset { 0 };
+        size_t m_size { 0 };
+    }; // class PacketSlice
+
+    /**
+     * @brief fixed-size slots carved out of one region at boot, with their buffers on a
+     *        free list. Taking and returning a slot is a spinlocked list operation, so it
+     *        is fine from the receive interrupt. A frame larger than a slot, like the
+     *        loopback's, gets a heap buffer when it arrives outside an interrupt and is
+     *        dropped otherwise. A frame that finds the pool empty is dropped
+     */
+    class PacketBufferPool
+    {
+    public:
+        /// @brief room for a full ethernet frame at the default mtu
+        static constexpr size_t slot_size = 2 * KiB;
+        static constexpr size_t slot_count = 1024;
+
+        /**
+         * @return PacketBufferPool&
+         */
+        static PacketBufferPool& the();
+
+        /// @brief Construct a new PacketBufferPool object
+        PacketBufferPool();
+
+        /**
+         * @brief a buffer holding a copy of bytes, with one reference for the caller
+         *
+         * @param bytes
+         * @return RefPtr<PacketBuffer> null if the pool is empty, or bytes don't fit a slot
+         *         and can't be allocated for in interrupt context
+         */
+        RefPtr<PacketBuffer> copy(ReadonlyBytes bytes);
+
+        /**
+         * @return size_t
+         */
+        size_t free_slots() const;
+
+        /// @brief buffers handed out from the pool, and copies refused because it was empty
+        u64 pool_allocations() const { return m_pool_allocations.load(Mods::MemoryOrder::memory_order_relaxed); }
+        u64 pool_failures() const { return m_pool_failures.load(Mods::MemoryOrder::memory_order_relaxed); }
+
+        /// @brief frames larger than a slot, given a heap buffer or refused in interrupt context
+        u64 heap_allocations() const { return m_heap_allocations.load(Mods::MemoryOrder::memory_order_relaxed); }
+        u64 oversized_failures() const { return m_oversized_failures.load(Mods::MemoryOrder::memory_order_relaxed); }
+
+    private:
+        friend class PacketBuffer;
+
+        /**
+         * @param bytes
+         * @return RefPtr<PacketBuffer>
+         */
+        RefPtr<PacketBuffer> copy_to_heap(ReadonlyBytes bytes);
+
+        /**
+         * @param buffer
+         */
+        void release(PacketBuffer&);
+
+        Optional<KBuffer> m_region;
+        PacketBuffer m_buffers[slot_count];
+
+        mutable SpinLock<u8> m_lock;
+        IntrusiveList<PacketBuffer, &PacketBuffer::m_list_node> m_free_list;
+        size_t m_free_slots { 0 };
+
+        Atomic<u64> m_pool_allocations { 0 };
+        Atomic<u64> m_pool_failures { 0 };
+        Atomic<u64> m_heap_allocations { 0 };
+        Atomic<u64> m_oversized_failures { 0 };
+    }; // class PacketBufferPool
+
+} // namespace Kernel
@@ -0,0 +1,116 @@
+/**
+ * @file udp.h
+ * @author Krisna Pranav
+ * @brief udp
+ * @version 6.0
+ * @date 2023-09-24
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#pragma once
+
+#include <kernel/net/ipv4.h>
+
+namespace Kernel
+{
+
+    class [[gnu::packed]] UDPPacket
+    {
+    public:
+        UDPPacket() { }
+        ~UDPPacket() { }
+
+        /**
+         * @return u16
+         */
+        u16 source_port() const
+        {
+            return m_source_port;
+        }
+
+        /**
+         * @param port
+         */
+        void set_source_port(u16 port)
+        {
+            m_source_port = port;
+        }
+
+        /**
+         * @return u16
+         */
+        u16 destination_port() const
+        {
+            return m_destination_port;
+        }
+
+        /**
+         * @param port
+         */
+        void set_destination_port(u16 port)
+        {
+            m_destination_port = port;
+        }
+
+        /**
+         * @brief header included
+         *
+         * @return u16
+         */
+        u16 length() const
+        {
+            return m_length;
+        }
+
+        /**
+         * @param length
+         */
+        void set_length(u16 length)
+        {
+            m_length = length;
+        }
+
+        /**
+         * @return u16
+         */
+        u16 checksum() const
+        {
+            return m_checksum;
+        }
+
+        /**
+         * @param checksum
+         */
+        void set_checksum(u16 checksum)
+        {
+            m_checksum = checksum;
+        }
+
+        /**
+         * @return const void*
+         */
+        const void* payload() const
+        {
+            return this + 1;
+        }
+
+        /**
+         * @return void*
+         */
+        void* payload()
+        {
+            return this + 1;
+        }
+
+    private:
+        NetworkOrdered<u16> m_source_port;
+        NetworkOrdered<u16> m_destination_port;
+        NetworkOrdered<u16> m_length;
+        NetworkOrdered<u16> m_checksum;
+    }; // class UDPPacket
+
+    static_assert(sizeof(UDPPacket) == 8);
+
+} // namespace Kernel
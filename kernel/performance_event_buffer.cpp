@@ -12,16 +12,167 @@
 #include <mods/jsonarrayserializer.h>
 #include <mods/jsonobject.h>
 #include <mods/jsonobjectserialize.h>
+#include <kernel/arch/i386/cpu.h>
 #include <kernel/kbufferbuilder.h>
 #include <kernel/performance_event_buffer.h>
 
 namespace Kernel 
 {
 
-    /// @brief Construct a new Performance Event Buffer:: Performance Event Buffer object
-    PerformanceEventBuffer::PerformanceEventBuffer()
-        : m_buffer(KBuffer::create_with_size(4 * MiB))
-    { }
+    /**
+     * @brief frame pointer walk of the current address space, capped at max_frames. Every
+     *        load goes through safe_memcpy, so a bad frame ends the walk instead of faulting,
+     *        and nothing allocates. That makes it usable from the timer interrupt
+     * 
+     * @param ebp 
+     * @param eip 
+     * @param frames 
+     * @param max_frames 
+     * @return size_t 
+     */
+    static size_t walk_stack(FlatPtr ebp, FlatPtr eip, FlatPtr* frames, size_t max_frames)
+    {
+        SmapDisabler disabler;
+
+        size_t count = 0;
+        frames[count++] = eip;
+
+        FlatPtr frame = ebp;
+        while (frame && count < max_frames) {
+            FlatPtr next_and_return[2];
+            void* fault_at;
+            if (!safe_memcpy(next_and_return, (const void*)frame, sizeof(next_and_return), fault_at))
+                break;
+            frames[count++] = next_and_return[1];
+            frame = next_and_return[0];
+        }
+
+        return count;
+    }
+
+    /**
+     * @param size 
+     */
+    PerformanceEventRing::PerformanceEventRing(size_t size)
+        : m_buffer(KBuffer::create_with_size(size))
+    {
+        size_t events = max(size / sizeof(Slot), static_cast<size_t>(1));
+        m_capacity = 1u << (31 - __builtin_clz(static_cast<u32>(events)));
+    }
+
+    /**
+     * @param event 
+     * @param overwrite 
+     * @return true 
+     * @return false 
+     */
+    bool PerformanceEventRing::push(const PerformanceEvent& event, bool overwrite)
+    {
+        u32 head = m_head.load(Mods::memory_order_relaxed);
+        u32 tail = m_tail.load(Mods::memory_order_acquire);
+
+        if (head - tail >= m_capacity) {
+            if (!overwrite) {
+                m_lost.fetch_add(1, Mods::memory_order_relaxed);
+                return false;
+            }
+
+            if (m_tail.compare_exchange_strong(tail, tail + 1, Mods::memory_order_acq_rel))
+                m_lost.fetch_add(1, Mods::memory_order_relaxed);
+        }
+
+        auto& entry = slot(head);
+        entry.sequence.store(0, Mods::memory_order_relaxed);
+        Mods::atomic_thread_fence(Mods::memory_order_release);
+        entry.event = event;
+        entry.sequence.store(head + 1, Mods::memory_order_release);
+
+        m_head.store(head + 1, Mods::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @param index 
+     * @param event 
+     * @return true 
+     * @return false 
+     */
+    bool PerformanceEventRing::read(u32 index, PerformanceEvent& event) const
+    {
+        auto& entry = slot(index);
+        u32 sequence = entry.sequence.load(Mods::memory_order_acquire);
+        if (sequence != index + 1)
+            return false;
+
+        event = entry.event;
+        Mods::atomic_thread_fence(Mods::memory_order_acquire);
+        return entry.sequence.load(Mods::memory_order_relaxed) == sequence;
+    }
+
+    /**
+     * @param event 
+     * @return true 
+     * @return false 
+     */
+    bool PerformanceEventRing::pop(PerformanceEvent& event)
+    {
+        for (;;) {
+            u32 tail = m_tail.load(Mods::memory_order_acquire);
+            if (tail == m_head.load(Mods::memory_order_acquire))
+                return false;
+
+            bool intact = read(tail, event);
+            if (!m_tail.compare_exchange_strong(tail, tail + 1, Mods::memory_order_acq_rel))
+                continue;
+            if (intact)
+                return true;
+        }
+    }
+
+    /**
+     * @param policy 
+     * @param size 
+     */
+    PerformanceEventBuffer::PerformanceEventBuffer(OverflowPolicy policy, size_t size)
+        : m_policy(policy)
+    {
+        size_t processor_count = max(static_cast<size_t>(Processor::count()), static_cast<size_t>(1));
+        for (size_t i = 0; i < processor_count; ++i)
+            m_rings.append(make<PerformanceEventRing>(size / processor_count));
+    }
+
+    /**
+     * @return size_t 
+     */
+    size_t PerformanceEventBuffer::capacity() const
+    {
+        size_t capacity = 0;
+        for (auto& ring : m_rings)
+            capacity += ring.capacity();
+        return capacity;
+    }
+
+    /**
+     * @return size_t 
+     */
+    size_t PerformanceEventBuffer::count() const
+    {
+        size_t count = 0;
+        for (auto& ring : m_rings)
+            count += ring.count();
+        return count;
+    }
+
+    /**
+     * @return size_t 
+     */
+    size_t PerformanceEventBuffer::lost() const
+    {
+        size_t lost = 0;
+        for (auto& ring : m_rings)
+            lost += ring.lost();
+        return lost;
+    }
 
     /**
      * @param type 
@@ -31,11 +182,35 @@ namespace Kernel
      */
     KResult PerformanceEventBuffer::append(int type, FlatPtr arg1, FlatPtr arg2)
     {
-        if (count() >= capacity())
-            return KResult(-ENOBUFS);
+        if (type == PERF_EVENT_SAMPLE)
+            return KResult(-EINVAL);
+
+        FlatPtr ebp;
+
+        asm volatile("movl %%ebp, %%eax"
+                    : "=a"(ebp));
 
+        auto current_thread = Thread::current();
+        auto eip = current_thread->get_register_dump_from_stack().eip;
+
+        return append_with_eip_and_ebp(*current_thread, eip, ebp, type, arg1, arg2);
+    }
+
+    /**
+     * @param thread 
+     * @param eip 
+     * @param ebp 
+     * @param type 
+     * @param arg1 
+     * @param arg2 
+     * @return KResult 
+     */
+    KResult PerformanceEventBuffer::append_with_eip_and_ebp(Thread& thread, FlatPtr eip, FlatPtr ebp, int type, FlatPtr arg1, FlatPtr arg2)
+    {
         PerformanceEvent event;
         event.type = type;
+        event.pid = thread.pid().value();
+        event.tid = thread.tid().value();
 
         switch (type) {
         case PERF_EVENT_MALLOC:
@@ -55,21 +230,8 @@ namespace Kernel
             return KResult(-EINVAL);
         }
 
-        FlatPtr ebp;
-
-        asm volatile("movl %%ebp, %%eax"
-                    : "=a"(ebp));
-
-        auto current_thread = Thread::current();
-        auto eip = current_thread->get_register_dump_from_stack().eip;
-
-        Vector<FlatPtr> backtrace;
-        {
-            SmapDisabler disabler;
-            backtrace = current_thread->raw_backtrace(ebp, eip);
-        }
-        event.stack_size = min(sizeof(event.stack) / sizeof(FlatPtr), static_cast<size_t>(backtrace.size()));
-        memcpy(event.stack, backtrace.data(), event.stack_size * sizeof(FlatPtr));
+        ASSERT(&thread == Thread::current());
+        event.stack_size = walk_stack(ebp, eip, event.stack, sizeof(event.stack) / sizeof(FlatPtr));
 
     #ifdef VERY_DEBUG
         for (size_t i = 0; i < event.stack_size; ++i)
@@ -77,21 +239,169 @@ namespace Kernel
     #endif
 
         event.timestamp = TimeManagement::the().uptime_ms();
-        at(m_count++) = event;
+        return push(event);
+    }
+
+    /**
+     * @param thread 
+     * @param eip 
+     * @param ebp 
+     * @param interval_ticks 
+     * @return KResult 
+     */
+    KResult PerformanceEventBuffer::append_sample(Thread& thread, FlatPtr eip, FlatPtr ebp, u32 interval_ticks)
+    {
+        PerformanceEvent event;
+        event.type = PERF_EVENT_SAMPLE;
+        event.pid = thread.pid().value();
+        event.tid = thread.tid().value();
+        event.data.sample.interval_ticks = interval_ticks;
+        event.stack_size = walk_stack(ebp, eip, event.stack, sizeof(event.stack) / sizeof(FlatPtr));
+        event.timestamp = TimeManagement::the().uptime_ms();
+        return push(event);
+    }
+
+    /**
+     * @param event 
+     * @return KResult 
+     */
+    KResult PerformanceEventBuffer::push(const PerformanceEvent& event)
+    {
+        ScopedCritical critical;
+        u32 cpu = Processor::current().id();
+        ASSERT(cpu < m_rings.size());
+        if (!m_rings[cpu].push(event, m_policy == OverflowPolicy::Overwrite))
+            return KResult(-ENOBUFS);
 
         return KSuccess;
     }
 
     /**
-     * @param index 
-     * @return PerformanceEvent& 
+     * @param callback 
+     * @param max_events 
+     * @return size_t 
      */
-    PerformanceEvent& PerformanceEventBuffer::at(size_t index)
+    size_t PerformanceEventBuffer::drain(Function<void(const PerformanceEvent&)> callback, size_t max_events)
     {
-        ASSERT(index < capacity());
-        auto* events = reinterpret_cast<PerformanceEvent*>(m_buffer.data());
+        size_t drained = 0;
+        PerformanceEvent event;
+        bool progress = true;
+        while (drained < max_events && progress) {
+            progress = false;
+            for (auto& ring : m_rings) {
+                if (drained == max_events)
+                    break;
+                if (!ring.pop(event))
+                    continue;
+                callback(event);
+                ++drained;
+                progress = true;
+            }
+        }
+        return drained;
+    }
 
-        return events[index];
+    /**
+     * @param builder 
+     * @param event 
+     */
+    void PerformanceEventBuffer::append_binary_event(KBufferBuilder& builder, const PerformanceEvent& event)
+    {
+        builder.append((const char*)&event.type, sizeof(event.type));
+        builder.append((const char*)&event.stack_size, sizeof(event.stack_size));
+        builder.append((const char*)&event.pid, sizeof(event.pid));
+        builder.append((const char*)&event.tid, sizeof(event.tid));
+        builder.append((const char*)&event.timestamp, sizeof(event.timestamp));
+
+        switch (event.type) {
+        case PERF_EVENT_SAMPLE:
+            builder.append((const char*)&event.data.sample.interval_ticks, sizeof(event.data.sample.interval_ticks));
+            break;
+        case PERF_EVENT_MALLOC:
+            builder.append((const char*)&event.data.malloc.size, sizeof(event.data.malloc.size));
+            builder.append((const char*)&event.data.malloc.ptr, sizeof(event.data.malloc.ptr));
+            break;
+        case PERF_EVENT_FREE:
+            builder.append((const char*)&event.data.free.ptr, sizeof(event.data.free.ptr));
+            break;
+        }
+
+        builder.append((const char*)event.stack, event.stack_size * sizeof(FlatPtr));
+    }
+
+    /**
+     * @param builder 
+     * @param pid 
+     * @param executable_path 
+     */
+    void PerformanceEventBuffer::append_binary_header(KBufferBuilder& builder, ProcessID pid, const String& executable_path)
+    {
+        PerformanceEventBinaryHeader header;
+        header.magic = performance_event_binary_magic;
+        header.version = 4;
+        header.pointer_size = sizeof(FlatPtr);
+        header.pid = pid.value();
+        header.executable_path_length = executable_path.length();
+        builder.append((const char*)&header, sizeof(header));
+        builder.append(executable_path.characters(), executable_path.length());
+    }
+
+    /**
+     * @param builder 
+     * @param max_events 
+     * @return size_t 
+     */
+    size_t PerformanceEventBuffer::drain_binary(KBufferBuilder& builder, size_t max_events)
+    {
+        return drain([&](const PerformanceEvent& event) {
+            append_binary_event(builder, event);
+        },
+            max_events);
+    }
+
+    /**
+     * @brief a k-way merge: every ring is walked from its oldest slot, and the ring whose
+     *        next event is the oldest goes first. Slots overwritten during the walk are skipped
+     * 
+     * @param callback 
+     */
+    void PerformanceEventBuffer::for_each_event(Function<void(const PerformanceEvent&)> callback) const
+    {
+        struct Cursor
+        {
+            const PerformanceEventRing* ring;
+            u32 index;
+            u32 head;
+            bool has_event;
+            PerformanceEvent event;
+
+            void advance()
+            {
+                has_event = false;
+                while (!has_event && index != head)
+                    has_event = ring->read(index++, event);
+            }
+        };
+
+        Vector<Cursor> cursors;
+        cursors.ensure_capacity(m_rings.size());
+        for (auto& ring : m_rings) {
+            Cursor cursor { &ring, ring.tail(), ring.head(), false, {} };
+            cursor.advance();
+            cursors.unchecked_append(cursor);
+        }
+
+        for (;;) {
+            Cursor* oldest = nullptr;
+            for (auto& cursor : cursors) {
+                if (cursor.has_event && (!oldest || cursor.event.timestamp < oldest->event.timestamp))
+                    oldest = &cursor;
+            }
+            if (!oldest)
+                break;
+            callback(oldest->event);
+            oldest->advance();
+        }
     }
 
     /**
@@ -109,11 +419,14 @@ namespace Kernel
 
         auto array = object.add_array("events");
 
-        for (size_t i = 0; i < m_count; ++i) {
-            auto& event = at(i);
+        for_each_event([&](const PerformanceEvent& event) {
             auto event_object = array.add_object();
 
             switch (event.type) {
+            case PERF_EVENT_SAMPLE:
+                event_object.add("type", "sample");
+                event_object.add("interval_ticks", event.data.sample.interval_ticks);
+                break;
             case PERF_EVENT_MALLOC:
                 event_object.add("type", "malloc");
                 event_object.add("ptr", static_cast<u64>(event.data.malloc.ptr));
@@ -125,6 +438,8 @@ namespace Kernel
                 break;
             }
 
+            event_object.add("pid", event.pid);
+            event_object.add("tid", event.tid);
             event_object.add("timestamp", event.timestamp);
             auto stack_array = event_object.add_array("stack");
 
@@ -134,7 +449,7 @@ namespace Kernel
 
             stack_array.finish();
             event_object.finish();
-        }
+        });
 
         array.finish();
         object.finish();
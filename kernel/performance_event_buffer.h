@@ -11,7 +11,12 @@
 
 #pragma once 
 
+#include <mods/atomic.h>
+#include <mods/function.h>
+#include <mods/nonnullownptrvector.h>
+#include <kernel/forward.h>
 #include <kernel/kbuffer.h>
+#include <kernel/kbufferbuilder.h>
 #include <kernel/kresult.h>
 
 namespace Kernel 
@@ -29,39 +34,106 @@ namespace Kernel
         FlatPtr ptr;
     }; // struct FreePerformanceEvent
 
+    struct [[gnu::packed]] SamplePerformanceEvent
+    {
+        u32 interval_ticks;
+    }; // struct SamplePerformanceEvent
+
     struct [[gnu::packed]] PerformanceEvent
     {
         u8 type { 0 };
         u8 stack_size { 0 };
+        u32 pid { 0 };
+        u32 tid { 0 };
         u64 timestamp;
         union 
         {
             MallocPerformanceEvent malloc;
             FreePerformanceEvent free;
+            SamplePerformanceEvent sample;
         } data;
         FlatPtr stack[32];
     }; // struct PerformanceEvent
 
-    class PerformanceEventBuffer 
+    /**
+     * @brief compact export: one header, then per event the fixed fields, the type specific
+     *        payload and stack_size frames. All fields are little endian and unpadded.
+     */
+    struct [[gnu::packed]] PerformanceEventBinaryHeader
     {
+        u32 magic;
+        u16 version;
+        u16 pointer_size;
+        u32 pid;
+        u32 executable_path_length;
+    }; // struct PerformanceEventBinaryHeader
+
+    static constexpr u32 performance_event_binary_magic = 0x31424550; // "PEB1"
+
+    /**
+     * @brief single-producer ring, written only by the processor it belongs to. Every slot
+     *        carries a sequence number, so a reader can tell a record that was overwritten
+     *        while it copied it from an intact one
+     * 
+     */
+    class PerformanceEventRing 
+    {
+        MOD_MAKE_NONCOPYABLE(PerformanceEventRing);
+
     public:
-        /// @brief Construct a new Performance Event Buffer object
-        PerformanceEventBuffer();
+        /**
+         * @param size 
+         */
+        explicit PerformanceEventRing(size_t size);
 
         /**
-         * @param type 
-         * @param arg1 
-         * @param arg2 
-         * @return KResult 
+         * @param event 
+         * @param overwrite 
+         * @return true 
+         * @return false 
          */
-        KResult append(int type, FlatPtr arg1, FlatPtr arg2);
+        bool push(const PerformanceEvent& event, bool overwrite);
+
+        /**
+         * @param event 
+         * @return true 
+         * @return false 
+         */
+        bool pop(PerformanceEvent& event);
+
+        /**
+         * @brief copy the event at index without consuming it. Fails if the slot has been
+         *        reused for a later event, or was rewritten during the copy
+         * 
+         * @param index 
+         * @param event 
+         * @return true 
+         * @return false 
+         */
+        bool read(u32 index, PerformanceEvent& event) const;
+
+        /**
+         * @return u32 
+         */
+        u32 head() const 
+        { 
+            return m_head.load(Mods::memory_order_acquire); 
+        }
+
+        /**
+         * @return u32 
+         */
+        u32 tail() const 
+        { 
+            return m_tail.load(Mods::memory_order_acquire); 
+        }
 
         /**
          * @return size_t 
          */
         size_t capacity() const 
         { 
-            return m_buffer.size() / sizeof(PerformanceEvent); 
+            return m_capacity; 
         }
 
         /**
@@ -69,18 +141,140 @@ namespace Kernel
          */
         size_t count() const 
         { 
-            return m_count; 
+            return head() - tail(); 
+        }
+
+        /**
+         * @return size_t 
+         */
+        size_t lost() const 
+        { 
+            return m_lost.load(Mods::memory_order_relaxed); 
         }
 
+    private:
+        struct Slot 
+        {
+            // index + 1 of the event in the slot, 0 while it is being written
+            Atomic<u32> sequence { 0 };
+            PerformanceEvent event;
+        }; // struct Slot
+
         /**
          * @param index 
-         * @return const PerformanceEvent& 
+         * @return Slot& 
          */
-        const PerformanceEvent& at(size_t index) const
+        Slot& slot(u32 index) const
         {
-            return const_cast<PerformanceEventBuffer&>(*this).at(index);
+            return reinterpret_cast<Slot*>(const_cast<u8*>(m_buffer.data()))[index & (m_capacity - 1)];
         }
 
+        KBuffer m_buffer;
+        u32 m_capacity { 0 };
+        Atomic<u32> m_head { 0 };
+        Atomic<u32> m_tail { 0 };
+        Atomic<u32> m_lost { 0 };
+    }; // class PerformanceEventRing
+
+    class PerformanceEventBuffer 
+    {
+    public:
+        enum class OverflowPolicy 
+        {
+            Drop,
+            Overwrite,
+        };
+
+        /**
+         * @brief Construct a new Performance Event Buffer object, with one ring per processor
+         * 
+         * @param policy 
+         * @param size 
+         */
+        explicit PerformanceEventBuffer(OverflowPolicy policy = OverflowPolicy::Drop, size_t size = 4 * MiB);
+
+        /**
+         * @param type 
+         * @param arg1 
+         * @param arg2 
+         * @return KResult 
+         */
+        KResult append(int type, FlatPtr arg1, FlatPtr arg2);
+
+        /**
+         * @brief record an event whose backtrace starts at eip/ebp rather than at the caller.
+         *        thread must be the current one, its stack is walked in the active address space
+         * 
+         * @param thread 
+         * @param eip 
+         * @param ebp 
+         * @param type 
+         * @param arg1 
+         * @param arg2 
+         * @return KResult 
+         */
+        KResult append_with_eip_and_ebp(Thread& thread, FlatPtr eip, FlatPtr ebp, int type, FlatPtr arg1, FlatPtr arg2);
+
+        /**
+         * @brief record a PERF_EVENT_SAMPLE from the timer interrupt, with the backtrace of
+         *        the interrupted context. Nothing on this path allocates or can fault
+         * 
+         * @param thread 
+         * @param eip 
+         * @param ebp 
+         * @param interval_ticks 
+         * @return KResult 
+         */
+        KResult append_sample(Thread& thread, FlatPtr eip, FlatPtr ebp, u32 interval_ticks);
+
+        /**
+         * @return size_t 
+         */
+        size_t capacity() const;
+
+        /**
+         * @return size_t 
+         */
+        size_t count() const;
+
+        /**
+         * @brief events dropped (Drop) or overwritten (Overwrite) because a ring was full
+         * 
+         * @return size_t 
+         */
+        size_t lost() const;
+
+        /**
+         * @return OverflowPolicy 
+         */
+        OverflowPolicy overflow_policy() const 
+        { 
+            return m_policy; 
+        }
+
+        /**
+         * @brief consume up to max_events, oldest first per processor
+         * 
+         * @param max_events 
+         * @return size_t 
+         */
+        size_t drain(Function<void(const PerformanceEvent&)>, size_t max_events);
+
+        /**
+         * @brief consume up to max_events into builder using the binary event encoding
+         * 
+         * @param builder 
+         * @param max_events 
+         * @return size_t 
+         */
+        size_t drain_binary(KBufferBuilder& builder, size_t max_events);
+
+        /**
+         * @param builder 
+         * @param executable_path 
+         */
+        static void append_binary_header(KBufferBuilder& builder, ProcessID, const String& executable_path);
+
         /**
          * @param executable_path 
          * @return KBuffer 
@@ -89,14 +283,27 @@ namespace Kernel
 
     private:
         /**
-         * @param index 
-         * @return PerformanceEvent& 
+         * @brief every event still in the buffer, in timestamp order across the rings
+         * 
          */
-        PerformanceEvent& at(size_t index);
+        void for_each_event(Function<void(const PerformanceEvent&)>) const;
 
-        size_t m_count { 0 };
-        
-        KBuffer m_buffer;
+        /**
+         * @param builder 
+         * @param event 
+         */
+        static void append_binary_event(KBufferBuilder& builder, const PerformanceEvent& event);
+
+        /**
+         * @brief push onto the current processor's ring
+         * 
+         * @param event 
+         * @return KResult 
+         */
+        KResult push(const PerformanceEvent& event);
+
+        OverflowPolicy m_policy { OverflowPolicy::Drop };
+        NonnullOwnPtrVector<PerformanceEventRing> m_rings;
     }; // class PerformanceEventBuffer 
 
 } // namespace Kernel
\ No newline at end of file
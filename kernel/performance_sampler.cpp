@@ -0,0 +1,117 @@
+/**
+ * @file performance_sampler.cpp
+ * @author Krisna Pranav
+ * @brief timer driven cpu sampling
+ * @version 6.0
+ * @date 2023-09-10
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <mods/ownptr.h>
+#include <kernel/arch/i386/cpu.h>
+#include <kernel/performance_event_buffer.h>
+#include <kernel/performance_sampler.h>
+#include <kernel/process.h>
+#include <kernel/spinlock.h>
+#include <kernel/thread.h>
+#include <kernel/time/timemanagement.h>
+
+namespace Kernel
+{
+
+    Atomic<u32> PerformanceSampler::s_armed { 0 };
+    Atomic<u32> PerformanceSampler::s_interval_ticks { 1 };
+    Atomic<bool> PerformanceSampler::s_system_wide { false };
+
+    static SpinLock<u8> s_sampler_lock;
+    static Atomic<PerformanceEventBuffer*> s_global_events { nullptr };
+
+    /**
+     * @param frequency
+     * @return KResult
+     */
+    KResult PerformanceSampler::set_frequency(u32 frequency)
+    {
+        if (frequency == 0)
+            return KResult(-EINVAL);
+
+        u32 ticks_per_second = TimeManagement::the().ticks_per_second();
+        u32 interval = max(ticks_per_second / min(frequency, ticks_per_second), 1u);
+        s_interval_ticks.store(interval, Mods::memory_order_relaxed);
+        return KSuccess;
+    }
+
+    /**
+     * @return u32
+     */
+    u32 PerformanceSampler::frequency()
+    {
+        return TimeManagement::the().ticks_per_second() / interval_ticks();
+    }
+
+    /**
+     * @return KResult
+     */
+    KResult PerformanceSampler::enable_system_wide()
+    {
+        OwnPtr<PerformanceEventBuffer> buffer;
+        if (!global_events())
+            buffer = make<PerformanceEventBuffer>(PerformanceEventBuffer::OverflowPolicy::Overwrite);
+
+        ScopedSpinLock lock(s_sampler_lock);
+        if (s_system_wide.load(Mods::memory_order_relaxed))
+            return KResult(-EBUSY);
+
+        if (!s_global_events.load(Mods::memory_order_acquire) && buffer)
+            s_global_events.store(buffer.leak_ptr(), Mods::memory_order_release);
+
+        s_system_wide.store(true, Mods::memory_order_release);
+        s_armed.fetch_add(1, Mods::memory_order_relaxed);
+        return KSuccess;
+    }
+
+    void PerformanceSampler::disable_system_wide()
+    {
+        ScopedSpinLock lock(s_sampler_lock);
+        if (!s_system_wide.load(Mods::memory_order_relaxed))
+            return;
+
+        s_system_wide.store(false, Mods::memory_order_release);
+        s_armed.fetch_sub(1, Mods::memory_order_relaxed);
+    }
+
+    /**
+     * @return PerformanceEventBuffer*
+     */
+    PerformanceEventBuffer* PerformanceSampler::global_events()
+    {
+        return s_global_events.load(Mods::memory_order_acquire);
+    }
+
+    /**
+     * @param regs
+     */
+    void PerformanceSampler::sample(const RegisterState& regs)
+    {
+        ASSERT_INTERRUPTS_DISABLED();
+
+        auto* thread = Thread::current();
+        if (!thread)
+            return;
+
+        u32 interval = interval_ticks();
+        if (thread->ticks() % interval != 0)
+            return;
+
+        if (thread->process().is_profiling()) {
+            if (auto* events = thread->process().perf_events())
+                (void)events->append_sample(*thread, regs.eip, regs.ebp, interval);
+        }
+
+        if (s_system_wide.load(Mods::memory_order_acquire))
+            (void)global_events()->append_sample(*thread, regs.eip, regs.ebp, interval);
+    }
+
+} // namespace Kernel
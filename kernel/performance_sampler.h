@@ -0,0 +1,146 @@
+/**
+ * @file performance_sampler.h
+ * @author Krisna Pranav
+ * @brief timer driven cpu sampling
+ * @version 6.0
+ * @date 2023-09-10
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#pragma once
+
+#include <mods/atomic.h>
+#include <mods/noncopyable.h>
+#include <mods/types.h>
+#include <kernel/forward.h>
+#include <kernel/kresult.h>
+
+namespace Kernel
+{
+
+    struct RegisterState;
+
+    class PerformanceSampler
+    {
+    public:
+        static constexpr u32 default_frequency = 1000;
+
+        /**
+         * @brief called from Scheduler::timer_tick for the thread it interrupted, and from
+         *        nowhere else. Costs a single relaxed load while nothing is being profiled
+         *
+         * @param regs
+         */
+        ALWAYS_INLINE static void timer_tick(const RegisterState& regs)
+        {
+            if (s_armed.load(Mods::memory_order_relaxed) == 0)
+                return;
+            sample(regs);
+        }
+
+        /**
+         * @brief samples per second of cpu time, clamped to the system timer rate
+         *
+         * @param frequency
+         * @return KResult
+         */
+        static KResult set_frequency(u32 frequency);
+
+        /**
+         * @return u32
+         */
+        static u32 frequency();
+
+        /**
+         * @return u32
+         */
+        static u32 interval_ticks()
+        {
+            return s_interval_ticks.load(Mods::memory_order_relaxed);
+        }
+
+        /**
+         * @brief start sampling every thread into the global event buffer
+         *
+         * @return KResult
+         */
+        static KResult enable_system_wide();
+
+        static void disable_system_wide();
+
+        /**
+         * @return true
+         * @return false
+         */
+        static bool is_system_wide()
+        {
+            return s_system_wide.load(Mods::memory_order_relaxed);
+        }
+
+        /**
+         * @brief events from system wide sampling, null until it is first enabled
+         *
+         * @return PerformanceEventBuffer*
+         */
+        static PerformanceEventBuffer* global_events();
+
+        /**
+         * @brief a process's share of the armed count. Held by value in Process, so the
+         *        count drops again when a profiled process is torn down
+         */
+        class Arming
+        {
+            MOD_MAKE_NONCOPYABLE(Arming);
+
+        public:
+            Arming() = default;
+
+            ~Arming()
+            {
+                set(false);
+            }
+
+            /**
+             * @param armed
+             */
+            void set(bool armed)
+            {
+                if (m_armed == armed)
+                    return;
+                m_armed = armed;
+                if (armed)
+                    s_armed.fetch_add(1, Mods::memory_order_relaxed);
+                else
+                    s_armed.fetch_sub(1, Mods::memory_order_relaxed);
+            }
+
+            /**
+             * @return true
+             * @return false
+             */
+            bool is_set() const
+            {
+                return m_armed;
+            }
+
+        private:
+            bool m_armed { false };
+        }; // class Arming
+
+    private:
+        /**
+         * @brief records only eip/ebp of the interrupted context, nothing on this path
+         *        may allocate or touch user memory
+         *
+         * @param regs
+         */
+        static void sample(const RegisterState& regs);
+
+        static Atomic<u32> s_armed;
+        static Atomic<u32> s_interval_ticks;
+        static Atomic<bool> s_system_wide;
+    }; // class PerformanceSampler
+
+} // namespace Kernel
@@ -18,12 +18,15 @@
 #include <mods/inlinelinkedlist.h>
 #include <mods/nonnullownptrvector.h>
 #include <mods/nonnullrefptrvector.h>
+#include <mods/redblacktree.h>
 #include <mods/string.h>
 #include <mods/usrspace.h>
 #include <mods/weakable.h>
 #include <mods/weakptr.h>
 #include <kernel/forward.h>
+#include <kernel/futexqueue.h>
 #include <kernel/lock.h>
+#include <kernel/performance_sampler.h>
 #include <kernel/processgroup.h>
 #include <kernel/stdlib.h>
 #include <kernel/thread.h>
@@ -224,7 +227,7 @@ namespace Kernel
          */
         bool is_profiling() const 
         { 
-            return m_profiling; 
+            return m_profiling.is_set(); 
         }
 
         /**
@@ -232,7 +235,15 @@ namespace Kernel
          */
         void set_profiling(bool profiling) 
         { 
-            m_profiling = profiling; 
+            m_profiling.set(profiling); 
+        }
+
+        /**
+         * @return PerformanceEventBuffer* 
+         */
+        PerformanceEventBuffer* perf_events() 
+        { 
+            return m_perf_event_buffer.ptr(); 
         }
 
         /**
@@ -587,6 +598,27 @@ namespace Kernel
         /// @brief writev
         ssize_t sys$writev(int fd, Userspace<const struct iovec*> iov, int iov_count);
 
+        /// @brief readv
+        ssize_t sys$readv(int fd, Userspace<const struct iovec*> iov, int iov_count);
+
+        /// @brief pread
+        ssize_t sys$pread(Userspace<const Syscall::SC_pread_params*>);
+
+        /// @brief pwrite
+        ssize_t sys$pwrite(Userspace<const Syscall::SC_pwrite_params*>);
+
+        /// @brief preadv
+        ssize_t sys$preadv(Userspace<const Syscall::SC_preadv_params*>);
+
+        /// @brief pwritev
+        ssize_t sys$pwritev(Userspace<const Syscall::SC_preadv_params*>);
+
+        /// @brief sendfile
+        ssize_t sys$sendfile(Userspace<const Syscall::SC_sendfile_params*>);
+
+        /// @brief splice
+        ssize_t sys$splice(Userspace<const Syscall::SC_splice_params*>);
+
         /// @brief fstat
         int sys$fstat(int fd, Userspace<stat*>);
 
@@ -635,6 +667,15 @@ namespace Kernel
         /// @brief poll
         int sys$poll(Userspace<const Syscall::SC_poll_params*>);
 
+        /// @brief epoll_create
+        int sys$epoll_create(int flags);
+
+        /// @brief epoll_ctl
+        int sys$epoll_ctl(Userspace<const Syscall::SC_epoll_ctl_params*>);
+
+        /// @brief epoll_wait
+        int sys$epoll_wait(Userspace<const Syscall::SC_epoll_wait_params*>);
+
         /// @brief get_dir_entries
         ssize_t sys$get_dir_entries(int fd, void*, ssize_t);
 
@@ -902,6 +943,12 @@ namespace Kernel
         /// @brief profiling disable
         int sys$profiling_disable(pid_t);
 
+        /// @brief profiling set frequency
+        int sys$profiling_set_frequency(u32 frequency);
+
+        /// @brief profiling read
+        ssize_t sys$profiling_read(pid_t, Userspace<u8*>, size_t);
+
         /// @brief futex
         int sys$futex(Userspace<const Syscall::SC_futex_params*>);
 
@@ -986,15 +1033,38 @@ namespace Kernel
             return m_regions.size(); 
         }
 
+        using RegionTree = RedBlackTree<FlatPtr, NonnullOwnPtr<Region>>;
+
         /**
-         * @return const NonnullOwnPtrVector<Region>& 
+         * @brief keyed by Range::base(), iterates in address order
+         * 
+         * @return const RegionTree& 
          */
-        const NonnullOwnPtrVector<Region>& regions() const
+        const RegionTree& regions() const
         {
             ASSERT(m_lock.is_locked());
             return m_regions;
         }
 
+        /**
+         * @brief O(log n), the fault path first tries the faulting thread's last hit
+         * 
+         * @return Region* 
+         */
+        Region* find_region_from_vaddr(VirtualAddress);
+
+        /**
+         * @param region 
+         * @return Region* 
+         */
+        Region* previous_region(const Region& region);
+
+        /**
+         * @param region 
+         * @return Region* 
+         */
+        Region* next_region(const Region& region);
+
         void dump_regions();
 
         u32 m_ticks_in_user { 0 };
@@ -1132,6 +1202,14 @@ namespace Kernel
          */
         Region& allocate_split_region(const Region& source_region, const Range&, size_t offset_in_vmobject);
 
+        /**
+         * @brief unlink region from the region tree without unmapping it
+         * 
+         * @param region 
+         * @return NonnullOwnPtr<Region> 
+         */
+        NonnullOwnPtr<Region> take_region(Region& region);
+
         /**
          * @param source_region 
          * @return Vector<Region*, 2> 
@@ -1341,6 +1419,38 @@ namespace Kernel
          */
         ssize_t do_write(FileDescription&, const UserOrKernelBuffer&, size_t);
 
+        /**
+         * @brief copy in an iovec array for the vectored syscalls and check its total length
+         *
+         * @param vecs
+         * @param iov
+         * @param iov_count
+         * @return KResult
+         */
+        KResult copy_iovecs_from_user(Vector<iovec, 32>& vecs, Userspace<const struct iovec*> iov, int iov_count);
+
+        /**
+         * @param description
+         * @param vecs
+         * @param offset
+         * @return ssize_t
+         */
+        ssize_t do_preadv(FileDescription&, const Vector<iovec, 32>& vecs, u64 offset);
+        ssize_t do_pwritev(FileDescription&, const Vector<iovec, 32>& vecs, u64 offset);
+
+        /**
+         * @brief move data from in to out inside the kernel, without the offsets the
+         *        descriptions' own offsets are used and moved
+         *
+         * @param in
+         * @param in_offset
+         * @param out
+         * @param out_offset
+         * @param count
+         * @return ssize_t
+         */
+        ssize_t do_transfer(FileDescription& in, Optional<u64>& in_offset, FileDescription& out, Optional<u64>& out_offset, size_t count);
+
         /**
          * @param path 
          * @param nread 
@@ -1518,7 +1628,7 @@ namespace Kernel
         const bool m_is_kernel_process;
 
         bool m_dead { false };
-        bool m_profiling { false };
+        PerformanceSampler::Arming m_profiling;
         Atomic<bool> m_is_stopped { false };
         bool m_should_dump_core { false };
 
@@ -1532,7 +1642,7 @@ namespace Kernel
         Region* find_region_from_range(const Range&);
         Region* find_region_containing(const Range&);
 
-        NonnullOwnPtrVector<Region> m_regions;
+        RegionTree m_regions;
         struct RegionLookupCache 
         {
             Range range;
@@ -1541,6 +1651,9 @@ namespace Kernel
 
         RegionLookupCache m_region_lookup_cache;
 
+        /// @brief bumped whenever a region leaves m_regions, which invalidates every thread's last_region_hit
+        u32 m_region_tree_generation { 0 };
+
         ProcessID m_ppid { 0 };
         mode_t m_umask { 022 };
 
@@ -1566,9 +1679,21 @@ namespace Kernel
 
         Vector<UnveiledPath> m_unveiled_paths;
 
-        WaitQueue& futex_queue(Userspace<const i32*>);
+        /**
+         * @param user_address 
+         * @param create_if_not_found 
+         * @return RefPtr<FutexQueue> 
+         */
+        RefPtr<FutexQueue> find_futex_queue(FlatPtr user_address, bool create_if_not_found);
+
+        /**
+         * @param user_address 
+         * @param futex_queue 
+         */
+        void remove_futex_queue_if_empty(FlatPtr user_address, FutexQueue& futex_queue);
 
-        HashMap<u32, OwnPtr<WaitQueue>> m_futex_queues;
+        SpinLock<u8> m_futex_lock;
+        HashMap<FlatPtr, RefPtr<FutexQueue>> m_futex_queues;
 
         OwnPtr<PerformanceEventBuffer> m_perf_event_buffer;
 
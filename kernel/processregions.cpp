@@ -0,0 +1,223 @@
+/**
+ * @file processregions.cpp
+ * @author Krisna Pranav
+ * @brief process region tree
+ * @version 6.0
+ * @date 2023-09-15
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <kernel/process.h>
+#include <kernel/thread.h>
+#include <kernel/vm/memorymanager.h>
+#include <kernel/vm/region.h>
+
+namespace Kernel
+{
+
+    /**
+     * @brief the region's weak link is made here, outside m_lock, so the lookups that
+     *        leave weak hints behind never allocate on the page fault path
+     *
+     * @param region
+     * @return Region&
+     */
+    Region& Process::add_region(NonnullOwnPtr<Region> region)
+    {
+        (void)region->make_weak_ptr();
+
+        FlatPtr base = region->vaddr().get();
+        ScopedSpinLock lock(m_lock);
+        return *m_regions.insert(base, move(region));
+    }
+
+    /**
+     * @param region
+     * @return NonnullOwnPtr<Region>
+     */
+    NonnullOwnPtr<Region> Process::take_region(Region& region)
+    {
+        ScopedSpinLock lock(m_lock);
+        if (m_region_lookup_cache.region.unsafe_ptr() == &region)
+            m_region_lookup_cache.region = nullptr;
+
+        auto* entry = m_regions.find(region.vaddr().get());
+        ASSERT(entry && entry->ptr() == &region);
+        m_region_tree_generation++;
+        return m_regions.take(region.vaddr().get());
+    }
+
+    /**
+     * @param region
+     * @return true
+     * @return false
+     */
+    bool Process::deallocate_region(Region& region)
+    {
+        OwnPtr<Region> region_protector;
+        ScopedSpinLock lock(m_lock);
+
+        if (m_region_lookup_cache.region.unsafe_ptr() == &region)
+            m_region_lookup_cache.region = nullptr;
+
+        auto* entry = m_regions.find(region.vaddr().get());
+        if (!entry || entry->ptr() != &region)
+            return false;
+
+        m_region_tree_generation++;
+        region_protector = m_regions.take(region.vaddr().get());
+        return true;
+    }
+
+    /**
+     * @param range
+     * @return Region*
+     */
+    Region* Process::find_region_from_range(const Range& range)
+    {
+        ScopedSpinLock lock(m_lock);
+        if (m_region_lookup_cache.range == range && m_region_lookup_cache.region)
+            return m_region_lookup_cache.region.unsafe_ptr();
+
+        auto* entry = m_regions.find(range.base().get());
+        if (!entry)
+            return nullptr;
+
+        auto& region = **entry;
+        if (region.size() != PAGE_ROUND_UP(range.size()))
+            return nullptr;
+
+        m_region_lookup_cache.range = range;
+        m_region_lookup_cache.region = region.make_weak_ptr();
+        return &region;
+    }
+
+    /**
+     * @param range
+     * @return Region*
+     */
+    Region* Process::find_region_containing(const Range& range)
+    {
+        ScopedSpinLock lock(m_lock);
+        auto* entry = m_regions.find_largest_not_above(range.base().get());
+        if (!entry || !(*entry)->contains(range))
+            return nullptr;
+        return entry->ptr();
+    }
+
+    /**
+     * @param vaddr
+     * @return Region*
+     */
+    Region* Process::find_region_from_vaddr(VirtualAddress vaddr)
+    {
+        ScopedSpinLock lock(m_lock);
+
+        auto* current_thread = Thread::current();
+        bool is_own_thread = current_thread && &current_thread->process() == this;
+        if (is_own_thread) {
+            auto& hint = current_thread->last_region_hit();
+            auto* region = hint.region.unsafe_ptr();
+            if (region && hint.generation == m_region_tree_generation && region->contains(vaddr))
+                return region;
+        }
+
+        auto* entry = m_regions.find_largest_not_above(vaddr.get());
+        if (!entry || !(*entry)->contains(vaddr))
+            return nullptr;
+
+        if (is_own_thread)
+            current_thread->last_region_hit() = { (*entry)->make_weak_ptr(), m_region_tree_generation };
+        return entry->ptr();
+    }
+
+    /**
+     * @param region
+     * @return Region*
+     */
+    Region* Process::previous_region(const Region& region)
+    {
+        ScopedSpinLock lock(m_lock);
+        auto* node = m_regions.find_node(region.vaddr().get());
+        ASSERT(node);
+        auto* previous = RegionTree::predecessor(node);
+        return previous ? previous->value.ptr() : nullptr;
+    }
+
+    /**
+     * @param region
+     * @return Region*
+     */
+    Region* Process::next_region(const Region& region)
+    {
+        ScopedSpinLock lock(m_lock);
+        auto* node = m_regions.find_node(region.vaddr().get());
+        ASSERT(node);
+        auto* next = RegionTree::successor(node);
+        return next ? next->value.ptr() : nullptr;
+    }
+
+    /**
+     * @param source_region
+     * @param range
+     * @param offset_in_vmobject
+     * @return Region&
+     */
+    Region& Process::allocate_split_region(const Region& source_region, const Range& range, size_t offset_in_vmobject)
+    {
+        auto& region = add_region(Region::create_user_accessible(range, const_cast<VMObject&>(source_region.vmobject()), offset_in_vmobject, source_region.name(), source_region.access(), source_region.is_cacheable()));
+        region.set_shared(source_region.is_shared());
+        region.set_mmap(source_region.is_mmap());
+        region.set_stack(source_region.is_stack());
+
+        size_t page_offset_in_source_region = (offset_in_vmobject - source_region.offset_in_vmobject()) / PAGE_SIZE;
+        for (size_t i = 0; i < region.page_count(); ++i) {
+            if (source_region.should_cow(page_offset_in_source_region + i))
+                region.set_should_cow(i, true);
+        }
+        return region;
+    }
+
+    /**
+     * @param source_region
+     * @param desired_range
+     * @return Vector<Region*, 2>
+     */
+    Vector<Region*, 2> Process::split_region_around_range(const Region& source_region, const Range& desired_range)
+    {
+        Range old_region_range = source_region.range();
+        auto remaining_ranges_after_unmap = old_region_range.carve(desired_range);
+        ASSERT(!remaining_ranges_after_unmap.is_empty());
+
+        Vector<Region*, 2> new_regions;
+        for (auto& new_range : remaining_ranges_after_unmap) {
+            ASSERT(old_region_range.contains(new_range));
+            size_t new_range_offset_in_vmobject = source_region.offset_in_vmobject() + (new_range.base().get() - old_region_range.base().get());
+            new_regions.unchecked_append(&allocate_split_region(source_region, new_range, new_range_offset_in_vmobject));
+        }
+        return new_regions;
+    }
+
+    /**
+     * @param process
+     * @param vaddr
+     * @return Region*
+     */
+    Region* MemoryManager::find_region_from_vaddr(Process& process, VirtualAddress vaddr)
+    {
+        return process.find_region_from_vaddr(vaddr);
+    }
+
+    /**
+     * @param process
+     * @param vaddr
+     * @return const Region*
+     */
+    const Region* MemoryManager::find_region_from_vaddr(const Process& process, VirtualAddress vaddr)
+    {
+        return const_cast<Process&>(process).find_region_from_vaddr(vaddr);
+    }
+
+} // namespace Kernel
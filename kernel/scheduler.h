@@ -11,6 +11,7 @@
 
 #pragma once 
 
+#include <kernel/performance_sampler.h>
 #include <kernel/spinlock.h>
 #include <kernel/unixtypes.h>
 #include <kernel/time/timemanagement.h>
@@ -51,7 +52,25 @@ namespace Kernel
          */
         static void set_idle_thread(Thread* idle_thread);
 
-        static void timer_tick(const RegisterState&);
+        /**
+         * @brief the per-cpu scheduler tick. The sampler is only ever called from here, so each
+         *        cpu takes at most one sample per tick no matter how many other timers fire
+         * 
+         * @param regs 
+         */
+        static void timer_tick(const RegisterState& regs)
+        {
+            account_tick(regs);
+            PerformanceSampler::timer_tick(regs);
+        }
+
+        /**
+         * @brief charges the tick to the current thread and expires its time slice
+         * 
+         * @param regs 
+         */
+        static void account_tick(const RegisterState& regs);
+
         [[noreturn]] static void start();
         static bool pick_next();
         static bool yield();
@@ -0,0 +1,130 @@
+/**
+ * @file epoll.cpp
+ * @author Krisna Pranav
+ * @brief epoll
+ * @version 6.0
+ * @date 2023-09-22
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <kernel/filesystem/eventpoll.h>
+#include <kernel/filesystem/filedescription.h>
+#include <kernel/process.h>
+
+namespace Kernel
+{
+
+    /// @brief events handed back by a single epoll_wait, the rest wait for the next call
+    static constexpr int max_events_per_wait = 1024;
+
+    /**
+     * @param flags
+     * @return int
+     */
+    int Process::sys$epoll_create(int flags)
+    {
+        REQUIRE_PROMISE(stdio);
+
+        if (flags & ~EPOLL_CLOEXEC)
+            return -EINVAL;
+
+        int fd = alloc_fd();
+        if (fd < 0)
+            return fd;
+
+        auto description = FileDescription::create(EventPoll::create());
+        description->set_readable(true);
+        m_fds[fd].set(move(description), (flags & EPOLL_CLOEXEC) ? FD_CLOEXEC : 0);
+        return fd;
+    }
+
+    /**
+     * @param user_params
+     * @return int
+     */
+    int Process::sys$epoll_ctl(Userspace<const Syscall::SC_epoll_ctl_params*> user_params)
+    {
+        REQUIRE_PROMISE(stdio);
+
+        Syscall::SC_epoll_ctl_params params;
+        if (!copy_from_user(&params, user_params))
+            return -EFAULT;
+
+        auto poll_description = file_description(params.epfd);
+        if (!poll_description)
+            return -EBADF;
+
+        if (!poll_description->file().is_event_poll())
+            return -EINVAL;
+
+        auto& poll = static_cast<EventPoll&>(poll_description->file());
+
+        epoll_event event {};
+        if (params.op != EPOLL_CTL_DEL && !copy_from_user(&event, params.event))
+            return -EFAULT;
+
+        switch (params.op) {
+        case EPOLL_CTL_ADD: {
+            auto description = file_description(params.fd);
+            if (!description)
+                return -EBADF;
+            return poll.add(params.fd, *description, event);
+        }
+        case EPOLL_CTL_MOD:
+            return poll.modify(params.fd, event);
+        case EPOLL_CTL_DEL:
+            return poll.remove(params.fd);
+        default:
+            return -EINVAL;
+        }
+    }
+
+    /**
+     * @param user_params
+     * @return int
+     */
+    int Process::sys$epoll_wait(Userspace<const Syscall::SC_epoll_wait_params*> user_params)
+    {
+        REQUIRE_PROMISE(stdio);
+
+        Syscall::SC_epoll_wait_params params;
+        if (!copy_from_user(&params, user_params))
+            return -EFAULT;
+
+        if (params.max_events <= 0)
+            return -EINVAL;
+
+        Thread::BlockTimeout timeout;
+        timespec timeout_ts { 0, 0 };
+        if (params.timeout) {
+            if (!copy_from_user(&timeout_ts, params.timeout))
+                return -EFAULT;
+            timeout = Thread::BlockTimeout(false, &timeout_ts);
+        }
+
+        auto poll_description = file_description(params.epfd);
+        if (!poll_description)
+            return -EBADF;
+
+        if (!poll_description->file().is_event_poll())
+            return -EINVAL;
+
+        auto& poll = static_cast<EventPoll&>(poll_description->file());
+
+        size_t max_events = min(params.max_events, max_events_per_wait);
+        Vector<epoll_event> events;
+        events.ensure_capacity(max_events);
+
+        auto result = poll.wait(events, max_events, timeout);
+        if (result.is_error())
+            return result;
+
+        if (!copy_n_to_user(params.events, events.data(), events.size()))
+            return -EFAULT;
+
+        return events.size();
+    }
+
+} // namespace Kernel
@@ -81,13 +81,13 @@ namespace Kernel
 
             for (auto& region : m_regions) {
     #ifdef FORK_DEBUG
-                dbg() << "fork: cloning Region{" << &region << "} '" << region.name() << "' @ " << region.vaddr();
+                dbg() << "fork: cloning Region{" << region.ptr() << "} '" << region->name() << "' @ " << region->vaddr();
     #endif
-                auto& child_region = child->add_region(region.clone());
+                auto& child_region = child->add_region(region->clone());
 
                 child_region.map(child->page_directory());
 
-                if (&region == m_master_tls_region.unsafe_ptr())
+                if (region.ptr() == m_master_tls_region.unsafe_ptr())
                     child->m_master_tls_region = child_region;
             }
 
@@ -4,34 +4,66 @@
  * @brief futex
  * @version 6.0
  * @date 2023-08-26
- * 
+ *
  * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
- * 
+ *
  */
 
 #include <mods/time.h>
+#include <kernel/futexqueue.h>
 #include <kernel/process.h>
 
-namespace Kernel 
+namespace Kernel
 {
 
     /**
-     * @param userspace_address 
-     * @return WaitQueue& 
+     * @brief a found or created queue carries one imminent wait for the caller, which
+     *        has to be consumed by blocking on it or given back with cancel_imminent_wait
+     *
+     * @param user_address
+     * @param create_if_not_found
+     * @return RefPtr<FutexQueue>
      */
-    WaitQueue& Process::futex_queue(Userspace<const i32*> userspace_address)
+    RefPtr<FutexQueue> Process::find_futex_queue(FlatPtr user_address, bool create_if_not_found)
     {
-        auto& queue = m_futex_queues.ensure(userspace_address.ptr());
+        ScopedSpinLock lock(m_futex_lock);
 
-        if (!queue)
-            queue = make<WaitQueue>();
+        auto it = m_futex_queues.find(user_address);
+        if (it != m_futex_queues.end()) {
+            if (create_if_not_found)
+                it->value->queue_imminent_wait();
+            return it->value;
+        }
+
+        if (!create_if_not_found)
+            return {};
+
+        auto futex_queue = adopt(*new FutexQueue(user_address));
+        m_futex_queues.set(user_address, futex_queue);
+        return futex_queue;
+    }
+
+    /**
+     * @param user_address
+     * @param futex_queue
+     */
+    void Process::remove_futex_queue_if_empty(FlatPtr user_address, FutexQueue& futex_queue)
+    {
+        ScopedSpinLock lock(m_futex_lock);
 
-        return *queue;
+        auto it = m_futex_queues.find(user_address);
+        if (it == m_futex_queues.end() || it->value.ptr() != &futex_queue)
+            return;
+
+        if (futex_queue.is_empty_and_no_imminent_waits())
+            m_futex_queues.remove(it);
     }
 
     /**
-     * @brief futex sys process
-     * 
+     * @brief futex sys process. Futex words are only ever shared between the threads of one
+     *        process, so every futex is keyed by its user address and FUTEX_PRIVATE_FLAG is
+     *        accepted as a no-op.
+     *
      */
     int Process::sys$futex(Userspace<const Syscall::SC_futex_params*> user_params)
     {
@@ -42,17 +74,13 @@ namespace Kernel
         if (!copy_from_user(&params, user_params))
             return -EFAULT;
 
-        switch (params.futex_op) {
+        FlatPtr user_address = (FlatPtr)params.userspace_address;
+        if (user_address & 3)
+            return -EINVAL;
 
-        case FUTEX_WAIT: {
-            i32 user_value;
-
-            if (!copy_from_user(&user_value, params.userspace_address))
-                return -EFAULT;
-
-            if (user_value != params.val)
-                return -EAGAIN;
+        int cmd = params.futex_op & FUTEX_CMD_MASK;
 
+        auto do_wait = [&](u32 bitset) -> int {
             Thread::BlockTimeout timeout;
 
             if (params.timeout) {
@@ -64,29 +92,102 @@ namespace Kernel
                 timeout = Thread::BlockTimeout(true, &ts_abstimeout);
             }
 
-            WaitQueue& wait_queue = futex_queue((FlatPtr)params.userspace_address);
+            auto futex_queue = find_futex_queue(user_address, true);
+            ASSERT(futex_queue);
+
+            i32 user_value;
+            if (!copy_from_user(&user_value, params.userspace_address)) {
+                futex_queue->cancel_imminent_wait();
+                remove_futex_queue_if_empty(user_address, *futex_queue);
+                return -EFAULT;
+            }
+
+            if (user_value != params.val) {
+                futex_queue->cancel_imminent_wait();
+                remove_futex_queue_if_empty(user_address, *futex_queue);
+                return -EAGAIN;
+            }
 
-            Thread::BlockResult result = wait_queue.wait_on(timeout, "Futex");
+            RefPtr<FutexQueue> requeued_to;
+            Thread::BlockResult result = futex_queue->wait_on(timeout, bitset, requeued_to);
+            remove_futex_queue_if_empty(user_address, *futex_queue);
+            if (requeued_to)
+                remove_futex_queue_if_empty(requeued_to->user_address(), *requeued_to);
 
-            if (result == Thread::BlockResult::InterruptedByTimeout) {
+            if (result == Thread::BlockResult::InterruptedByTimeout)
                 return -ETIMEDOUT;
+
+            return 0;
+        };
+
+        auto do_wake = [&](u32 bitset) -> int {
+            if (params.val <= 0)
+                return 0;
+
+            auto futex_queue = find_futex_queue(user_address, false);
+            if (!futex_queue)
+                return 0;
+
+            u32 woken = futex_queue->wake_n(params.val, bitset);
+            remove_futex_queue_if_empty(user_address, *futex_queue);
+            return woken;
+        };
+
+        auto do_requeue = [&](Optional<i32> expected_value) -> int {
+            FlatPtr user_address2 = (FlatPtr)params.userspace_address2;
+            if (user_address2 & 3)
+                return -EINVAL;
+
+            if (params.val < 0 || (i32)params.val2 < 0)
+                return -EINVAL;
+
+            if (expected_value.has_value()) {
+                i32 user_value;
+                if (!copy_from_user(&user_value, params.userspace_address))
+                    return -EFAULT;
+                if (user_value != expected_value.value())
+                    return -EAGAIN;
             }
 
-            break;
-        }
-        case FUTEX_WAKE:
-            if (params.val == 0)
+            auto futex_queue = find_futex_queue(user_address, false);
+            if (!futex_queue)
                 return 0;
-                
-            if (params.val == 1) {
-                futex_queue((FlatPtr)params.userspace_address).wake_one();
-            } else {
-                futex_queue((FlatPtr)params.userspace_address).wake_n(params.val);
+
+            if (user_address2 == user_address || params.val2 == 0) {
+                u32 woken = futex_queue->wake_n(params.val, FUTEX_BITSET_MATCH_ANY);
+                remove_futex_queue_if_empty(user_address, *futex_queue);
+                return woken;
             }
-            break;
+
+            auto target_queue = find_futex_queue(user_address2, true);
+            u32 count = futex_queue->wake_n_requeue(params.val, *target_queue, params.val2);
+
+            target_queue->cancel_imminent_wait();
+            remove_futex_queue_if_empty(user_address2, *target_queue);
+            remove_futex_queue_if_empty(user_address, *futex_queue);
+            return count;
+        };
+
+        switch (cmd) {
+        case FUTEX_WAIT:
+            return do_wait(FUTEX_BITSET_MATCH_ANY);
+        case FUTEX_WAKE:
+            return do_wake(FUTEX_BITSET_MATCH_ANY);
+        case FUTEX_WAIT_BITSET:
+            if (params.val3 == 0)
+                return -EINVAL;
+            return do_wait((u32)params.val3);
+        case FUTEX_WAKE_BITSET:
+            if (params.val3 == 0)
+                return -EINVAL;
+            return do_wake((u32)params.val3);
+        case FUTEX_REQUEUE:
+            return do_requeue({});
+        case FUTEX_CMP_REQUEUE:
+            return do_requeue(params.val3);
         }
 
-        return 0;
+        return -ENOSYS;
     }
 
 } // namespace Kernel
@@ -0,0 +1,107 @@
+/**
+ * @file pread.cpp
+ * @author Krisna Pranav
+ * @brief pread
+ * @version 6.0
+ * @date 2023-09-21
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <kernel/filesystem/filedescription.h>
+#include <kernel/process.h>
+
+namespace Kernel
+{
+
+    /**
+     * @param description
+     * @param vecs
+     * @param offset
+     * @return ssize_t
+     */
+    ssize_t Process::do_preadv(FileDescription& description, const Vector<iovec, 32>& vecs, u64 offset)
+    {
+        if (!description.is_readable())
+            return -EBADF;
+
+        if (description.is_directory())
+            return -EISDIR;
+
+        ssize_t nread = 0;
+        for (auto& vec : vecs) {
+            if (vec.iov_len == 0)
+                continue;
+
+            auto buffer = UserOrKernelBuffer::for_user_buffer((u8*)vec.iov_base, vec.iov_len);
+            if (!buffer.has_value())
+                return nread ? nread : -EFAULT;
+
+            auto nread_or_error = description.read(buffer.value(), offset + nread, vec.iov_len);
+            if (nread_or_error.is_error())
+                return nread ? nread : nread_or_error.error();
+
+            nread += nread_or_error.value();
+            if (nread_or_error.value() < vec.iov_len)
+                break;
+        }
+
+        return nread;
+    }
+
+    /**
+     * @param user_params
+     * @return ssize_t
+     */
+    ssize_t Process::sys$pread(Userspace<const Syscall::SC_pread_params*> user_params)
+    {
+        REQUIRE_PROMISE(stdio);
+
+        Syscall::SC_pread_params params;
+        if (!copy_from_user(&params, user_params))
+            return -EFAULT;
+
+        if (params.offset < 0)
+            return -EINVAL;
+
+        if ((ssize_t)params.buffer.size < 0)
+            return -EINVAL;
+
+        auto description = file_description(params.fd);
+        if (!description)
+            return -EBADF;
+
+        Vector<iovec, 32> vecs;
+        vecs.append({ params.buffer.data, params.buffer.size });
+        return do_preadv(*description, vecs, params.offset);
+    }
+
+    /**
+     * @param user_params
+     * @return ssize_t
+     */
+    ssize_t Process::sys$preadv(Userspace<const Syscall::SC_preadv_params*> user_params)
+    {
+        REQUIRE_PROMISE(stdio);
+
+        Syscall::SC_preadv_params params;
+        if (!copy_from_user(&params, user_params))
+            return -EFAULT;
+
+        if (params.offset < 0)
+            return -EINVAL;
+
+        Vector<iovec, 32> vecs;
+        auto result = copy_iovecs_from_user(vecs, params.iov, params.iov_count);
+        if (result.is_error())
+            return result;
+
+        auto description = file_description(params.fd);
+        if (!description)
+            return -EBADF;
+
+        return do_preadv(*description, vecs, params.offset);
+    }
+
+} // namespace Kernel
@@ -0,0 +1,166 @@
+/**
+ * @file profiling.cpp
+ * @author Krisna Pranav
+ * @brief profiling
+ * @version 6.0
+ * @date 2023-09-10
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <kernel/kbufferbuilder.h>
+#include <kernel/performance_event_buffer.h>
+#include <kernel/performance_sampler.h>
+#include <kernel/process.h>
+
+namespace Kernel
+{
+
+    /**
+     * @brief pid -1 samples every thread in the system into the global buffer
+     *
+     * @param pid
+     * @return int
+     */
+    int Process::sys$profiling_enable(pid_t pid)
+    {
+        REQUIRE_NO_PROMISES;
+
+        if (pid == -1) {
+            if (!is_superuser())
+                return -EPERM;
+            return PerformanceSampler::enable_system_wide();
+        }
+
+        RefPtr<Process> process;
+        {
+            ScopedSpinLock lock(g_processes_lock);
+            process = Process::from_pid(pid);
+        }
+
+        if (!process)
+            return -ESRCH;
+
+        if (!is_superuser() && process->uid() != euid())
+            return -EPERM;
+
+        // the rings are several MiB, allocate them before taking the lock
+        OwnPtr<PerformanceEventBuffer> buffer;
+        if (!process->perf_events())
+            buffer = make<PerformanceEventBuffer>();
+
+        ScopedSpinLock lock(g_processes_lock);
+        if (process->is_dead())
+            return -ESRCH;
+
+        if (!process->m_perf_event_buffer)
+            process->m_perf_event_buffer = move(buffer);
+
+        process->set_profiling(true);
+        return 0;
+    }
+
+    /**
+     * @param pid
+     * @return int
+     */
+    int Process::sys$profiling_disable(pid_t pid)
+    {
+        REQUIRE_NO_PROMISES;
+
+        if (pid == -1) {
+            if (!is_superuser())
+                return -EPERM;
+            PerformanceSampler::disable_system_wide();
+            return 0;
+        }
+
+        ScopedSpinLock lock(g_processes_lock);
+        auto process = Process::from_pid(pid);
+
+        if (!process)
+            return -ESRCH;
+
+        if (!is_superuser() && process->uid() != euid())
+            return -EPERM;
+
+        if (!process->is_profiling())
+            return -EINVAL;
+
+        process->set_profiling(false);
+        return 0;
+    }
+
+    /**
+     * @param frequency
+     * @return int
+     */
+    int Process::sys$profiling_set_frequency(u32 frequency)
+    {
+        REQUIRE_NO_PROMISES;
+
+        if (!is_superuser())
+            return -EPERM;
+
+        return PerformanceSampler::set_frequency(frequency);
+    }
+
+    /**
+     * @brief consumes events from pid's buffer, or from the system wide buffer for pid -1.
+     *        Every read is self-contained: the binary header, then as many whole events as
+     *        fit into size
+     *
+     * @param pid
+     * @param buffer
+     * @param size
+     * @return ssize_t
+     */
+    ssize_t Process::sys$profiling_read(pid_t pid, Userspace<u8*> buffer, size_t size)
+    {
+        REQUIRE_NO_PROMISES;
+
+        RefPtr<Process> process;
+        PerformanceEventBuffer* events = nullptr;
+        String executable_path;
+
+        if (pid == -1) {
+            if (!is_superuser())
+                return -EPERM;
+            events = PerformanceSampler::global_events();
+        } else {
+            {
+                ScopedSpinLock lock(g_processes_lock);
+                process = Process::from_pid(pid);
+            }
+
+            if (!process)
+                return -ESRCH;
+
+            if (!is_superuser() && process->uid() != euid())
+                return -EPERM;
+
+            events = process->perf_events();
+            if (auto* executable = process->executable())
+                executable_path = executable->absolute_path();
+        }
+
+        if (!events)
+            return -EINVAL;
+
+        size_t header_size = sizeof(PerformanceEventBinaryHeader) + executable_path.length();
+        if (size < header_size + sizeof(PerformanceEvent))
+            return -EINVAL;
+
+        KBufferBuilder builder;
+        PerformanceEventBuffer::append_binary_header(builder, pid, executable_path);
+        events->drain_binary(builder, (size - header_size) / sizeof(PerformanceEvent));
+
+        auto data = builder.build();
+        if (!copy_to_user(buffer, data.data(), data.size()))
+            return -EFAULT;
+
+        return data.size();
+    }
+
+} // namespace Kernel
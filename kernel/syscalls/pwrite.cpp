@@ -0,0 +1,104 @@
+/**
+ * @file pwrite.cpp
+ * @author Krisna Pranav
+ * @brief pwrite
+ * @version 6.0
+ * @date 2023-09-21
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <kernel/filesystem/filedescription.h>
+#include <kernel/process.h>
+
+namespace Kernel
+{
+
+    /**
+     * @param description
+     * @param vecs
+     * @param offset
+     * @return ssize_t
+     */
+    ssize_t Process::do_pwritev(FileDescription& description, const Vector<iovec, 32>& vecs, u64 offset)
+    {
+        if (!description.is_writable())
+            return -EBADF;
+
+        ssize_t nwritten = 0;
+        for (auto& vec : vecs) {
+            if (vec.iov_len == 0)
+                continue;
+
+            auto buffer = UserOrKernelBuffer::for_user_buffer((u8*)vec.iov_base, vec.iov_len);
+            if (!buffer.has_value())
+                return nwritten ? nwritten : -EFAULT;
+
+            auto nwritten_or_error = description.write(buffer.value(), offset + nwritten, vec.iov_len);
+            if (nwritten_or_error.is_error())
+                return nwritten ? nwritten : nwritten_or_error.error();
+
+            nwritten += nwritten_or_error.value();
+            if (nwritten_or_error.value() < vec.iov_len)
+                break;
+        }
+
+        return nwritten;
+    }
+
+    /**
+     * @param user_params
+     * @return ssize_t
+     */
+    ssize_t Process::sys$pwrite(Userspace<const Syscall::SC_pwrite_params*> user_params)
+    {
+        REQUIRE_PROMISE(stdio);
+
+        Syscall::SC_pwrite_params params;
+        if (!copy_from_user(&params, user_params))
+            return -EFAULT;
+
+        if (params.offset < 0)
+            return -EINVAL;
+
+        if ((ssize_t)params.buffer.size < 0)
+            return -EINVAL;
+
+        auto description = file_description(params.fd);
+        if (!description)
+            return -EBADF;
+
+        Vector<iovec, 32> vecs;
+        vecs.append({ const_cast<u8*>(params.buffer.data), params.buffer.size });
+        return do_pwritev(*description, vecs, params.offset);
+    }
+
+    /**
+     * @param user_params
+     * @return ssize_t
+     */
+    ssize_t Process::sys$pwritev(Userspace<const Syscall::SC_preadv_params*> user_params)
+    {
+        REQUIRE_PROMISE(stdio);
+
+        Syscall::SC_preadv_params params;
+        if (!copy_from_user(&params, user_params))
+            return -EFAULT;
+
+        if (params.offset < 0)
+            return -EINVAL;
+
+        Vector<iovec, 32> vecs;
+        auto result = copy_iovecs_from_user(vecs, params.iov, params.iov_count);
+        if (result.is_error())
+            return result;
+
+        auto description = file_description(params.fd);
+        if (!description)
+            return -EBADF;
+
+        return do_pwritev(*description, vecs, params.offset);
+    }
+
+} // namespace Kernel
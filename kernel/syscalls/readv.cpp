@@ -0,0 +1,108 @@
+/**
+ * @file readv.cpp
+ * @author Krisna Pranav
+ * @brief readv
+ * @version 6.0
+ * @date 2023-09-21
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <mods/check.h>
+#include <mods/numericlimits.h>
+#include <kernel/filesystem/filedescription.h>
+#include <kernel/process.h>
+
+namespace Kernel
+{
+
+    /**
+     * @brief iov_count is checked before the vector is sized, so userspace cannot make
+     *        the kernel allocate more than IOV_MAX entries
+     *
+     * @param vecs
+     * @param iov
+     * @param iov_count
+     * @return KResult
+     */
+    KResult Process::copy_iovecs_from_user(Vector<iovec, 32>& vecs, Userspace<const struct iovec*> iov, int iov_count)
+    {
+        if (iov_count < 0 || iov_count > IOV_MAX)
+            return KResult(-EINVAL);
+
+        Checked<size_t> size = sizeof(iovec);
+        size *= iov_count;
+        if (size.has_overflow())
+            return KResult(-EFAULT);
+
+        vecs.resize(iov_count);
+        if (!copy_n_from_user(vecs.data(), iov, iov_count))
+            return KResult(-EFAULT);
+
+        u64 total_length = 0;
+        for (auto& vec : vecs) {
+            total_length += vec.iov_len;
+            if (total_length > NumericLimits<i32>::max())
+                return KResult(-EINVAL);
+        }
+
+        return KSuccess;
+    }
+
+    /**
+     * @param fd
+     * @param iov
+     * @param iov_count
+     * @return ssize_t
+     */
+    ssize_t Process::sys$readv(int fd, Userspace<const struct iovec*> iov, int iov_count)
+    {
+        REQUIRE_PROMISE(stdio);
+
+        Vector<iovec, 32> vecs;
+        auto result = copy_iovecs_from_user(vecs, iov, iov_count);
+        if (result.is_error())
+            return result;
+
+        auto description = file_description(fd);
+        if (!description)
+            return -EBADF;
+
+        if (!description->is_readable())
+            return -EBADF;
+
+        if (description->is_directory())
+            return -EISDIR;
+
+        // like read(), only wait for the first byte, a segment that comes back short ends the call
+        if (description->is_blocking() && !description->can_read()) {
+            auto unblock_flags = Thread::FileBlocker::BlockFlags::None;
+            if (Thread::current()->block<Thread::ReadBlocker>({}, *description, unblock_flags).was_interrupted())
+                return -EINTR;
+            if (!((u32)unblock_flags & (u32)Thread::FileBlocker::BlockFlags::Read))
+                return -EAGAIN;
+        }
+
+        ssize_t nread = 0;
+        for (auto& vec : vecs) {
+            if (vec.iov_len == 0)
+                continue;
+
+            auto buffer = UserOrKernelBuffer::for_user_buffer((u8*)vec.iov_base, vec.iov_len);
+            if (!buffer.has_value())
+                return nread ? nread : -EFAULT;
+
+            auto nread_or_error = description->read(buffer.value(), vec.iov_len);
+            if (nread_or_error.is_error())
+                return nread ? nread : nread_or_error.error();
+
+            nread += nread_or_error.value();
+            if (nread_or_error.value() < vec.iov_len)
+                break;
+        }
+
+        return nread;
+    }
+
+} // namespace Kernel
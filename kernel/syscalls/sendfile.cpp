@@ -0,0 +1,286 @@
+/**
+ * @file sendfile.cpp
+ * @author Krisna Pranav
+ * @brief sendfile, splice
+ * @version 6.0
+ * @date 2023-09-23
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <mods/numericlimits.h>
+#include <kernel/filesystem/fifo.h>
+#include <kernel/filesystem/filedescription.h>
+#include <kernel/kbuffer.h>
+#include <kernel/process.h>
+
+namespace Kernel
+{
+
+    /// @brief most bytes staged at once for destinations that can't be filled in place
+    static constexpr size_t transfer_chunk_size = 64 * KiB;
+
+    /**
+     * @param description
+     * @return KResult
+     */
+    static KResult wait_until_writable(FileDescription& description)
+    {
+        if (description.can_write())
+            return KSuccess;
+
+        if (!description.is_blocking())
+            return KResult(-EAGAIN);
+
+        auto unblock_flags = Thread::FileBlocker::BlockFlags::None;
+        if (Thread::current()->block<Thread::WriteBlocker>({}, description, unblock_flags).was_interrupted())
+            return KResult(-EINTR);
+
+        if (!((u32)unblock_flags & (u32)Thread::FileBlocker::BlockFlags::Write))
+            return KResult(-EAGAIN);
+
+        return KSuccess;
+    }
+
+    /**
+     * @brief the source is always read at an explicit position, so bytes the destination
+     *        didn't take are simply read again next time. A FIFO destination is filled in
+     *        place from the source, everything else goes through one kernel staging buffer
+     *
+     * @param in
+     * @param in_offset
+     * @param out
+     * @param out_offset
+     * @param count
+     * @return ssize_t
+     */
+    ssize_t Process::do_transfer(FileDescription& in, Optional<u64>& in_offset, FileDescription& out, Optional<u64>& out_offset, size_t count)
+    {
+        if (!in.is_readable() || !out.is_writable())
+            return -EBADF;
+
+        if (in.is_directory() || out.is_directory())
+            return -EISDIR;
+
+        if (!in.file().is_seekable())
+            return -ESPIPE;
+
+        if (out_offset.has_value() && !out.file().is_seekable())
+            return -ESPIPE;
+
+        if (&in.file() == &out.file())
+            return -EINVAL;
+
+        if (count > (size_t)NumericLimits<ssize_t>::max())
+            count = NumericLimits<ssize_t>::max();
+
+        u64 position = in_offset.has_value() ? in_offset.value() : (u64)in.offset();
+
+        Optional<KBuffer> staging;
+        size_t total = 0;
+        KResult error = KSuccess;
+
+        while (total < count) {
+            size_t chunk = min(count - total, transfer_chunk_size);
+            size_t nmoved = 0;
+            bool source_exhausted = false;
+
+            if (out.is_fifo()) {
+                auto result = wait_until_writable(out);
+                if (result.is_error()) {
+                    error = result;
+                    break;
+                }
+
+                auto nwritten_or_error = out.fifo()->write_from(chunk, [&](UserOrKernelBuffer& buffer, size_t size) -> ssize_t {
+                    auto nread_or_error = in.read(buffer, position, size);
+                    if (nread_or_error.is_error())
+                        return nread_or_error.error();
+                    if (nread_or_error.value() < size)
+                        source_exhausted = true;
+                    return nread_or_error.value();
+                });
+                if (nwritten_or_error.is_error()) {
+                    error = nwritten_or_error.error();
+                    break;
+                }
+                nmoved = nwritten_or_error.value();
+                if (!nmoved && !source_exhausted)
+                    continue;
+            } else {
+                if (!staging.has_value())
+                    staging = KBuffer::create_with_size(min(count, transfer_chunk_size), Region::Access::Read | Region::Access::Write, "Transfer");
+
+                auto buffer = UserOrKernelBuffer::for_kernel_buffer(staging.value().data());
+                auto nread_or_error = in.read(buffer, position, chunk);
+                if (nread_or_error.is_error()) {
+                    error = nread_or_error.error();
+                    break;
+                }
+
+                size_t nread = nread_or_error.value();
+                if (nread < chunk)
+                    source_exhausted = true;
+                if (!nread)
+                    break;
+
+                if (out_offset.has_value()) {
+                    auto nwritten_or_error = out.write(buffer, out_offset.value(), nread);
+                    if (nwritten_or_error.is_error()) {
+                        error = nwritten_or_error.error();
+                        break;
+                    }
+                    nmoved = nwritten_or_error.value();
+                } else {
+                    ssize_t nwritten = do_write(out, buffer, nread);
+                    if (nwritten < 0) {
+                        error = KResult(nwritten);
+                        break;
+                    }
+                    nmoved = nwritten;
+                }
+
+                if (nmoved < nread)
+                    source_exhausted = true;
+            }
+
+            position += nmoved;
+            if (out_offset.has_value())
+                out_offset = out_offset.value() + nmoved;
+            total += nmoved;
+
+            if (source_exhausted || !nmoved)
+                break;
+        }
+
+        if (in_offset.has_value())
+            in_offset = position;
+        else
+            in.seek(position, SEEK_SET);
+
+        if (!total && error.is_error())
+            return error;
+        return total;
+    }
+
+    /**
+     * @param user_offset
+     * @param offset
+     * @return KResult
+     */
+    static KResult copy_offset_from_user(off_t* user_offset, Optional<u64>& offset)
+    {
+        if (!user_offset)
+            return KSuccess;
+
+        off_t value;
+        if (!copy_from_user(&value, user_offset))
+            return KResult(-EFAULT);
+
+        if (value < 0)
+            return KResult(-EINVAL);
+
+        offset = (u64)value;
+        return KSuccess;
+    }
+
+    /**
+     * @param user_offset
+     * @param offset
+     * @return KResult
+     */
+    static KResult copy_offset_to_user(off_t* user_offset, const Optional<u64>& offset)
+    {
+        if (!user_offset)
+            return KSuccess;
+
+        off_t value = offset.value();
+        if (!copy_to_user(user_offset, &value))
+            return KResult(-EFAULT);
+
+        return KSuccess;
+    }
+
+    /**
+     * @param user_params
+     * @return ssize_t
+     */
+    ssize_t Process::sys$sendfile(Userspace<const Syscall::SC_sendfile_params*> user_params)
+    {
+        REQUIRE_PROMISE(stdio);
+
+        Syscall::SC_sendfile_params params;
+        if (!copy_from_user(&params, user_params))
+            return -EFAULT;
+
+        auto in = file_description(params.in_fd);
+        auto out = file_description(params.out_fd);
+        if (!in || !out)
+            return -EBADF;
+
+        Optional<u64> in_offset;
+        auto result = copy_offset_from_user(params.offset, in_offset);
+        if (result.is_error())
+            return result;
+
+        Optional<u64> out_offset;
+        ssize_t nmoved = do_transfer(*in, in_offset, *out, out_offset, params.count);
+        if (nmoved < 0)
+            return nmoved;
+
+        result = copy_offset_to_user(params.offset, in_offset);
+        if (result.is_error())
+            return result;
+
+        return nmoved;
+    }
+
+    /**
+     * @brief like sendfile, but the destination can be written at an offset as well
+     *
+     * @param user_params
+     * @return ssize_t
+     */
+    ssize_t Process::sys$splice(Userspace<const Syscall::SC_splice_params*> user_params)
+    {
+        REQUIRE_PROMISE(stdio);
+
+        Syscall::SC_splice_params params;
+        if (!copy_from_user(&params, user_params))
+            return -EFAULT;
+
+        if (params.flags)
+            return -EINVAL;
+
+        auto in = file_description(params.fd_in);
+        auto out = file_description(params.fd_out);
+        if (!in || !out)
+            return -EBADF;
+
+        Optional<u64> in_offset;
+        auto result = copy_offset_from_user(params.off_in, in_offset);
+        if (result.is_error())
+            return result;
+
+        Optional<u64> out_offset;
+        result = copy_offset_from_user(params.off_out, out_offset);
+        if (result.is_error())
+            return result;
+
+        ssize_t nmoved = do_transfer(*in, in_offset, *out, out_offset, params.length);
+        if (nmoved < 0)
+            return nmoved;
+
+        result = copy_offset_to_user(params.off_in, in_offset);
+        if (result.is_error())
+            return result;
+
+        result = copy_offset_to_user(params.off_out, out_offset);
+        if (result.is_error())
+            return result;
+
+        return nmoved;
+    }
+
+} // namespace Kernel
@@ -10,9 +10,8 @@
  */
 
 #include <kernel/process.h>
-#include <kernel/filesystem/virtualfilesystem.h>
+#include <kernel/filesystem/writeback.h>
 #include <kernel/tasks/synctask.h>
-#include <kernel/time/timemanagement.h>
 
 namespace Kernel 
 {
@@ -22,12 +21,7 @@ namespace Kernel
         RefPtr<Thread> syncd_thread;
 
         Process::create_kernel_process(syncd_thread, "SyncTask", [] {
-            dbg() << "SyncTask is running";
-
-            for (;;) {
-                VFS::the().sync();
-                Thread::current()->sleep({ 1, 0 });
-            }
+            Writeback::the().run();
         });
     }
 
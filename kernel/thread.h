@@ -342,6 +342,7 @@ namespace Kernel
                 Plan9FS,
                 Join,
                 Queue,
+                Futex,
                 Routing,
                 Sleep,
                 Wait
@@ -508,6 +509,17 @@ namespace Kernel
              */
             bool set_block_condition(BlockCondition&, void* = nullptr);
 
+            /**
+             * @brief retarget a blocker that has been moved to another condition, m_lock must be held
+             * 
+             * @param block_condition 
+             */
+            void set_block_condition_raw_locked(BlockCondition* block_condition)
+            {
+                ASSERT(m_lock.own_lock());
+                m_block_condition = block_condition;
+            }
+
             mutable RecursiveSpinLock m_lock;
 
         private:
@@ -681,15 +693,60 @@ namespace Kernel
                 return true; 
             }
 
-            SpinLock<u8> m_lock;
-
-        private:
             struct BlockerInfo 
             {
                 Blocker* blocker;
                 void* data;
             };
-            Vector<BlockerInfo, 4> m_blockers;
+            using BlockerList = Vector<BlockerInfo, 4>;
+
+            /**
+             * @brief detach up to count blockers, oldest first, without waking them
+             * 
+             * @param count 
+             * @return BlockerList 
+             */
+            BlockerList do_take_blockers(size_t count)
+            {
+                ASSERT(m_lock.is_locked());
+                if (m_blockers.size() <= count)
+                    return move(m_blockers);
+
+                BlockerList taken;
+                BlockerList remaining;
+                for (size_t i = 0; i < m_blockers.size(); ++i)
+                    (i < count ? taken : remaining).append(m_blockers[i]);
+                m_blockers = move(remaining);
+                return taken;
+            }
+
+            /**
+             * @param blockers 
+             */
+            void do_append_blockers(BlockerList&& blockers)
+            {
+                ASSERT(m_lock.is_locked());
+                if (m_blockers.is_empty()) {
+                    m_blockers = move(blockers);
+                    return;
+                }
+                m_blockers.append(move(blockers));
+            }
+
+            /**
+             * @return true 
+             * @return false 
+             */
+            bool do_is_empty() const
+            {
+                ASSERT(m_lock.is_locked());
+                return m_blockers.is_empty();
+            }
+
+            SpinLock<u8> m_lock;
+
+        private:
+            BlockerList m_blockers;
         };
 
         friend class JoinBlocker;
@@ -789,6 +846,80 @@ namespace Kernel
             bool m_did_unblock { false };
         }; // class QueueBlocker
 
+        class FutexBlocker : public Blocker 
+        {
+        public:
+            /**
+             * @param bitset 
+             * @param requeued_to set to the last queue the waiter was requeued onto
+             */
+            FutexBlocker(FutexQueue&, u32 bitset, RefPtr<FutexQueue>& requeued_to);
+            virtual ~FutexBlocker();
+
+            /**
+             * @return Type 
+             */
+            virtual Type blocker_type() const override 
+            { 
+                return Type::Futex; 
+            }
+
+            /**
+             * @return const char* 
+             */
+            virtual const char* state_string() const override 
+            { 
+                return "Futex"; 
+            }
+
+            virtual void not_blocking(bool) override { }
+
+            virtual bool should_block() override
+            {
+                return m_should_block;
+            }
+
+            /**
+             * @return u32 
+             */
+            u32 bitset() const 
+            { 
+                return m_bitset; 
+            }
+
+            /// @brief hold m_lock while the blocker travels between two futex queues
+            void begin_requeue()
+            {
+                m_relock_flags = m_lock.lock();
+            }
+
+            /**
+             * @param futex_queue 
+             */
+            void finish_requeue(FutexQueue&);
+
+            /**
+             * @param bitset 
+             * @return true 
+             * @return false 
+             */
+            bool unblock_bitset(u32 bitset);
+
+            /**
+             * @param force 
+             * @return true 
+             * @return false 
+             */
+            bool unblock(bool force = false);
+
+        protected:
+            u32 m_bitset { 0 };
+            u32 m_relock_flags { 0 };
+            RefPtr<FutexQueue>& m_requeued_to;
+            bool m_should_block { true };
+            bool m_did_unblock { false };
+        }; // class FutexBlocker
+
         class FileBlocker : public Blocker 
         {
         public:
@@ -1271,6 +1402,24 @@ namespace Kernel
             return m_ticks; 
         }
 
+        struct RegionHint 
+        {
+            WeakPtr<Region> region;
+            u32 generation { 0 };
+        }; // struct RegionHint
+
+        /**
+         * @brief the region this thread last resolved a user address to, tried before the
+         *        process region tree. Only valid while generation matches the process's
+         *        region tree generation
+         * 
+         * @return RegionHint& 
+         */
+        RegionHint& last_region_hit() 
+        { 
+            return m_last_region_hit; 
+        }
+
         /**
          * @return VirtualAddress 
          */
@@ -1991,6 +2140,7 @@ namespace Kernel
 
         u32 m_cpu_affinity { THREAD_AFFINITY_DEFAULT };
         u32 m_ticks { 0 };
+        RegionHint m_last_region_hit;
         u32 m_ticks_left { 0 };
         u32 m_times_scheduled { 0 };
         u32 m_pending_signals { 0 };
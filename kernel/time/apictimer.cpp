@@ -14,6 +14,7 @@
 #include <kernel/io.h>
 #include <kernel/scheduler.h>
 #include <kernel/thread.h>
+#include <kernel/timerqueue.h>
 #include <kernel/arch/i386/cpu.h>
 #include <kernel/interrupt/apic.h>
 #include <kernel/time/apictimer.h>
@@ -135,9 +136,10 @@ namespace Kernel
         return true;
     }
 
-    /// @brief: enable local timer
+    /// @brief: enable local timer, the timer wheels of this processor have to exist before its first tick
     void APICTimer::enable_local_timer()
     {
+        TimerQueue::the().initialize_processor(Processor::current());
         APIC::the().setup_local_timer(m_timer_period, m_timer_mode, true);
     }
 
@@ -133,6 +133,11 @@ namespace Kernel
         Vector<HardwareTimerBase*> scan_for_non_periodic_timers();
         NonnullRefPtrVector<HardwareTimerBase> m_hardware_timers;
         void set_system_timer(HardwareTimerBase&);
+
+        /**
+         * @brief runs on every processor with a local timer and calls TimerQueue::fire()
+         *        there, each processor only fires the timers on its own wheels
+         */
         static void timer_tick(const RegisterState&);
 
         Atomic<u32> m_update1 { 0 };
@@ -4,9 +4,9 @@
  * @brief timer queue
  * @version 6.0
  * @date 2023-09-01
- * 
+ *
  * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
- * 
+ *
  */
 
 #include "timerqueue.h"
@@ -21,21 +21,22 @@
 
 namespace Kernel
 {
-    
+
     static Mods::Singleton<TimerQueue> s_the;
 
+    /// @brief only guards m_timers_by_id, the wheels have their own per-processor locks
     static SpinLock<u8> g_timerqueue_lock;
 
     /**
-     * @return timespec 
+     * @return timespec
      */
     timespec Timer::remaining() const
     {
         if (m_remaining == 0)
             return {};
-        
+
         return TimerQueue::the().ticks_to_time(m_clock_id, m_remaining);
-    } 
+    }
 
     u64 Timer::now() const
     {
@@ -43,11 +44,393 @@ namespace Kernel
     }
 
     /**
-     * @return TimerQueue& 
+     * @param timer
+     * @param earliest_tick
+     */
+    void TimerWheel::insert_locked(Timer& timer, u64 earliest_tick)
+    {
+        ASSERT(m_lock.is_locked());
+        ASSERT(!timer.is_queued());
+
+        u64 expires = max(timer.m_expires, earliest_tick);
+        u64 delta = expires - m_current_tick;
+        if (delta > max_delta) {
+            expires = m_current_tick + max_delta;
+            delta = max_delta;
+        }
+
+        size_t level = 0;
+        while (delta >= (1ull << (slot_bits * (level + 1))))
+            ++level;
+
+        timer.m_wheel = this;
+        timer.m_wheel_level = level;
+        timer.m_wheel_slot = (expires >> (slot_bits * level)) & (slots_per_level - 1);
+        m_slots[level][timer.m_wheel_slot].append(&timer);
+        timer.set_queued(true);
+        m_pending++;
+    }
+
+    /**
+     * @param timer
+     */
+    void TimerWheel::remove_locked(Timer& timer)
+    {
+        ASSERT(m_lock.is_locked());
+        ASSERT(timer.is_queued());
+        ASSERT(timer.m_wheel == this);
+
+        m_slots[timer.m_wheel_level][timer.m_wheel_slot].remove(&timer);
+        timer.set_queued(false);
+        m_pending--;
+    }
+
+    /**
+     * @param level
+     * @param slot
+     */
+    void TimerWheel::cascade_locked(size_t level, size_t slot)
+    {
+        auto& list = m_slots[level][slot];
+        while (auto* timer = list.remove_head()) {
+            timer->set_queued(false);
+            m_pending--;
+            insert_locked(*timer, m_current_tick);
+        }
+    }
+
+    /**
+     * @param list
+     */
+    void TimerWheel::take_all_locked(InlineLinkedList<Timer>& list)
+    {
+        for (auto& level : m_slots) {
+            for (auto& slot : level)
+                list.append(slot);
+        }
+        m_pending = 0;
+    }
+
+    /**
+     * @brief without this a timer armed after the step would be queued at the old,
+     *        later m_current_tick and fire late by the size of the step
+     *
+     * @param now
+     */
+    void TimerWheel::rewind_locked(u64 now)
+    {
+        ASSERT(m_lock.is_locked());
+        ASSERT(now < m_current_tick);
+
+        InlineLinkedList<Timer> all_timers;
+        take_all_locked(all_timers);
+        m_current_tick = now;
+
+        while (auto* timer = all_timers.remove_head()) {
+            timer->set_queued(false);
+            insert_locked(*timer, m_current_tick + 1);
+        }
+    }
+
+    /**
+     * @param now
+     */
+    void TimerWheel::advance_locked(u64 now)
+    {
+        ASSERT(m_lock.is_locked());
+
+        if (now < m_current_tick) {
+            rewind_locked(now);
+            return;
+        }
+
+        if (now == m_current_tick)
+            return;
+
+        if (m_pending == 0) {
+            m_current_tick = now;
+            return;
+        }
+
+        if (now - m_current_tick > slots_per_level * slots_per_level) {
+            InlineLinkedList<Timer> all_timers;
+            take_all_locked(all_timers);
+            m_current_tick = now;
+
+            while (auto* timer = all_timers.remove_head()) {
+                timer->set_queued(false);
+                if (timer->m_expires <= now)
+                    m_executing.append(timer);
+                else
+                    insert_locked(*timer, m_current_tick + 1);
+            }
+            return;
+        }
+
+        while (m_current_tick < now) {
+            ++m_current_tick;
+
+            size_t top_level = 0;
+            while (top_level + 1 < level_count && (m_current_tick & ((1ull << (slot_bits * (top_level + 1))) - 1)) == 0)
+                ++top_level;
+            for (size_t level = top_level; level > 0; --level)
+                cascade_locked(level, (m_current_tick >> (slot_bits * level)) & (slots_per_level - 1));
+
+            auto& due = m_slots[0][m_current_tick & (slots_per_level - 1)];
+            while (auto* timer = due.remove_head()) {
+                timer->set_queued(false);
+                m_pending--;
+                m_executing.append(timer);
+            }
+
+            if (m_pending == 0) {
+                m_current_tick = now;
+                break;
+            }
+        }
+    }
+
+    /**
+     * @return TimerQueue&
      */
     TimerQueue& TimerQueue::the()
     {
         return *s_the;
     }
 
-} // namespace Kernel
\ No newline at end of file
+    /// @brief Construct a new Timer Queue:: Timer Queue object
+    TimerQueue::TimerQueue()
+    {
+        m_ticks_per_second = TimeManagement::the().ticks_per_second();
+        initialize_processor(Processor::by_id(0));
+    }
+
+    /**
+     * @param processor
+     */
+    void TimerQueue::initialize_processor(Processor& processor)
+    {
+        if (processor.get_timer_queue_data())
+            return;
+
+        auto* data = new TimerQueuePerProcessorData(current_ticks(CLOCK_MONOTONIC), current_ticks(CLOCK_REALTIME));
+        processor.set_timer_queue_data(*data);
+    }
+
+    /**
+     * @return TimerQueuePerProcessorData&
+     */
+    TimerQueuePerProcessorData& TimerQueue::processor_data_for_enqueue()
+    {
+        ASSERT(Processor::current().in_critical());
+
+        if (auto* data = Processor::current().get_timer_queue_data())
+            return *data;
+
+        auto* data = Processor::by_id(0).get_timer_queue_data();
+        ASSERT(data);
+        return *data;
+    }
+
+    /**
+     * @param clock_id
+     * @param deadline
+     * @param callback
+     * @return RefPtr<Timer>
+     */
+    RefPtr<Timer> TimerQueue::add_timer_without_id(clockid_t clock_id, const timespec& deadline, Function<void()>&& callback)
+    {
+        if (deadline <= TimeManagement::the().current_time(clock_id).value())
+            return {};
+
+        auto timer = adopt(*new Timer(clock_id, time_to_ticks(clock_id, deadline), move(callback)));
+        enqueue_timer(timer);
+        return timer;
+    }
+
+    /**
+     * @param timer
+     * @return TimerId
+     */
+    TimerId TimerQueue::add_timer(NonnullRefPtr<Timer>&& timer)
+    {
+        TimerId id;
+        {
+            ScopedSpinLock lock(g_timerqueue_lock);
+            id = ++m_timer_id_count;
+            ASSERT(id != 0);
+            timer->m_id = id;
+            m_timers_by_id.set(id, timer.ptr());
+        }
+        enqueue_timer(move(timer));
+        return id;
+    }
+
+    /**
+     * @param clock_id
+     * @param deadline
+     * @param callback
+     * @return TimerId
+     */
+    TimerId TimerQueue::add_timer(clockid_t clock_id, timeval& deadline, Function<void()>&& callback)
+    {
+        auto expires = TimeManagement::the().current_time(clock_id).value();
+        timespec_add_timeval(expires, deadline, expires);
+        return add_timer(adopt(*new Timer(clock_id, time_to_ticks(clock_id, expires), move(callback))));
+    }
+
+    /**
+     * @param timer
+     */
+    void TimerQueue::enqueue_timer(NonnullRefPtr<Timer> timer)
+    {
+        ScopedCritical critical;
+        auto& wheel = wheel_for_timer(processor_data_for_enqueue(), *timer);
+        auto now = current_ticks(wheel.m_clock_id);
+
+        ScopedSpinLock lock(wheel.m_lock);
+        if (now < wheel.m_current_tick)
+            wheel.rewind_locked(now);
+        wheel.insert_locked(timer.leak_ref(), wheel.m_current_tick + 1);
+    }
+
+    /**
+     * @param id
+     * @return true
+     * @return false
+     */
+    bool TimerQueue::cancel_timer(TimerId id)
+    {
+        RefPtr<Timer> timer;
+        {
+            ScopedSpinLock lock(g_timerqueue_lock);
+            auto it = m_timers_by_id.find(id);
+            if (it == m_timers_by_id.end())
+                return false;
+            timer = it->value;
+        }
+        return cancel_timer(*timer);
+    }
+
+    /**
+     * @param timer
+     * @return true
+     * @return false
+     */
+    bool TimerQueue::cancel_timer(Timer& timer)
+    {
+        auto* wheel = timer.m_wheel;
+        if (!wheel)
+            return false;
+
+        {
+            ScopedSpinLock lock(wheel->m_lock);
+            if (!timer.is_queued()) {
+                while (wheel->m_executing.contains_slow(&timer)) {
+                    lock.unlock();
+                    Processor::wait_check();
+                    lock.lock();
+                }
+                return false;
+            }
+
+            wheel->remove_locked(timer);
+        }
+
+        auto now = timer.now();
+        if (timer.m_expires > now)
+            timer.m_remaining = timer.m_expires - now;
+
+        if (timer.m_id != 0) {
+            ScopedSpinLock lock(g_timerqueue_lock);
+            m_timers_by_id.remove(timer.m_id);
+        }
+
+        timer.unref();
+        return true;
+    }
+
+    /// @brief fire
+    void TimerQueue::fire()
+    {
+        ScopedCritical critical;
+        auto* data = Processor::current().get_timer_queue_data();
+        if (!data)
+            return;
+        fire_wheel(data->monotonic);
+        fire_wheel(data->realtime);
+    }
+
+    /**
+     * @param wheel
+     */
+    void TimerQueue::fire_wheel(TimerWheel& wheel)
+    {
+        Timer* first_expired;
+        {
+            ScopedSpinLock lock(wheel.m_lock);
+            if (wheel.pending() == 0)
+                return;
+
+            Timer* last_executing = wheel.m_executing.tail();
+            wheel.advance_locked(current_ticks(wheel.m_clock_id));
+            first_expired = last_executing ? last_executing->next() : wheel.m_executing.head();
+        }
+
+        for (auto* timer = first_expired; timer;) {
+            auto* next_timer = timer->next();
+
+            Processor::current().deferred_call_queue([this, &wheel, timer]() {
+                timer->m_callback();
+
+                {
+                    ScopedSpinLock lock(wheel.m_lock);
+                    wheel.m_executing.remove(timer);
+                }
+
+                if (timer->m_id != 0) {
+                    ScopedSpinLock lock(g_timerqueue_lock);
+                    m_timers_by_id.remove(timer->m_id);
+                }
+
+                timer->unref();
+            });
+
+            timer = next_timer;
+        }
+    }
+
+    /**
+     * @param clock_id
+     * @return u64
+     */
+    u64 TimerQueue::current_ticks(clockid_t clock_id) const
+    {
+        return time_to_ticks(clock_id, TimeManagement::the().current_time(clock_id).value());
+    }
+
+    /**
+     * @param ticks
+     * @return timespec
+     */
+    timespec TimerQueue::ticks_to_time(clockid_t, u64 ticks) const
+    {
+        timespec tspec;
+        tspec.tv_sec = ticks / m_ticks_per_second;
+        tspec.tv_nsec = (ticks % m_ticks_per_second) * (1'000'000'000 / m_ticks_per_second);
+        ASSERT(tspec.tv_nsec <= 1'000'000'000);
+        return tspec;
+    }
+
+    /**
+     * @param tspec
+     * @return u64
+     */
+    u64 TimerQueue::time_to_ticks(clockid_t, const timespec& tspec) const
+    {
+        u64 ticks = (u64)tspec.tv_sec * m_ticks_per_second;
+        ticks += ((u64)tspec.tv_nsec * m_ticks_per_second) / 1'000'000'000;
+        return ticks;
+    }
+
+} // namespace Kernel
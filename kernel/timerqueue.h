@@ -11,8 +11,10 @@
 
 #pragma once 
 
+#include <kernel/spinlock.h>
 #include <kernel/time/timemanagement.h>
 #include <mods/function.h>
+#include <mods/hashmap.h>
 #include <mods/inlinelinkedlist.h>
 #include <mods/nonnullrefptr.h>
 #include <mods/refcounted.h>
@@ -22,10 +24,13 @@ namespace Kernel
 
     typedef u64 TimerId;
 
+    class TimerWheel;
+
     class Timer : public RefCounted<Timer>
         , public InlineLinkedListNode<Timer> {
 
         friend class TimerQueue;
+        friend class TimerWheel;
         friend class InlineLinkedListNode<Timer>;
 
     public:
@@ -50,7 +55,7 @@ namespace Kernel
         timespec remaining() const;
 
     private:
-        TimerId m_id;
+        TimerId m_id { 0 };
         clockid_t m_clock_id;
         u64 m_expires;
         u64 m_remaining { 0 };
@@ -58,6 +63,9 @@ namespace Kernel
         Timer* m_next { nullptr };
         Timer* m_prev { nullptr };
         Atomic<bool> m_queued { false };
+        TimerWheel* m_wheel { nullptr };
+        u8 m_wheel_level { 0 };
+        u8 m_wheel_slot { 0 };
 
         /**
          * @param rhs 
@@ -112,6 +120,101 @@ namespace Kernel
         u64 now() const;
     }; // class Timer
 
+    /**
+     * @brief hierarchical timing wheel for one clock on one processor: level N slots are
+     *        64^N ticks wide, so insert and cancel are O(1) and each tick touches one
+     *        level-0 slot plus an occasional cascade of a higher level slot.
+     */
+    class TimerWheel 
+    {
+        MOD_MAKE_NONCOPYABLE(TimerWheel);
+        MOD_MAKE_NONMOVABLE(TimerWheel);
+
+        friend class TimerQueue;
+
+    public:
+        static constexpr size_t slot_bits = 6;
+        static constexpr size_t slots_per_level = 1 << slot_bits;
+        static constexpr size_t level_count = 4;
+        static constexpr u64 max_delta = (1ull << (slot_bits * level_count)) - 1;
+
+        /**
+         * @param clock_id 
+         * @param now 
+         */
+        TimerWheel(clockid_t clock_id, u64 now)
+            : m_clock_id(clock_id)
+            , m_current_tick(now)
+        {
+        }
+
+        /**
+         * @return size_t 
+         */
+        size_t pending() const 
+        { 
+            return m_pending; 
+        }
+
+    private:
+        /**
+         * @brief queue the timer in the slot for max(expiry, earliest_tick)
+         * 
+         */
+        void insert_locked(Timer&, u64 earliest_tick);
+
+        /// @brief remove_locked
+        void remove_locked(Timer&);
+
+        /**
+         * @brief move every timer due at or before now onto m_executing
+         * 
+         * @param now 
+         */
+        void advance_locked(u64 now);
+
+        /**
+         * @brief place every pending timer again relative to now, after the clock went
+         *        backwards past m_current_tick
+         *
+         * @param now
+         */
+        void rewind_locked(u64 now);
+
+        /// @brief cascade_locked
+        void cascade_locked(size_t level, size_t slot);
+
+        /**
+         * @brief move every pending timer onto list, leaving the wheel empty
+         *
+         * @param list
+         */
+        void take_all_locked(InlineLinkedList<Timer>& list);
+
+        SpinLock<u8> m_lock;
+        clockid_t m_clock_id;
+        u64 m_current_tick { 0 };
+        size_t m_pending { 0 };
+        InlineLinkedList<Timer> m_slots[level_count][slots_per_level];
+        InlineLinkedList<Timer> m_executing;
+    }; // class TimerWheel
+
+    struct TimerQueuePerProcessorData 
+    {
+        /**
+         * @param monotonic_now 
+         * @param realtime_now 
+         */
+        TimerQueuePerProcessorData(u64 monotonic_now, u64 realtime_now)
+            : monotonic(CLOCK_MONOTONIC, monotonic_now)
+            , realtime(CLOCK_REALTIME, realtime_now)
+        {
+        }
+
+        TimerWheel monotonic;
+        TimerWheel realtime;
+    }; // struct TimerQueuePerProcessorData
+
     class TimerQueue 
     {
         friend class Timer;
@@ -160,42 +263,63 @@ namespace Kernel
             return cancel_timer(*move(timer));
         }
 
-        /// @brief: fire.
+        /**
+         * @brief sets up the wheels of a processor. Runs for the boot processor when the
+         *        queue is created and for every other processor when its local timer is
+         *        enabled, never from the interrupt path
+         *
+         * @param processor
+         */
+        void initialize_processor(Processor& processor);
+
+        /**
+         * @brief fire the current processor's expired timers. Must be called from the
+         *        local timer tick of every processor that has wheels, a processor without
+         *        them queues its timers on the boot processor instead
+         */
         void fire();
 
     private:
-        struct Queue 
-        {
-            InlineLinkedList<Timer> list;
-            u64 next_timer_due { 0 };
-        }; // struct Queue
-
-        /// @breif: remove_timer_locked
-        void remove_timer_locked(Queue&, Timer&);
+        /**
+         * @brief queue the timer on the current processor's wheel
+         * 
+         */
+        void enqueue_timer(NonnullRefPtr<Timer>);
 
-        /// @breif: update_next_timer_due
-        /// @param Queue
-        void update_next_timer_due(Queue&);
+        /// @brief fire_wheel
+        void fire_wheel(TimerWheel&);
 
-        /// @brief: add_timer_locked
-        void add_timer_locked(NonnullRefPtr<Timer>);
+        /**
+         * @brief the wheels new timers go on: the current processor's if its local timer
+         *        fires them, the boot processor's otherwise. Must be called in a critical
+         *        section
+         *
+         * @return TimerQueuePerProcessorData&
+         */
+        TimerQueuePerProcessorData& processor_data_for_enqueue();
 
         /**
+         * @param data 
          * @param timer 
-         * @return Queue& 
+         * @return TimerWheel& 
          */
-        Queue& queue_for_timer(Timer& timer)
+        static TimerWheel& wheel_for_timer(TimerQueuePerProcessorData& data, Timer& timer)
         {
             switch (timer.m_clock_id) {
             case CLOCK_MONOTONIC:
-                return m_timer_queue_monotonic;
+                return data.monotonic;
             case CLOCK_REALTIME:
-                return m_timer_queue_realtime;
+                return data.realtime;
             default:
                 ASSERT_NOT_REACHED();
             }
         }
 
+        /**
+         * @return u64 
+         */
+        u64 current_ticks(clockid_t) const;
+
         /**
          * @param ticks 
          * @return timespec 
@@ -209,9 +333,7 @@ namespace Kernel
 
         u64 m_timer_id_count { 0 };
         u64 m_ticks_per_second { 0 };
-        Queue m_timer_queue_monotonic;
-        Queue m_timer_queue_realtime;
-        InlineLinkedList<Timer> m_timers_executing;
+        HashMap<TimerId, Timer*> m_timers_by_id;
     }; // class TimerQueue
 
 } // namespaace Kernel
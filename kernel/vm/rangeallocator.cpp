@@ -0,0 +1,271 @@
+/**
+ * @file rangeallocator.cpp
+ * @author Krisna Pranav
+ * @brief rangeallocator
+ * @version 6.0
+ * @date 2023-09-16
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <kernel/vm/rangeallocator.h>
+#include <mods/check.h>
+#include <mods/logstream.h>
+
+namespace Kernel
+{
+
+    /// @brief Construct a new RangeAllocator object
+    RangeAllocator::RangeAllocator()
+    {
+    }
+
+    /// @brief Destroy the RangeAllocator object
+    RangeAllocator::~RangeAllocator()
+    {
+    }
+
+    /**
+     * @param base
+     * @param size
+     */
+    void RangeAllocator::initialize_with_range(VirtualAddress base, size_t size)
+    {
+        ScopedSpinLock lock(m_lock);
+        m_total_range = { base, size };
+        m_free_ranges.clear();
+        m_free_ranges.insert(base.get(), size_t(size));
+    }
+
+    /**
+     * @param parent_allocator
+     */
+    void RangeAllocator::initialize_from_parent(const RangeAllocator& parent_allocator)
+    {
+        ScopedSpinLock lock(m_lock);
+        ScopedSpinLock parent_lock(parent_allocator.m_lock);
+        m_total_range = parent_allocator.m_total_range;
+        m_free_ranges.clear();
+        for (auto it = parent_allocator.m_free_ranges.begin(); it != parent_allocator.m_free_ranges.end(); ++it)
+            m_free_ranges.insert(it.key(), size_t(*it));
+    }
+
+    void RangeAllocator::dump() const
+    {
+        ScopedSpinLock lock(m_lock);
+        dbg() << "RangeAllocator{" << this << "}";
+        for (auto it = m_free_ranges.begin(); it != m_free_ranges.end(); ++it)
+            dbg() << "    " << Range(VirtualAddress(it.key()), *it);
+    }
+
+    /**
+     * @param taken
+     * @return Vector<Range, 2>
+     */
+    Vector<Range, 2> Range::carve(const Range& taken)
+    {
+        Vector<Range, 2> parts;
+        if (taken == *this)
+            return {};
+        if (taken.base() > base())
+            parts.append({ base(), taken.base().get() - base().get() });
+        if (taken.end() < end())
+            parts.append({ taken.end(), end().get() - taken.end().get() });
+        return parts;
+    }
+
+    /**
+     * @brief the lowest free range of at least size bytes, found by descending into the
+     *        leftmost subtree whose largest free range is big enough
+     *
+     * @param size
+     * @return RangeAllocator::FreeRangeTree::Node*
+     */
+    RangeAllocator::FreeRangeTree::Node* RangeAllocator::find_first_free_range_of_size(size_t size) const
+    {
+        auto* node = m_free_ranges.root();
+        if (!node || node->augment.largest_free_size < size)
+            return nullptr;
+
+        for (;;) {
+            if (node->left && node->left->augment.largest_free_size >= size) {
+                node = node->left;
+                continue;
+            }
+            if (node->value >= size)
+                return node;
+            ASSERT(node->right && node->right->augment.largest_free_size >= size);
+            node = node->right;
+        }
+    }
+
+    /**
+     * @brief the lowest free range that holds size bytes starting at an alignment boundary.
+     *        An in-order walk up and down the parent links that skips subtrees without any
+     *        range of size bytes, so it runs in constant stack under the lock
+     *
+     * @param size
+     * @param alignment
+     * @return RangeAllocator::FreeRangeTree::Node*
+     */
+    RangeAllocator::FreeRangeTree::Node* RangeAllocator::find_first_aligned_free_range(size_t size, size_t alignment) const
+    {
+        auto can_hold = [size](FreeRangeTree::Node* node) {
+            return node && node->augment.largest_free_size >= size;
+        };
+
+        auto* node = m_free_ranges.root();
+        if (!can_hold(node))
+            return nullptr;
+
+        while (can_hold(node->left))
+            node = node->left;
+
+        for (;;) {
+            if (node->value >= size) {
+                FlatPtr aligned_base = (node->key + alignment - 1) & ~(FlatPtr)(alignment - 1);
+                if (aligned_base >= node->key && aligned_base - node->key <= node->value - size)
+                    return node;
+            }
+
+            if (can_hold(node->right)) {
+                node = node->right;
+                while (can_hold(node->left))
+                    node = node->left;
+                continue;
+            }
+
+            // climb until we come up out of a left subtree, its parent is next in order
+            for (;;) {
+                auto* parent = node->parent;
+                if (!parent)
+                    return nullptr;
+                bool from_left = parent->left == node;
+                node = parent;
+                if (from_left)
+                    break;
+            }
+        }
+    }
+
+    /**
+     * @param node
+     * @param taken
+     */
+    void RangeAllocator::carve_from_node(FreeRangeTree::Node* node, const Range& taken)
+    {
+        ASSERT(m_lock.is_locked());
+        Range available(VirtualAddress(node->key), node->value);
+        ASSERT(available.contains(taken));
+
+        if (taken.base() == available.base()) {
+            m_free_ranges.remove(node->key);
+        } else {
+            node->value = taken.base().get() - available.base().get();
+            m_free_ranges.value_did_change(node);
+        }
+
+        if (taken.end() < available.end())
+            m_free_ranges.insert(taken.end().get(), available.end().get() - taken.end().get());
+    }
+
+    /**
+     * @param size
+     * @param alignment
+     * @return Range
+     */
+    Range RangeAllocator::allocate_anywhere(size_t size, size_t alignment)
+    {
+        if (!size)
+            return {};
+
+        ASSERT((size % PAGE_SIZE) == 0);
+        ASSERT((alignment % PAGE_SIZE) == 0);
+
+        // any range of size + alignment - PAGE_SIZE bytes holds an aligned block of size,
+        // so a larger alignment first descends for one of those. Only when none is left
+        // are the smaller ranges walked, for one that happens to be aligned well enough
+        ScopedSpinLock lock(m_lock);
+        FreeRangeTree::Node* node;
+        if (alignment > PAGE_SIZE) {
+            node = nullptr;
+            if (!Checked<size_t>::addition_would_overflow(size, alignment - PAGE_SIZE))
+                node = find_first_free_range_of_size(size + alignment - PAGE_SIZE);
+            if (!node)
+                node = find_first_aligned_free_range(size, alignment);
+        } else {
+            node = find_first_free_range_of_size(size);
+        }
+        if (!node) {
+            klog() << "RangeAllocator: Failed to allocate anywhere: size=" << size << ", alignment=" << alignment;
+            return {};
+        }
+
+        FlatPtr aligned_base = node->key;
+        if (alignment > PAGE_SIZE)
+            aligned_base = (aligned_base + alignment - 1) & ~(FlatPtr)(alignment - 1);
+
+        Range allocated_range(VirtualAddress(aligned_base), size);
+        carve_from_node(node, allocated_range);
+        return allocated_range;
+    }
+
+    /**
+     * @param base
+     * @param size
+     * @return Range
+     */
+    Range RangeAllocator::allocate_specific(VirtualAddress base, size_t size)
+    {
+        if (!size)
+            return {};
+
+        Range allocated_range(base, size);
+        ScopedSpinLock lock(m_lock);
+        auto* node = m_free_ranges.largest_not_above_node(base.get());
+        if (!node || !Range(VirtualAddress(node->key), node->value).contains(allocated_range))
+            return {};
+
+        carve_from_node(node, allocated_range);
+        return allocated_range;
+    }
+
+    /**
+     * @brief give range back, merging it with the free ranges directly before and after it
+     *
+     * @param range
+     */
+    void RangeAllocator::deallocate(Range range)
+    {
+        ScopedSpinLock lock(m_lock);
+        ASSERT(m_total_range.contains(range));
+        ASSERT(range.size());
+        ASSERT(range.base() < range.end());
+
+        FlatPtr base = range.base().get();
+        size_t size = range.size();
+
+        auto* next = m_free_ranges.smallest_not_below_node(base);
+        if (next) {
+            ASSERT(next->key >= range.end().get());
+            if (next->key == range.end().get()) {
+                size += next->value;
+                m_free_ranges.remove(next->key);
+            }
+        }
+
+        auto* previous = m_free_ranges.largest_not_above_node(base);
+        if (previous) {
+            ASSERT(previous->key + previous->value <= base);
+            if (previous->key + previous->value == base) {
+                previous->value += size;
+                m_free_ranges.value_did_change(previous);
+                return;
+            }
+        }
+
+        m_free_ranges.insert(base, move(size));
+    }
+
+} // namespace Kernel
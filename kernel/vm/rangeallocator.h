@@ -13,6 +13,7 @@
 
 #include <kernel/spinlock.h>
 #include <kernel/virtual_address.h>
+#include <mods/redblacktree.h>
 #include <mods/string.h>
 #include <mods/traits.h>
 #include <mods/vector.h>
@@ -124,9 +125,41 @@ namespace Kernel
         size_t m_size { 0 };
     }; // class Range
 
+    /**
+     * @brief free ranges are kept by base with their size as value, every node also
+     *        remembers the largest free range in its subtree so allocate_anywhere can
+     *        skip whole subtrees that are too fragmented
+     */
+    struct FreeRangeAugment
+    {
+        static constexpr bool is_augmented = true;
+
+        struct Data
+        {
+            size_t largest_free_size { 0 };
+        };
+
+        /**
+         * @tparam Node
+         * @param node
+         */
+        template<typename Node>
+        static void recompute(Node& node)
+        {
+            size_t largest = node.value;
+            if (node.left && node.left->augment.largest_free_size > largest)
+                largest = node.left->augment.largest_free_size;
+            if (node.right && node.right->augment.largest_free_size > largest)
+                largest = node.right->augment.largest_free_size;
+            node.augment.largest_free_size = largest;
+        }
+    }; // struct FreeRangeAugment
+
     class RangeAllocator 
     {
     public:
+        using FreeRangeTree = RedBlackTree<FlatPtr, size_t, FreeRangeAugment>;
+
         RangeAllocator();
         ~RangeAllocator();
 
@@ -162,9 +195,21 @@ namespace Kernel
         }
 
     private:
-        void carve_at_index(int, const Range&);
+        /**
+         * @return FreeRangeTree::Node* 
+         */
+        FreeRangeTree::Node* find_first_free_range_of_size(size_t) const;
+
+        /**
+         * @param size 
+         * @param alignment 
+         * @return FreeRangeTree::Node* 
+         */
+        FreeRangeTree::Node* find_first_aligned_free_range(size_t size, size_t alignment) const;
+
+        void carve_from_node(FreeRangeTree::Node*, const Range&);
 
-        Vector<Range> m_available_ranges;
+        FreeRangeTree m_free_ranges;
 
         Range m_total_range;
         mutable SpinLock<u8> m_lock;
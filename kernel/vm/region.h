@@ -504,6 +504,21 @@ namespace Kernel
          */
         PageFaultResponse handle_inode_fault(size_t page_index);
 
+        /**
+         * @brief map the neighbours of page_index that the vmobject already has in memory
+         *
+         * @param page_index
+         */
+        void fault_around(size_t page_index);
+
+        /**
+         * @brief grow or reset the read-ahead window for a fault at page_index
+         *
+         * @param page_index
+         * @return size_t how many pages to read, including page_index
+         */
+        size_t pages_to_read_for_fault(size_t page_index);
+
         /**
          * @param page_index 
          * @return PageFaultResponse 
@@ -536,6 +551,10 @@ namespace Kernel
         bool m_mmap : 1 { false };
         bool m_kernel : 1 { false };
         mutable OwnPtr<Bitmap> m_cow_map;
+
+        /// @brief page the next fault lands on if this region is being read sequentially
+        size_t m_read_ahead_next_page { 0 };
+        size_t m_read_ahead_window { 0 };
     };
 
     /**
@@ -0,0 +1,197 @@
+/**
+ * @file regionfaultaround.cpp
+ * @author Krisna Pranav
+ * @brief inode fault-around and read-ahead
+ * @version 6.0
+ * @date 2023-09-17
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#include <kernel/commandline.h>
+#include <kernel/filesystem/inode.h>
+#include <kernel/heap/kmalloc.h>
+#include <kernel/stdlib.h>
+#include <kernel/vm/inodevmobject.h>
+#include <kernel/vm/memorymanager.h>
+#include <kernel/vm/physicalpage.h>
+#include <kernel/vm/region.h>
+
+namespace Kernel
+{
+
+    static constexpr size_t default_fault_around_pages = 16;
+    static constexpr size_t default_max_read_ahead_pages = 32;
+    static constexpr size_t initial_read_ahead_pages = 4;
+
+    static bool s_fault_tunables_initialized;
+    static size_t s_fault_around_pages;
+    static size_t s_max_read_ahead_pages;
+
+    /**
+     * @param key
+     * @param default_value
+     * @return size_t
+     */
+    static size_t fault_tunable_from_command_line(const char* key, size_t default_value)
+    {
+        auto value = kernel_command_line().lookup(key);
+        if (!value.has_value())
+            return default_value;
+        return value.value().to_uint().value_or(default_value);
+    }
+
+    /**
+     * @brief fault_around=<pages> and read_ahead=<pages> on the kernel command line, 0 turns either off
+     */
+    static void initialize_fault_tunables()
+    {
+        if (s_fault_tunables_initialized)
+            return;
+        s_fault_around_pages = fault_tunable_from_command_line("fault_around", default_fault_around_pages);
+        s_max_read_ahead_pages = fault_tunable_from_command_line("read_ahead", default_max_read_ahead_pages);
+        s_fault_tunables_initialized = true;
+    }
+
+    /**
+     * @param page_index
+     */
+    void Region::fault_around(size_t page_index)
+    {
+        if (s_fault_around_pages <= 1)
+            return;
+
+        // same aligned window for every fault in it, so neighbouring faults don't redo each other's work
+        size_t window_start = page_index - (page_index % s_fault_around_pages);
+        size_t window_end = min(window_start + s_fault_around_pages, page_count());
+
+        for (size_t i = window_start; i < window_end; ++i) {
+            if (i == page_index || physical_page_slot(i).is_null())
+                continue;
+            remap_page(i, false);
+        }
+    }
+
+    /**
+     * @param page_index
+     * @return size_t
+     */
+    size_t Region::pages_to_read_for_fault(size_t page_index)
+    {
+        if (s_max_read_ahead_pages == 0)
+            return 1;
+
+        if (page_index == m_read_ahead_next_page) {
+            if (m_read_ahead_window == 0)
+                m_read_ahead_window = min(initial_read_ahead_pages, s_max_read_ahead_pages);
+            else
+                m_read_ahead_window = min(m_read_ahead_window * 2, s_max_read_ahead_pages);
+        } else {
+            m_read_ahead_window = 0;
+        }
+
+        return 1 + m_read_ahead_window;
+    }
+
+    /**
+     * @brief pages the faulting page in together with a read-ahead window behind it when the
+     *        region is being streamed, and maps whatever else the vmobject already holds nearby
+     *
+     * @param page_index_in_region
+     * @return PageFaultResponse
+     */
+    PageFaultResponse Region::handle_inode_fault(size_t page_index_in_region)
+    {
+        ASSERT_INTERRUPTS_DISABLED();
+        ASSERT(vmobject().is_inode());
+
+        LOCKER(vmobject().m_paging_lock);
+
+        ASSERT_INTERRUPTS_DISABLED();
+        initialize_fault_tunables();
+
+        auto& inode_vmobject = static_cast<InodeVMObject&>(vmobject());
+
+        if (!physical_page_slot(page_index_in_region).is_null()) {
+            if (page_index_in_region == m_read_ahead_next_page)
+                m_read_ahead_next_page++;
+            remap_page(page_index_in_region);
+            fault_around(page_index_in_region);
+            return PageFaultResponse::Continue;
+        }
+
+        size_t wanted_pages = pages_to_read_for_fault(page_index_in_region);
+        size_t page_count_to_read = 1;
+        while (page_count_to_read < wanted_pages
+            && page_index_in_region + page_count_to_read < page_count()
+            && physical_page_slot(page_index_in_region + page_count_to_read).is_null())
+            ++page_count_to_read;
+
+        size_t buffer_size = page_count_to_read * PAGE_SIZE;
+        u8 single_page_buffer[PAGE_SIZE];
+        u8* page_buffer = page_count_to_read == 1 ? single_page_buffer : (u8*)kmalloc(buffer_size);
+
+        sti();
+        auto& inode = inode_vmobject.inode();
+        auto buffer = UserOrKernelBuffer::for_kernel_buffer(page_buffer);
+        auto nread = inode.read_bytes((first_page_index() + page_index_in_region) * PAGE_SIZE, buffer_size, buffer, nullptr);
+        cli();
+
+        if (nread < 0) {
+            if (page_buffer != single_page_buffer)
+                kfree(page_buffer);
+            klog() << "MM: handle_inode_fault had error (" << nread << ") while reading!";
+            return PageFaultResponse::ShouldCrash;
+        }
+
+        if ((size_t)nread < buffer_size)
+            memset(page_buffer + nread, 0, buffer_size - nread);
+
+        auto response = PageFaultResponse::Continue;
+        size_t pages_read = 0;
+        for (size_t i = 0; i < page_count_to_read; ++i) {
+            if (i > 0 && i * PAGE_SIZE >= (size_t)nread)
+                break;
+
+            auto& page_slot = physical_page_slot(page_index_in_region + i);
+            ASSERT(page_slot.is_null());
+
+            page_slot = MM.allocate_user_physical_page(MemoryManager::ShouldZeroFill::No);
+            if (page_slot.is_null()) {
+                if (i == 0) {
+                    klog() << "MM: handle_inode_fault was unable to allocate a physical page";
+                    response = PageFaultResponse::OutOfMemory;
+                }
+                break;
+            }
+
+            u8* dest_ptr = MM.quickmap_page(*page_slot);
+            void* fault_at;
+            bool copied = safe_memcpy(dest_ptr, page_buffer + i * PAGE_SIZE, PAGE_SIZE, fault_at);
+            MM.unquickmap_page();
+
+            if (!copied) {
+                klog() << "MM: handle_inode_fault safe_memcpy faulted at " << VirtualAddress(fault_at);
+                page_slot = nullptr;
+                if (i == 0)
+                    response = PageFaultResponse::ShouldCrash;
+                break;
+            }
+
+            remap_page(page_index_in_region + i, i == 0);
+            ++pages_read;
+        }
+
+        if (page_buffer != single_page_buffer)
+            kfree(page_buffer);
+
+        if (response != PageFaultResponse::Continue)
+            return response;
+
+        m_read_ahead_next_page = page_index_in_region + pages_read;
+        fault_around(page_index_in_region);
+        return PageFaultResponse::Continue;
+    }
+
+} // namespace Kernel
@@ -26,6 +26,8 @@
 
 #define PIPE_BUF 4096
 
+#define IOV_MAX 1024
+
 #define INT_MAX INT32_MAX
 #define INT_MIN INT32_MIN
 
@@ -70,6 +70,28 @@ extern "C"
         __RETURN_WITH_ERRNO(rc, rc, -1);
     }
 
+    /**
+     * @param frequency 
+     * @return int 
+     */
+    int profiling_set_frequency(unsigned frequency)
+    {
+        int rc = syscall(SC_profiling_set_frequency, frequency);
+        __RETURN_WITH_ERRNO(rc, rc, -1);
+    }
+
+    /**
+     * @param pid 
+     * @param buffer 
+     * @param size 
+     * @return ssize_t 
+     */
+    ssize_t profiling_read(pid_t pid, void* buffer, size_t size)
+    {
+        int rc = syscall(SC_profiling_read, pid, buffer, size);
+        __RETURN_WITH_ERRNO(rc, rc, -1);
+    }
+
     /**
      * @param tid 
      * @param amount 
@@ -97,11 +119,13 @@ extern "C"
      * @param futex_op 
      * @param value 
      * @param timeout 
+     * @param userspace_address2 
+     * @param value3 
      * @return int 
      */
-    int futex(int32_t* userspace_address, int futex_op, int32_t value, const struct timespec* timeout)
+    int futex(int32_t* userspace_address, int futex_op, int32_t value, const struct timespec* timeout, int32_t* userspace_address2, int32_t value3)
     {
-        Syscall::SC_futex_params params { userspace_address, futex_op, value, timeout };
+        Syscall::SC_futex_params params { userspace_address, futex_op, value, { timeout }, userspace_address2, value3 };
         int rc = syscall(SC_futex, &params);
         __RETURN_WITH_ERRNO(rc, rc, -1);
     }
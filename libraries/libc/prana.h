@@ -26,9 +26,19 @@ __BEGIN_DECLS
 
 #define FUTEX_WAIT 1
 #define FUTEX_WAKE 2
+#define FUTEX_REQUEUE 3
+#define FUTEX_CMP_REQUEUE 4
+#define FUTEX_WAIT_BITSET 9
+#define FUTEX_WAKE_BITSET 10
+
+#define FUTEX_PRIVATE_FLAG (1 << 7)
+#define FUTEX_CMD_MASK ~(FUTEX_PRIVATE_FLAG)
+
+#define FUTEX_BITSET_MATCH_ANY 0xffffffff
 
 #define PERF_EVENT_MALLOC 1
 #define PERF_EVENT_FREE 2
+#define PERF_EVENT_SAMPLE 3
 
 
 #define PURGE_ALL_VOLATILE 0x1
@@ -103,6 +113,20 @@ int profiling_enable(pid_t);
  */
 int profiling_disable(pid_t);
 
+/**
+ * @param frequency 
+ * @return int 
+ */
+int profiling_set_frequency(unsigned frequency);
+
+/**
+ * @param pid 
+ * @param buffer 
+ * @param size 
+ * @return ssize_t 
+ */
+ssize_t profiling_read(pid_t pid, void* buffer, size_t size);
+
 /**
  * @param tid 
  * @param amount 
@@ -117,13 +141,17 @@ int set_thread_boost(pid_t tid, int amount);
 int set_process_boost(pid_t, int amount);
 
 /**
+ * @brief for FUTEX_REQUEUE and FUTEX_CMP_REQUEUE the timeout argument carries the requeue count
+ * 
  * @param userspace_address 
  * @param futex_op 
  * @param value 
  * @param timeout 
+ * @param userspace_address2 
+ * @param value3 
  * @return int 
  */
-int futex(int32_t* userspace_address, int futex_op, int32_t value, const struct timespec* timeout);
+int futex(int32_t* userspace_address, int futex_op, int32_t value, const struct timespec* timeout, int32_t* userspace_address2, int32_t value3);
 
 /**
  * @param mode 
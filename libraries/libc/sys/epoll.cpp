@@ -0,0 +1,79 @@
+/**
+ * @file epoll.cpp
+ * @author Krisna Pranav
+ * @brief epoll
+ * @version 6.0
+ * @date 2023-09-22
+ * 
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ * 
+ */
+
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/time.h>
+#include <kernel/api/syscall.h>
+
+extern "C" 
+{
+
+    /**
+     * @param size 
+     * @return int 
+     */
+    int epoll_create(int size)
+    {
+        if (size <= 0) {
+            errno = EINVAL;
+            return -1;
+        }
+        return epoll_create1(0);
+    }
+
+    /**
+     * @param flags 
+     * @return int 
+     */
+    int epoll_create1(int flags)
+    {
+        int rc = syscall(SC_epoll_create, flags);
+        __RETURN_WITH_ERRNO(rc, rc, -1);
+    }
+
+    /**
+     * @param epfd 
+     * @param op 
+     * @param fd 
+     * @param event 
+     * @return int 
+     */
+    int epoll_ctl(int epfd, int op, int fd, epoll_event* event)
+    {
+        Syscall::SC_epoll_ctl_params params { epfd, op, fd, event };
+        int rc = syscall(SC_epoll_ctl, &params);
+        __RETURN_WITH_ERRNO(rc, rc, -1);
+    }
+
+    /**
+     * @param epfd 
+     * @param events 
+     * @param max_events 
+     * @param timeout_ms 
+     * @return int 
+     */
+    int epoll_wait(int epfd, epoll_event* events, int max_events, int timeout_ms)
+    {
+        timespec timeout;
+        timespec* timeout_ts = &timeout;
+
+        if (timeout_ms < 0)
+            timeout_ts = nullptr;
+        else
+            timeout = { timeout_ms / 1000, (timeout_ms % 1000) * 1'000'000 };
+
+        Syscall::SC_epoll_wait_params params { epfd, events, max_events, timeout_ts };
+        int rc = syscall(SC_epoll_wait, &params);
+        __RETURN_WITH_ERRNO(rc, rc, -1);
+    }
+
+}
@@ -0,0 +1,80 @@
+/**
+ * @file epoll.h
+ * @author Krisna Pranav
+ * @brief epoll
+ * @version 6.0
+ * @date 2023-09-22
+ * 
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ * 
+ */
+
+#pragma once 
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <sys/cdefs.h>
+
+__BEGIN_DECLS
+
+/// @brief: EPOLL[IN, PRI, OUT, ERR, HUP, RDHUP] share their bits with poll(), EPOLLET asks for edge-triggered reports
+#define EPOLLIN POLLIN
+#define EPOLLPRI POLLPRI
+#define EPOLLOUT POLLOUT
+#define EPOLLERR POLLERR
+#define EPOLLHUP POLLHUP
+#define EPOLLRDHUP POLLRDHUP
+#define EPOLLET (1u << 31)
+
+#define EPOLL_CTL_ADD 1
+#define EPOLL_CTL_DEL 2
+#define EPOLL_CTL_MOD 3
+
+#define EPOLL_CLOEXEC O_CLOEXEC
+
+typedef union epoll_data 
+{
+    void* ptr;
+    int fd;
+    uint32_t u32;
+    uint64_t u64;
+} epoll_data_t;
+
+struct epoll_event 
+{
+    uint32_t events;
+    epoll_data_t data;
+}; // struct epoll_event
+
+/**
+ * @param size ignored, kept for source compatibility
+ * @return int 
+ */
+int epoll_create(int size);
+
+/**
+ * @param flags 
+ * @return int 
+ */
+int epoll_create1(int flags);
+
+/**
+ * @param epfd 
+ * @param op 
+ * @param fd 
+ * @param event 
+ * @return int 
+ */
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event* event);
+
+/**
+ * @param epfd 
+ * @param events 
+ * @param max_events 
+ * @param timeout in milliseconds, -1 waits forever
+ * @return int 
+ */
+int epoll_wait(int epfd, struct epoll_event* events, int max_events, int timeout);
+
+__END_DECLS
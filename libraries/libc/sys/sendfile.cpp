@@ -0,0 +1,49 @@
+/**
+ * @file sendfile.cpp
+ * @author Krisna Pranav
+ * @brief sendfile
+ * @version 6.0
+ * @date 2023-09-23
+ * 
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ * 
+ */
+
+#include <errno.h>
+#include <sys/sendfile.h>
+#include <kernel/api/syscall.h>
+
+extern "C" 
+{
+
+    /**
+     * @param out_fd 
+     * @param in_fd 
+     * @param offset 
+     * @param count 
+     * @return ssize_t 
+     */
+    ssize_t sendfile(int out_fd, int in_fd, off_t* offset, size_t count)
+    {
+        Syscall::SC_sendfile_params params { out_fd, in_fd, offset, count };
+        int rc = syscall(SC_sendfile, &params);
+        __RETURN_WITH_ERRNO(rc, rc, -1);
+    }
+
+    /**
+     * @param fd_in 
+     * @param off_in 
+     * @param fd_out 
+     * @param off_out 
+     * @param length 
+     * @param flags 
+     * @return ssize_t 
+     */
+    ssize_t splice(int fd_in, off_t* off_in, int fd_out, off_t* off_out, size_t length, unsigned flags)
+    {
+        Syscall::SC_splice_params params { fd_in, off_in, fd_out, off_out, length, flags };
+        int rc = syscall(SC_splice, &params);
+        __RETURN_WITH_ERRNO(rc, rc, -1);
+    }
+
+}
@@ -0,0 +1,44 @@
+/**
+ * @file sendfile.h
+ * @author Krisna Pranav
+ * @brief sendfile
+ * @version 6.0
+ * @date 2023-09-23
+ * 
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ * 
+ */
+
+#pragma once 
+
+#include <sys/cdefs.h>
+#include <sys/types.h>
+
+__BEGIN_DECLS
+
+/**
+ * @brief copy count bytes from in_fd to out_fd inside the kernel, a non-null offset is
+ *        used and updated instead of in_fd's own offset
+ * 
+ * @param out_fd 
+ * @param in_fd 
+ * @param offset 
+ * @param count 
+ * @return ssize_t 
+ */
+ssize_t sendfile(int out_fd, int in_fd, off_t* offset, size_t count);
+
+/**
+ * @brief like sendfile, off_out writes fd_out at an offset as well. flags must be 0
+ * 
+ * @param fd_in 
+ * @param off_in 
+ * @param fd_out 
+ * @param off_out 
+ * @param length 
+ * @param flags 
+ * @return ssize_t 
+ */
+ssize_t splice(int fd_in, off_t* off_in, int fd_out, off_t* off_out, size_t length, unsigned flags);
+
+__END_DECLS
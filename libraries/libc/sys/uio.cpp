@@ -13,6 +13,7 @@
 
 #include <errno.h>
 #include <sys/uio.h>
+#include <unistd.h>
 #include <kernel/api/syscall.h>
 
 extern "C" 
@@ -28,4 +29,72 @@ extern "C"
         int rc = syscall(SC_writev, fd, iov, iov_count);
         __RETURN_WITH_ERRNO(rc, rc, -1);
     }
+
+    /**
+     * @param fd 
+     * @param iov 
+     * @param iov_count 
+     * @return ssize_t 
+     */
+    ssize_t readv(int fd, const struct iovec* iov, int iov_count)
+    {
+        int rc = syscall(SC_readv, fd, iov, iov_count);
+        __RETURN_WITH_ERRNO(rc, rc, -1);
+    }
+
+    /**
+     * @param fd 
+     * @param iov 
+     * @param iov_count 
+     * @param offset 
+     * @return ssize_t 
+     */
+    ssize_t preadv(int fd, const struct iovec* iov, int iov_count, off_t offset)
+    {
+        Syscall::SC_preadv_params params { fd, iov, iov_count, offset };
+        int rc = syscall(SC_preadv, &params);
+        __RETURN_WITH_ERRNO(rc, rc, -1);
+    }
+
+    /**
+     * @param fd 
+     * @param iov 
+     * @param iov_count 
+     * @param offset 
+     * @return ssize_t 
+     */
+    ssize_t pwritev(int fd, const struct iovec* iov, int iov_count, off_t offset)
+    {
+        Syscall::SC_preadv_params params { fd, iov, iov_count, offset };
+        int rc = syscall(SC_pwritev, &params);
+        __RETURN_WITH_ERRNO(rc, rc, -1);
+    }
+
+    /**
+     * @param fd 
+     * @param buf 
+     * @param count 
+     * @param offset 
+     * @return ssize_t 
+     */
+    ssize_t pread(int fd, void* buf, size_t count, off_t offset)
+    {
+        Syscall::SC_pread_params params { fd, { (u8*)buf, count }, offset };
+        int rc = syscall(SC_pread, &params);
+        __RETURN_WITH_ERRNO(rc, rc, -1);
+    }
+
+    /**
+     * @param fd 
+     * @param buf 
+     * @param count 
+     * @param offset 
+     * @return ssize_t 
+     */
+    ssize_t pwrite(int fd, const void* buf, size_t count, off_t offset)
+    {
+        Syscall::SC_pwrite_params params { fd, { (const u8*)buf, count }, offset };
+        int rc = syscall(SC_pwrite, &params);
+        __RETURN_WITH_ERRNO(rc, rc, -1);
+    }
 }
@@ -29,4 +29,20 @@ struct iovec {
  */
 ssize_t writev(int fd, const struct iovec*, int iov_count);
 
+/**
+ * @param fd 
+ * @param iov_count 
+ * @return ssize_t 
+ */
+ssize_t readv(int fd, const struct iovec*, int iov_count);
+
+/**
+ * @param fd 
+ * @param iov_count 
+ * @param offset 
+ * @return ssize_t 
+ */
+ssize_t preadv(int fd, const struct iovec*, int iov_count, off_t offset);
+ssize_t pwritev(int fd, const struct iovec*, int iov_count, off_t offset);
+
 __END_DECLS
\ No newline at end of file
@@ -269,6 +269,14 @@ ssize_t pread(int fd, void* buf, size_t count, off_t);
  */
 ssize_t write(int fd, const void* buf, size_t count);
 
+/**
+ * @param fd 
+ * @param buf 
+ * @param count 
+ * @return ssize_t 
+ */
+ssize_t pwrite(int fd, const void* buf, size_t count, off_t);
+
 /**
  * @param fd 
  * @return int 
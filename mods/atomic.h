@@ -25,6 +25,15 @@ namespace Mods {
         memory_order_seq_cst = __ATOMIC_SEQ_CST
     };
 
+    /**
+     * @brief atomic_thread_fence
+     * 
+     * @param order 
+     */
+    static inline void atomic_thread_fence(MemoryOrder order) noexcept {
+        return __atomic_thread_fence(order);
+    }
+
     /**
      * @brief atomc_exchange
      * 
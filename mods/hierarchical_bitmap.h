@@ -0,0 +1,483 @@
+/**
+ * @file hierarchical_bitmap.h
+ * @author Krisna Pranav
+ * @brief hierarchical bitmap
+ * @version 6.0
+ * @date 2023-07-11
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#pragma once
+
+#include "assertions.h"
+#include "noncopyable.h"
+#include "optional.h"
+#include "platform.h"
+#include "stdlibextra.h"
+#include "types.h"
+#include "kmalloc.h"
+
+namespace Mods
+{
+
+    /**
+     * @brief Bitmap with a summary level: one "full" and one "empty" bit per 64-bit word,
+     *        so searches skip 4096-bit stretches of uniform bits with a single summary test.
+     *        Bits past size() are kept set, so they never show up as free.
+     */
+    class HierarchicalBitmap
+    {
+        MOD_MAKE_NONCOPYABLE(HierarchicalBitmap);
+
+    public:
+        /**
+         * @param size
+         * @return size_t
+         */
+        static size_t storage_size_in_bytes(size_t size)
+        {
+            size_t word_count = words_for(size);
+            return (word_count + 2 * words_for(word_count)) * sizeof(u64);
+        }
+
+        /**
+         * @brief lay the bitmap out in caller provided (8-byte aligned) storage, initialized to default_value
+         *
+         * @param storage
+         * @param size
+         * @param default_value
+         * @return HierarchicalBitmap
+         */
+        static HierarchicalBitmap wrap(u8* storage, size_t size, bool default_value = false)
+        {
+            return HierarchicalBitmap(storage, size, default_value, false);
+        }
+
+        /**
+         * @param size
+         * @param default_value
+         * @return HierarchicalBitmap
+         */
+        static HierarchicalBitmap create(size_t size, bool default_value = false)
+        {
+            ASSERT(size != 0);
+            return HierarchicalBitmap(reinterpret_cast<u8*>(kmalloc(storage_size_in_bytes(size))), size, default_value, true);
+        }
+
+        /**
+         * @param other
+         */
+        HierarchicalBitmap(HierarchicalBitmap&& other)
+        {
+            m_words = exchange(other.m_words, nullptr);
+            m_full = exchange(other.m_full, nullptr);
+            m_empty = exchange(other.m_empty, nullptr);
+            m_size = exchange(other.m_size, 0);
+            m_word_count = exchange(other.m_word_count, 0);
+            m_summary_count = exchange(other.m_summary_count, 0);
+            m_owned = exchange(other.m_owned, false);
+        }
+
+        /**
+         * @param other
+         * @return HierarchicalBitmap&
+         */
+        HierarchicalBitmap& operator=(HierarchicalBitmap&& other)
+        {
+            if (this != &other) {
+                if (m_owned)
+                    kfree(m_words);
+                m_words = exchange(other.m_words, nullptr);
+                m_full = exchange(other.m_full, nullptr);
+                m_empty = exchange(other.m_empty, nullptr);
+                m_size = exchange(other.m_size, 0);
+                m_word_count = exchange(other.m_word_count, 0);
+                m_summary_count = exchange(other.m_summary_count, 0);
+                m_owned = exchange(other.m_owned, false);
+            }
+            return *this;
+        }
+
+        /**
+         * @brief Destroy the Hierarchical Bitmap object
+         *
+         */
+        ~HierarchicalBitmap()
+        {
+            if (m_owned)
+                kfree(m_words);
+            m_words = nullptr;
+        }
+
+        /**
+         * @return size_t
+         */
+        size_t size() const
+        {
+            return m_size;
+        }
+
+        /**
+         * @param index
+         * @return true
+         * @return false
+         */
+        bool get(size_t index) const
+        {
+            ASSERT(index < m_size);
+            return 0 != (m_words[index / 64] & (1ull << (index % 64)));
+        }
+
+        /**
+         * @param index
+         * @param value
+         */
+        void set(size_t index, bool value)
+        {
+            ASSERT(index < m_size);
+            if (value)
+                m_words[index / 64] |= 1ull << (index % 64);
+            else
+                m_words[index / 64] &= ~(1ull << (index % 64));
+            update_summary(index / 64);
+        }
+
+        /**
+         * @param start
+         * @param len
+         * @param value
+         */
+        void set_range(size_t start, size_t len, bool value)
+        {
+            ASSERT(start < m_size);
+            ASSERT(start + len <= m_size);
+
+            while (len) {
+                size_t word_index = start / 64;
+                size_t offset = start % 64;
+                size_t bits = min(len, 64 - offset);
+                u64 mask = bits == 64 ? ~0ull : ((1ull << bits) - 1) << offset;
+                if (value)
+                    m_words[word_index] |= mask;
+                else
+                    m_words[word_index] &= ~mask;
+                update_summary(word_index);
+                start += bits;
+                len -= bits;
+            }
+        }
+
+        /**
+         * @param value
+         */
+        void fill(bool value)
+        {
+            __builtin_memset(m_words, value ? 0xff : 0x00, m_word_count * sizeof(u64));
+            set_tail_bits();
+            for (size_t i = 0; i < m_word_count; ++i)
+                update_summary(i);
+        }
+
+        /**
+         * @param start
+         * @param len
+         * @param value
+         * @return size_t
+         */
+        size_t count_in_range(size_t start, size_t len, bool value) const
+        {
+            ASSERT(start + len <= m_size);
+
+            size_t total = len;
+            size_t count = 0;
+            while (len) {
+                size_t word_index = start / 64;
+                size_t offset = start % 64;
+
+                if (offset == 0 && word_index % 64 == 0 && len >= 4096) {
+                    size_t summary_index = word_index / 64;
+                    if (m_full[summary_index] == ~0ull) {
+                        count += 4096;
+                        start += 4096;
+                        len -= 4096;
+                        continue;
+                    }
+                    if (m_empty[summary_index] == ~0ull) {
+                        start += 4096;
+                        len -= 4096;
+                        continue;
+                    }
+                }
+
+                size_t bits = min(len, 64 - offset);
+                u64 word = m_words[word_index] >> offset;
+                if (bits < 64)
+                    word &= (1ull << bits) - 1;
+                count += __builtin_popcountll(word);
+                start += bits;
+                len -= bits;
+            }
+
+            return value ? count : total - count;
+        }
+
+        /**
+         * @param from
+         * @param min_length
+         * @param max_length
+         * @return Optional<size_t>
+         */
+        Optional<size_t> find_next_range_of_unset_bits(size_t& from, size_t min_length = 1, size_t max_length = max_size) const
+        {
+            if (min_length > max_length)
+                return {};
+
+            size_t bit = from;
+            size_t run_start = 0;
+            size_t run_length = 0;
+
+            while (bit < m_size) {
+                size_t word_index = bit / 64;
+                size_t offset = bit % 64;
+
+                if (offset == 0) {
+                    if (run_length == 0 && is_full_word(word_index)) {
+                        bit = next_word_not_in(m_full, word_index) * 64;
+                        continue;
+                    }
+                    if (is_empty_word(word_index)) {
+                        size_t end_word = next_word_not_in(m_empty, word_index);
+                        if (run_length == 0)
+                            run_start = bit;
+                        size_t end_bit = min(end_word * 64, m_size);
+                        run_length += end_bit - bit;
+                        bit = end_bit;
+                        if (run_length >= max_length) {
+                            from = run_start;
+                            return max_length;
+                        }
+                        continue;
+                    }
+                }
+
+                u64 word = m_words[word_index] >> offset;
+                size_t remaining = 64 - offset;
+                size_t zeros = word == 0 ? remaining : count_trailing_zeroes_64(word);
+                if (zeros) {
+                    if (run_length == 0)
+                        run_start = bit;
+                    run_length += zeros;
+                    bit += zeros;
+                    if (run_length >= max_length) {
+                        from = run_start;
+                        return max_length;
+                    }
+                    continue;
+                }
+
+                if (run_length >= min_length) {
+                    from = run_start;
+                    return min(run_length, max_length);
+                }
+                run_length = 0;
+
+                u64 inverted = ~word;
+                bit += inverted == 0 ? remaining : count_trailing_zeroes_64(inverted);
+            }
+
+            if (run_length >= min_length) {
+                from = run_start;
+                return min(run_length, max_length);
+            }
+            return {};
+        }
+
+        /**
+         * @param minimum_length
+         * @return Optional<size_t>
+         */
+        Optional<size_t> find_first_fit(size_t minimum_length) const
+        {
+            size_t start = 0;
+            auto length_of_found_range = find_next_range_of_unset_bits(start, minimum_length, minimum_length);
+            if (length_of_found_range.has_value())
+                return start;
+            return {};
+        }
+
+        /**
+         * @param minimum_length
+         * @return Optional<size_t>
+         */
+        Optional<size_t> find_best_fit(size_t minimum_length) const
+        {
+            size_t start = 0;
+            size_t best_region_start = 0;
+            size_t best_region_size = max_size;
+            bool found = false;
+
+            while (true) {
+                auto length_of_found_range = find_next_range_of_unset_bits(start, minimum_length);
+                if (!length_of_found_range.has_value())
+                    break;
+                if (best_region_size > length_of_found_range.value() || !found) {
+                    best_region_start = start;
+                    best_region_size = length_of_found_range.value();
+                    found = true;
+                    if (best_region_size == minimum_length)
+                        break;
+                }
+                start += length_of_found_range.value();
+            }
+
+            if (found)
+                return best_region_start;
+            return {};
+        }
+
+        /**
+         * @return Optional<size_t>
+         */
+        Optional<size_t> find_first_set() const
+        {
+            size_t word_index = next_word_not_in(m_empty, 0);
+            if (word_index >= m_word_count)
+                return {};
+            size_t index = word_index * 64 + count_trailing_zeroes_64(m_words[word_index]);
+            if (index >= m_size)
+                return {};
+            return index;
+        }
+
+        /**
+         * @return Optional<size_t>
+         */
+        Optional<size_t> find_first_unset() const
+        {
+            size_t word_index = next_word_not_in(m_full, 0);
+            if (word_index >= m_word_count)
+                return {};
+            return word_index * 64 + count_trailing_zeroes_64(~m_words[word_index]);
+        }
+
+        static constexpr size_t max_size = 0xffffffff;
+
+    private:
+        /**
+         * @param storage
+         * @param size
+         * @param default_value
+         * @param owned
+         */
+        HierarchicalBitmap(u8* storage, size_t size, bool default_value, bool owned)
+            : m_size(size)
+            , m_word_count(words_for(size))
+            , m_summary_count(words_for(m_word_count))
+            , m_owned(owned)
+        {
+            ASSERT(((FlatPtr)storage % alignof(u64)) == 0);
+            m_words = reinterpret_cast<u64*>(storage);
+            m_full = m_words + m_word_count;
+            m_empty = m_full + m_summary_count;
+            __builtin_memset(m_full, 0, 2 * m_summary_count * sizeof(u64));
+            fill(default_value);
+        }
+
+        /**
+         * @param bits
+         * @return size_t
+         */
+        static constexpr size_t words_for(size_t bits)
+        {
+            return (bits + 63) / 64;
+        }
+
+        /**
+         * @param value
+         * @return size_t
+         */
+        ALWAYS_INLINE static size_t count_trailing_zeroes_64(u64 value)
+        {
+            return __builtin_ctzll(value);
+        }
+
+        /// @brief keep the bits past m_size set so they never look free
+        void set_tail_bits()
+        {
+            if (m_size % 64)
+                m_words[m_word_count - 1] |= ~0ull << (m_size % 64);
+        }
+
+        /**
+         * @param word_index
+         */
+        ALWAYS_INLINE void update_summary(size_t word_index)
+        {
+            u64 bit = 1ull << (word_index % 64);
+            u64 word = m_words[word_index];
+            if (word == ~0ull)
+                m_full[word_index / 64] |= bit;
+            else
+                m_full[word_index / 64] &= ~bit;
+            if (word == 0)
+                m_empty[word_index / 64] |= bit;
+            else
+                m_empty[word_index / 64] &= ~bit;
+        }
+
+        /**
+         * @param word_index
+         * @return true
+         * @return false
+         */
+        ALWAYS_INLINE bool is_full_word(size_t word_index) const
+        {
+            return m_full[word_index / 64] & (1ull << (word_index % 64));
+        }
+
+        /**
+         * @param word_index
+         * @return true
+         * @return false
+         */
+        ALWAYS_INLINE bool is_empty_word(size_t word_index) const
+        {
+            return m_empty[word_index / 64] & (1ull << (word_index % 64));
+        }
+
+        /**
+         * @brief first word index >= word_index whose summary bit is clear, or m_word_count
+         *
+         * @param summary
+         * @param word_index
+         * @return size_t
+         */
+        size_t next_word_not_in(const u64* summary, size_t word_index) const
+        {
+            size_t summary_index = word_index / 64;
+            if (summary_index >= m_summary_count)
+                return m_word_count;
+
+            u64 candidates = ~summary[summary_index] & (~0ull << (word_index % 64));
+            while (!candidates) {
+                if (++summary_index >= m_summary_count)
+                    return m_word_count;
+                candidates = ~summary[summary_index];
+            }
+            return min(summary_index * 64 + count_trailing_zeroes_64(candidates), m_word_count);
+        }
+
+        u64* m_words { nullptr };
+        u64* m_full { nullptr };
+        u64* m_empty { nullptr };
+        size_t m_size { 0 };
+        size_t m_word_count { 0 };
+        size_t m_summary_count { 0 };
+        bool m_owned { false };
+    }; // class HierarchicalBitmap
+
+}
+
+using Mods::HierarchicalBitmap;
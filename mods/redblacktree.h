@@ -0,0 +1,752 @@
+/**
+ * @file redblacktree.h
+ * @author Krisna Pranav
+ * @brief red black tree
+ * @version 6.0
+ * @date 2023-09-15
+ *
+ * @copyright Copyright (c) 2021 - 2023 pranaOS Developers, Krisna Pranav
+ *
+ */
+
+#pragma once
+
+#include "assertions.h"
+#include "noncopyable.h"
+#include "stdlibextra.h"
+#include "types.h"
+
+namespace Mods
+{
+
+    struct RedBlackTreeNoAugment
+    {
+        static constexpr bool is_augmented = false;
+
+        struct Data
+        {
+        };
+
+        /**
+         * @tparam Node
+         */
+        template<typename Node>
+        static void recompute(Node&)
+        {
+        }
+    }; // struct RedBlackTreeNoAugment
+
+    /**
+     * @brief ordered map with O(log n) insert, remove and floor/ceiling lookups.
+     *        An Augment policy may keep per-subtree data in every node: recompute(node) is
+     *        called whenever the children of node, or their data, might have changed, always
+     *        bottom-up, so it only has to combine node with its two children.
+     *
+     * @tparam K
+     * @tparam V
+     * @tparam Augment
+     */
+    template<typename K, typename V, typename Augment = RedBlackTreeNoAugment>
+    class RedBlackTree
+    {
+        MOD_MAKE_NONCOPYABLE(RedBlackTree);
+
+    public:
+        struct Node
+        {
+            /**
+             * @param key
+             * @param value
+             */
+            Node(K key, V&& value)
+                : key(move(key))
+                , value(move(value))
+            {
+            }
+
+            K key;
+            V value;
+            Node* parent { nullptr };
+            Node* left { nullptr };
+            Node* right { nullptr };
+            bool is_red { true };
+            typename Augment::Data augment {};
+        }; // struct Node
+
+        RedBlackTree() = default;
+
+        /**
+         * @param other
+         */
+        RedBlackTree(RedBlackTree&& other)
+            : m_root(exchange(other.m_root, nullptr))
+            , m_size(exchange(other.m_size, 0))
+        {
+        }
+
+        /**
+         * @param other
+         * @return RedBlackTree&
+         */
+        RedBlackTree& operator=(RedBlackTree&& other)
+        {
+            if (this != &other) {
+                clear();
+                m_root = exchange(other.m_root, nullptr);
+                m_size = exchange(other.m_size, 0);
+            }
+            return *this;
+        }
+
+        ~RedBlackTree()
+        {
+            clear();
+        }
+
+        /**
+         * @return size_t
+         */
+        size_t size() const
+        {
+            return m_size;
+        }
+
+        /**
+         * @return true
+         * @return false
+         */
+        bool is_empty() const
+        {
+            return m_size == 0;
+        }
+
+        /**
+         * @brief for augmented descents
+         *
+         * @return Node*
+         */
+        Node* root() const
+        {
+            return m_root;
+        }
+
+        /**
+         * @param key
+         * @return V*
+         */
+        V* find(const K& key)
+        {
+            auto* node = find_node(key);
+            return node ? &node->value : nullptr;
+        }
+
+        /**
+         * @param key
+         * @return const V*
+         */
+        const V* find(const K& key) const
+        {
+            return const_cast<RedBlackTree*>(this)->find(key);
+        }
+
+        /**
+         * @brief the value with the greatest key <= key
+         *
+         * @param key
+         * @return V*
+         */
+        V* find_largest_not_above(const K& key)
+        {
+            auto* node = largest_not_above_node(key);
+            return node ? &node->value : nullptr;
+        }
+
+        /**
+         * @param key
+         * @return const V*
+         */
+        const V* find_largest_not_above(const K& key) const
+        {
+            return const_cast<RedBlackTree*>(this)->find_largest_not_above(key);
+        }
+
+        /**
+         * @brief the value with the smallest key >= key
+         *
+         * @param key
+         * @return V*
+         */
+        V* find_smallest_not_below(const K& key)
+        {
+            auto* node = smallest_not_below_node(key);
+            return node ? &node->value : nullptr;
+        }
+
+        /**
+         * @param key
+         * @return const V*
+         */
+        const V* find_smallest_not_below(const K& key) const
+        {
+            return const_cast<RedBlackTree*>(this)->find_smallest_not_below(key);
+        }
+
+        /**
+         * @param key
+         * @return Node*
+         */
+        Node* find_node(const K& key) const
+        {
+            auto* node = m_root;
+            while (node) {
+                if (key < node->key)
+                    node = node->left;
+                else if (node->key < key)
+                    node = node->right;
+                else
+                    return node;
+            }
+            return nullptr;
+        }
+
+        /**
+         * @param key
+         * @return Node*
+         */
+        Node* largest_not_above_node(const K& key) const
+        {
+            Node* candidate = nullptr;
+            auto* node = m_root;
+            while (node) {
+                if (key < node->key) {
+                    node = node->left;
+                } else {
+                    candidate = node;
+                    node = node->right;
+                }
+            }
+            return candidate;
+        }
+
+        /**
+         * @param key
+         * @return Node*
+         */
+        Node* smallest_not_below_node(const K& key) const
+        {
+            Node* candidate = nullptr;
+            auto* node = m_root;
+            while (node) {
+                if (node->key < key) {
+                    node = node->right;
+                } else {
+                    candidate = node;
+                    node = node->left;
+                }
+            }
+            return candidate;
+        }
+
+        /**
+         * @brief keys must be unique
+         *
+         * @param key
+         * @param value
+         * @return V&
+         */
+        V& insert(K key, V&& value)
+        {
+            Node* parent = nullptr;
+            Node** link = &m_root;
+            while (*link) {
+                parent = *link;
+                ASSERT(key < parent->key || parent->key < key);
+                link = key < parent->key ? &parent->left : &parent->right;
+            }
+
+            auto* node = new Node(move(key), move(value));
+            node->parent = parent;
+            *link = node;
+            m_size++;
+
+            propagate_up(node);
+            insert_fixup(node);
+            return node->value;
+        }
+
+        /**
+         * @brief refresh augmented data after node->value was changed in place, the key must not change
+         *
+         * @param node
+         */
+        void value_did_change(Node* node)
+        {
+            propagate_up(node);
+        }
+
+        /**
+         * @param key
+         * @return true
+         * @return false
+         */
+        bool remove(const K& key)
+        {
+            auto* node = find_node(key);
+            if (!node)
+                return false;
+            remove_node(node);
+            delete node;
+            return true;
+        }
+
+        /**
+         * @brief unlink the entry for key and hand its value back, the key must exist
+         *
+         * @param key
+         * @return V
+         */
+        V take(const K& key)
+        {
+            auto* node = find_node(key);
+            ASSERT(node);
+            remove_node(node);
+            V value = move(node->value);
+            delete node;
+            return value;
+        }
+
+        void clear()
+        {
+            auto* node = m_root;
+            while (node) {
+                if (node->left) {
+                    node = node->left;
+                    continue;
+                }
+                if (node->right) {
+                    node = node->right;
+                    continue;
+                }
+                auto* parent = node->parent;
+                if (parent) {
+                    if (parent->left == node)
+                        parent->left = nullptr;
+                    else
+                        parent->right = nullptr;
+                }
+                delete node;
+                node = parent;
+            }
+            m_root = nullptr;
+            m_size = 0;
+        }
+
+        /**
+         * @param node
+         * @return Node*
+         */
+        static Node* successor(Node* node)
+        {
+            if (node->right) {
+                node = node->right;
+                while (node->left)
+                    node = node->left;
+                return node;
+            }
+            auto* parent = node->parent;
+            while (parent && node == parent->right) {
+                node = parent;
+                parent = parent->parent;
+            }
+            return parent;
+        }
+
+        /**
+         * @param node
+         * @return Node*
+         */
+        static Node* predecessor(Node* node)
+        {
+            if (node->left) {
+                node = node->left;
+                while (node->right)
+                    node = node->right;
+                return node;
+            }
+            auto* parent = node->parent;
+            while (parent && node == parent->left) {
+                node = parent;
+                parent = parent->parent;
+            }
+            return parent;
+        }
+
+        /**
+         * @return Node*
+         */
+        Node* first_node() const
+        {
+            auto* node = m_root;
+            while (node && node->left)
+                node = node->left;
+            return node;
+        }
+
+        /**
+         * @tparam ValueType
+         */
+        template<typename ValueType>
+        class IteratorBase
+        {
+        public:
+            /**
+             * @param node
+             */
+            explicit IteratorBase(Node* node)
+                : m_node(node)
+            {
+            }
+
+            /**
+             * @param other
+             * @return true
+             * @return false
+             */
+            bool operator!=(const IteratorBase& other) const
+            {
+                return m_node != other.m_node;
+            }
+
+            /**
+             * @param other
+             * @return true
+             * @return false
+             */
+            bool operator==(const IteratorBase& other) const
+            {
+                return m_node == other.m_node;
+            }
+
+            /**
+             * @return IteratorBase&
+             */
+            IteratorBase& operator++()
+            {
+                m_node = successor(m_node);
+                return *this;
+            }
+
+            /**
+             * @return ValueType&
+             */
+            ValueType& operator*()
+            {
+                return m_node->value;
+            }
+
+            /**
+             * @return ValueType*
+             */
+            ValueType* operator->()
+            {
+                return &m_node->value;
+            }
+
+            /**
+             * @return const K&
+             */
+            const K& key() const
+            {
+                return m_node->key;
+            }
+
+            /**
+             * @return true
+             * @return false
+             */
+            bool is_end() const
+            {
+                return !m_node;
+            }
+
+        private:
+            Node* m_node { nullptr };
+        }; // class IteratorBase
+
+        using Iterator = IteratorBase<V>;
+        using ConstIterator = IteratorBase<const V>;
+
+        /**
+         * @return Iterator
+         */
+        Iterator begin()
+        {
+            return Iterator(first_node());
+        }
+
+        /**
+         * @return Iterator
+         */
+        Iterator end()
+        {
+            return Iterator(nullptr);
+        }
+
+        /**
+         * @return ConstIterator
+         */
+        ConstIterator begin() const
+        {
+            return ConstIterator(first_node());
+        }
+
+        /**
+         * @return ConstIterator
+         */
+        ConstIterator end() const
+        {
+            return ConstIterator(nullptr);
+        }
+
+    private:
+        /**
+         * @param node
+         */
+        static void propagate_up(Node* node)
+        {
+            if constexpr (Augment::is_augmented) {
+                for (; node; node = node->parent)
+                    Augment::recompute(*node);
+            }
+        }
+
+        /**
+         * @param node
+         * @return true
+         * @return false
+         */
+        static bool is_red(Node* node)
+        {
+            return node && node->is_red;
+        }
+
+        /**
+         * @param x
+         */
+        void rotate_left(Node* x)
+        {
+            auto* y = x->right;
+            x->right = y->left;
+            if (y->left)
+                y->left->parent = x;
+            replace_in_parent(x, y);
+            y->left = x;
+            x->parent = y;
+
+            if constexpr (Augment::is_augmented) {
+                Augment::recompute(*x);
+                Augment::recompute(*y);
+            }
+        }
+
+        /**
+         * @param x
+         */
+        void rotate_right(Node* x)
+        {
+            auto* y = x->left;
+            x->left = y->right;
+            if (y->right)
+                y->right->parent = x;
+            replace_in_parent(x, y);
+            y->right = x;
+            x->parent = y;
+
+            if constexpr (Augment::is_augmented) {
+                Augment::recompute(*x);
+                Augment::recompute(*y);
+            }
+        }
+
+        /**
+         * @brief put replacement where node hangs off its parent
+         *
+         * @param node
+         * @param replacement
+         */
+        void replace_in_parent(Node* node, Node* replacement)
+        {
+            auto* parent = node->parent;
+            if (replacement)
+                replacement->parent = parent;
+            if (!parent)
+                m_root = replacement;
+            else if (parent->left == node)
+                parent->left = replacement;
+            else
+                parent->right = replacement;
+        }
+
+        /**
+         * @param node
+         */
+        void insert_fixup(Node* node)
+        {
+            while (is_red(node->parent)) {
+                auto* parent = node->parent;
+                auto* grandparent = parent->parent;
+                if (parent == grandparent->left) {
+                    auto* uncle = grandparent->right;
+                    if (is_red(uncle)) {
+                        parent->is_red = false;
+                        uncle->is_red = false;
+                        grandparent->is_red = true;
+                        node = grandparent;
+                        continue;
+                    }
+                    if (node == parent->right) {
+                        rotate_left(parent);
+                        node = parent;
+                        parent = node->parent;
+                    }
+                    parent->is_red = false;
+                    grandparent->is_red = true;
+                    rotate_right(grandparent);
+                } else {
+                    auto* uncle = grandparent->left;
+                    if (is_red(uncle)) {
+                        parent->is_red = false;
+                        uncle->is_red = false;
+                        grandparent->is_red = true;
+                        node = grandparent;
+                        continue;
+                    }
+                    if (node == parent->left) {
+                        rotate_right(parent);
+                        node = parent;
+                        parent = node->parent;
+                    }
+                    parent->is_red = false;
+                    grandparent->is_red = true;
+                    rotate_left(grandparent);
+                }
+            }
+            m_root->is_red = false;
+        }
+
+        /**
+         * @param node
+         */
+        void remove_node(Node* node)
+        {
+            Node* child;
+            Node* child_parent;
+            bool removed_red;
+
+            if (!node->left || !node->right) {
+                child = node->left ? node->left : node->right;
+                child_parent = node->parent;
+                removed_red = node->is_red;
+                replace_in_parent(node, child);
+            } else {
+                auto* next = node->right;
+                while (next->left)
+                    next = next->left;
+
+                removed_red = next->is_red;
+                child = next->right;
+                if (next->parent == node) {
+                    child_parent = next;
+                } else {
+                    child_parent = next->parent;
+                    replace_in_parent(next, child);
+                    next->right = node->right;
+                    next->right->parent = next;
+                }
+                replace_in_parent(node, next);
+                next->left = node->left;
+                next->left->parent = next;
+                next->is_red = node->is_red;
+            }
+
+            m_size--;
+            propagate_up(child_parent);
+            if (!removed_red)
+                remove_fixup(child, child_parent);
+        }
+
+        /**
+         * @param node
+         * @param parent
+         */
+        void remove_fixup(Node* node, Node* parent)
+        {
+            while (node != m_root && !is_red(node)) {
+                if (node == parent->left) {
+                    auto* sibling = parent->right;
+                    if (is_red(sibling)) {
+                        sibling->is_red = false;
+                        parent->is_red = true;
+                        rotate_left(parent);
+                        sibling = parent->right;
+                    }
+                    if (!is_red(sibling->left) && !is_red(sibling->right)) {
+                        sibling->is_red = true;
+                        node = parent;
+                        parent = node->parent;
+                        continue;
+                    }
+                    if (!is_red(sibling->right)) {
+                        sibling->left->is_red = false;
+                        sibling->is_red = true;
+                        rotate_right(sibling);
+                        sibling = parent->right;
+                    }
+                    sibling->is_red = parent->is_red;
+                    parent->is_red = false;
+                    sibling->right->is_red = false;
+                    rotate_left(parent);
+                    propagate_up(parent->parent);
+                    node = m_root;
+                    break;
+                } else {
+                    auto* sibling = parent->left;
+                    if (is_red(sibling)) {
+                        sibling->is_red = false;
+                        parent->is_red = true;
+                        rotate_right(parent);
+                        sibling = parent->left;
+                    }
+                    if (!is_red(sibling->left) && !is_red(sibling->right)) {
+                        sibling->is_red = true;
+                        node = parent;
+                        parent = node->parent;
+                        continue;
+                    }
+                    if (!is_red(sibling->left)) {
+                        sibling->right->is_red = false;
+                        sibling->is_red = true;
+                        rotate_left(sibling);
+                        sibling = parent->left;
+                    }
+                    sibling->is_red = parent->is_red;
+                    parent->is_red = false;
+                    sibling->left->is_red = false;
+                    rotate_right(parent);
+                    propagate_up(parent->parent);
+                    node = m_root;
+                    break;
+                }
+            }
+            if (node)
+                node->is_red = false;
+        }
+
+        Node* m_root { nullptr };
+        size_t m_size { 0 };
+    }; // class RedBlackTree
+
+} // namespace Mods
+
+using Mods::RedBlackTree;
+using Mods::RedBlackTreeNoAugment;
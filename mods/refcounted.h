@@ -77,6 +77,24 @@ namespace Mods {
             ASSERT(!Checked<RefCountType>::addition_would_overflow(old_ref_count, 1));
         }
 
+        /**
+         * @brief ref unless the count already dropped to zero, for references found through
+         *        a pointer that does not own one, like a weak link or a lookup table
+         *
+         * @return true
+         * @return false
+         */
+        [[nodiscard]] ALWAYS_INLINE bool try_ref() const {
+            auto expected = m_ref_count.load(Mods::MemoryOrder::memory_order_relaxed);
+            for (;;) {
+                if (expected == 0)
+                    return false;
+                ASSERT(!Checked<RefCountType>::addition_would_overflow(expected, 1));
+                if (m_ref_count.compare_exchange_strong(expected, expected + 1, Mods::MemoryOrder::memory_order_acquire))
+                    return true;
+            }
+        }
+
         /**
          * @brief ref_count
          * 
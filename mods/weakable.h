@@ -53,8 +53,9 @@ namespace Mods
     #endif
                 FlatPtr bits = RefPtrTraits<void>::lock(m_bits);
                 T* ptr = static_cast<T*>(RefPtrTraits<void>::as_ptr(bits));
-                if (ptr)
-                    ref = *ptr;
+                // the last reference may be gone while the destructor has not revoked us yet
+                if (ptr && ptr->try_ref())
+                    ref = RefPtr<T, PtrTraits>(RefPtr<T, PtrTraits>::Adopt, *ptr);
                 RefPtrTraits<void>::unlock(m_bits, bits);
             }
 
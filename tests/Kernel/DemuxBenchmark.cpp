@@ -0,0 +1,127 @@
+//
+//  DemuxBenchmark.cpp
+//  pranaOS
+//
+//  Created by Krisna Pranav on 26/09/23.
+//
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// ping-pongs one byte between two connected udp sockets on loopback while more and
+// more idle connected sockets are open next to them. Every connected udp socket sits
+// in the established demux table, so the round trip time only stays flat if looking
+// a datagram's socket up there doesn't grow with the number of connections
+
+static constexpr int wanted_connections = 10000;
+static constexpr int steps[] = { 1, 100, 1000, wanted_connections };
+static constexpr int round_trips = 20000;
+static constexpr int receive_timeout_ms = 1000;
+
+static double now_us()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void fail(const char* what)
+{
+    perror(what);
+    exit(1);
+}
+
+static int bound_socket(sockaddr_in& address)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+        fail("socket");
+
+    address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = 0;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (const sockaddr*)&address, sizeof(address)) < 0)
+        fail("bind");
+
+    socklen_t address_length = sizeof(address);
+    if (getsockname(fd, (sockaddr*)&address, &address_length) < 0)
+        fail("getsockname");
+    return fd;
+}
+
+static void connect_to(int fd, const sockaddr_in& peer)
+{
+    if (connect(fd, (const sockaddr*)&peer, sizeof(peer)) < 0)
+        fail("connect");
+}
+
+static void receive_byte(int fd, char& byte)
+{
+    pollfd fds { fd, POLLIN, 0 };
+    int ready = poll(&fds, 1, receive_timeout_ms);
+    if (ready < 0)
+        fail("poll");
+    if (ready == 0) {
+        fprintf(stderr, "datagram lost, nothing arrived within %d ms\n", receive_timeout_ms);
+        exit(1);
+    }
+    if (recv(fd, &byte, 1, 0) != 1)
+        fail("recv");
+}
+
+static double measure(int a, int b)
+{
+    char byte = 'x';
+    double start = now_us();
+    for (int i = 0; i < round_trips; ++i) {
+        if (send(a, &byte, 1, 0) != 1)
+            fail("ping");
+        receive_byte(b, byte);
+        if (send(b, &byte, 1, 0) != 1)
+            fail("pong");
+        receive_byte(a, byte);
+    }
+    return (now_us() - start) / round_trips;
+}
+
+int main()
+{
+    // one descriptor per connection, plus the measured pair and stdio
+    long open_max = sysconf(_SC_OPEN_MAX);
+    int max_connections = wanted_connections;
+    if (open_max > 0 && open_max - 16 < max_connections)
+        max_connections = (int)(open_max - 16);
+
+    sockaddr_in a_address, b_address;
+    int a = bound_socket(a_address);
+    int b = bound_socket(b_address);
+    connect_to(a, b_address);
+    connect_to(b, a_address);
+
+    // warm up before the first step
+    (void)measure(a, b);
+
+    int open_connections = 1;
+    printf("%-12s %14s\n", "connections", "round trip us");
+    for (int step : steps) {
+        if (step > max_connections)
+            step = max_connections;
+        while (open_connections < step) {
+            sockaddr_in idle_address;
+            int idle = bound_socket(idle_address);
+            connect_to(idle, b_address);
+            ++open_connections;
+        }
+        printf("%-12d %14.2f\n", open_connections, measure(a, b));
+        if (step == max_connections)
+            break;
+    }
+    return 0;
+}
@@ -0,0 +1,151 @@
+//
+//  EpollBenchmark.cpp
+//  pranaOS
+//
+//  Created by Krisna Pranav on 22/09/23.
+//
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+
+// many idle pipes and a few busy ones: every round writes a byte into each busy
+// pipe, then finds and drains them once with poll() over everything and once
+// with epoll_wait(), which only ever looks at the pipes that got data
+
+static constexpr int wanted_idle = 10000;
+static constexpr int wanted_active = 100;
+static constexpr int rounds = 1000;
+
+struct Pair {
+    int watched;
+    int peer;
+};
+
+static double now_us()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static bool make_pair(Pair& pair)
+{
+    int fds[2];
+    if (pipe(fds) < 0)
+        return false;
+    pair = { fds[0], fds[1] };
+    return true;
+}
+
+static void poke(Pair* pairs, int active)
+{
+    char byte = 'x';
+    for (int i = 0; i < active; ++i) {
+        if (write(pairs[i].peer, &byte, 1) != 1) {
+            perror("write");
+            exit(1);
+        }
+    }
+}
+
+int main()
+{
+    // two descriptors per pipe, plus a few for stdio and the event poll. Under a small
+    // _SC_OPEN_MAX both sets shrink, keeping most pipes idle so the comparison still means something
+    int idle = wanted_idle;
+    int active = wanted_active;
+    long open_max = sysconf(_SC_OPEN_MAX);
+    if (open_max > 0) {
+        int available = (int)((open_max - 16) / 2);
+        if (available < 2) {
+            fprintf(stderr, "_SC_OPEN_MAX %ld is too small\n", open_max);
+            return 1;
+        }
+        if (idle + active > available) {
+            active = available / 8 > 0 ? available / 8 : 1;
+            if (active > wanted_active)
+                active = wanted_active;
+            idle = available - active;
+        }
+    }
+
+    int total = idle + active;
+    auto* pairs = new Pair[total];
+    for (int i = 0; i < total; ++i) {
+        if (!make_pair(pairs[i])) {
+            perror("pipe");
+            return 1;
+        }
+    }
+
+    // active pipes last, so poll() has to walk past every idle one to reach them
+    Pair* busy = pairs + idle;
+
+    auto* pollfds = new pollfd[total];
+    for (int i = 0; i < total; ++i)
+        pollfds[i] = { pairs[i].watched, POLLIN, 0 };
+
+    char buffer[16];
+    double start = now_us();
+    for (int round = 0; round < rounds; ++round) {
+        poke(busy, active);
+        int drained = 0;
+        while (drained < active) {
+            int ready = poll(pollfds, total, -1);
+            if (ready < 0) {
+                perror("poll");
+                return 1;
+            }
+            for (int i = 0; i < total; ++i) {
+                if (pollfds[i].revents & POLLIN) {
+                    (void)read(pollfds[i].fd, buffer, sizeof(buffer));
+                    ++drained;
+                }
+            }
+        }
+    }
+    double poll_us = (now_us() - start) / rounds;
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        perror("epoll_create1");
+        return 1;
+    }
+    for (int i = 0; i < total; ++i) {
+        epoll_event event {};
+        event.events = EPOLLIN;
+        event.data.fd = pairs[i].watched;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, pairs[i].watched, &event) < 0) {
+            perror("epoll_ctl");
+            return 1;
+        }
+    }
+
+    epoll_event events[wanted_active];
+    start = now_us();
+    for (int round = 0; round < rounds; ++round) {
+        poke(busy, active);
+        int drained = 0;
+        while (drained < active) {
+            int ready = epoll_wait(epfd, events, active, -1);
+            if (ready < 0) {
+                perror("epoll_wait");
+                return 1;
+            }
+            for (int i = 0; i < ready; ++i) {
+                (void)read(events[i].data.fd, buffer, sizeof(buffer));
+                ++drained;
+            }
+        }
+    }
+    double epoll_us = (now_us() - start) / rounds;
+
+    printf("%d idle + %d active pipes, %d rounds\n", idle, active, rounds);
+    printf("poll        %10.1f us/round\n", poll_us);
+    printf("epoll_wait  %10.1f us/round\n", epoll_us);
+    return 0;
+}
@@ -0,0 +1,161 @@
+//
+//  LoopbackBenchmark.cpp
+//  pranaOS
+//
+//  Created by Krisna Pranav on 25/09/23.
+//
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// a child floods small udp datagrams at a socket on 127.0.0.1 while the parent drains
+// it, so NetworkTask keeps finding frames queued and polls them in batches. Reports the
+// datagrams that made it through per second and the cpu time both processes spent per
+// datagram; kernel threads doing the receive work are not charged to either. Then one
+// datagram at a time is bounced back and forth, where every frame finds the task idle
+// and has to wake it, for the latency of the notification path
+
+static constexpr int datagrams = 200000;
+static constexpr size_t datagram_size = 64;
+static constexpr int idle_timeout_ms = 500;
+static constexpr int round_trips = 10000;
+
+static double now_us()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static double cpu_us(int who)
+{
+    rusage usage;
+    getrusage(who, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e6 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+static bool receive_one(int fd, char* buffer)
+{
+    pollfd fds { fd, POLLIN, 0 };
+    int ready = poll(&fds, 1, idle_timeout_ms);
+    if (ready < 0) {
+        perror("poll");
+        exit(1);
+    }
+    return ready > 0 && recv(fd, buffer, datagram_size, 0) > 0;
+}
+
+static double measure_round_trips(int receiver, const sockaddr_in& receiver_address)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0 || connect(fd, (const sockaddr*)&receiver_address, sizeof(receiver_address)) < 0) {
+        perror("connect");
+        exit(1);
+    }
+
+    sockaddr_in sender_address {};
+    socklen_t address_length = sizeof(sender_address);
+    char buffer[datagram_size] {};
+    if (send(fd, buffer, sizeof(buffer), 0) < 0 || !receive_one(receiver, buffer)) {
+        fprintf(stderr, "nothing arrives over loopback\n");
+        exit(1);
+    }
+    getsockname(fd, (sockaddr*)&sender_address, &address_length);
+
+    double start = now_us();
+    for (int i = 0; i < round_trips; ++i) {
+        if (send(fd, buffer, sizeof(buffer), 0) < 0 || !receive_one(receiver, buffer)
+            || sendto(receiver, buffer, sizeof(buffer), 0, (const sockaddr*)&sender_address, sizeof(sender_address)) < 0
+            || !receive_one(fd, buffer)) {
+            fprintf(stderr, "round trip %d lost a datagram\n", i);
+            exit(1);
+        }
+    }
+    double elapsed_us = now_us() - start;
+
+    close(fd);
+    return elapsed_us / round_trips;
+}
+
+int main()
+{
+    int receiver = socket(AF_INET, SOCK_DGRAM, 0);
+    if (receiver < 0) {
+        perror("socket");
+        return 1;
+    }
+
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_port = 0;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(receiver, (const sockaddr*)&address, sizeof(address)) < 0) {
+        perror("bind");
+        return 1;
+    }
+
+    socklen_t address_length = sizeof(address);
+    if (getsockname(receiver, (sockaddr*)&address, &address_length) < 0) {
+        perror("getsockname");
+        return 1;
+    }
+
+    double cpu_start = cpu_us(RUSAGE_SELF);
+    double start = now_us();
+
+    pid_t sender = fork();
+    if (sender < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (sender == 0) {
+        int fd = socket(AF_INET, SOCK_DGRAM, 0);
+        char payload[datagram_size];
+        memset(payload, 'x', sizeof(payload));
+        for (int i = 0; i < datagrams; ++i)
+            (void)sendto(fd, payload, sizeof(payload), 0, (const sockaddr*)&address, sizeof(address));
+        _exit(0);
+    }
+
+    char buffer[datagram_size];
+    int received = 0;
+    double last_receive = start;
+    pollfd fds { receiver, POLLIN, 0 };
+    while (received < datagrams) {
+        int ready = poll(&fds, 1, idle_timeout_ms);
+        if (ready < 0) {
+            perror("poll");
+            return 1;
+        }
+        if (ready == 0)
+            break;
+        if (recv(receiver, buffer, sizeof(buffer), 0) > 0) {
+            ++received;
+            last_receive = now_us();
+        }
+    }
+
+    waitpid(sender, nullptr, 0);
+    double elapsed_us = last_receive - start;
+    double cpu_total_us = cpu_us(RUSAGE_SELF) - cpu_start + cpu_us(RUSAGE_CHILDREN);
+
+    if (!received) {
+        fprintf(stderr, "no datagram was received\n");
+        return 1;
+    }
+
+    printf("%d x %zu byte datagrams over loopback, %d received\n", datagrams, datagram_size, received);
+    printf("throughput  %10.0f packets/s\n", received / (elapsed_us / 1e6));
+    printf("cpu         %10.2f us/packet\n", cpu_total_us / received);
+    printf("round trip  %10.2f us\n", measure_round_trips(receiver, address));
+    return 0;
+}
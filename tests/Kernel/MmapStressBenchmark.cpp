@@ -0,0 +1,82 @@
+//
+//  MmapStressBenchmark.cpp
+//  pranaOS
+//
+//  Created by Krisna Pranav on 16/09/23.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <time.h>
+
+// keeps a pool of live mappings of mixed sizes and replaces a random one every
+// cycle, so the address space stays fragmented and every mmap has to search
+// the RangeAllocator's free ranges and every munmap has to coalesce
+
+static constexpr size_t page_size = 4096;
+static constexpr int cycles = 100000;
+static constexpr size_t max_live = 8192;
+
+struct Mapping {
+    void* address;
+    size_t size;
+};
+
+static double now_us()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static bool map_one(Mapping& mapping)
+{
+    mapping.size = (1 + rand() % 16) * page_size;
+    mapping.address = mmap(nullptr, mapping.size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (mapping.address == MAP_FAILED) {
+        perror("mmap");
+        return false;
+    }
+    return true;
+}
+
+static bool unmap_one(Mapping& mapping)
+{
+    if (munmap(mapping.address, mapping.size) < 0) {
+        perror("munmap");
+        return false;
+    }
+    return true;
+}
+
+static Mapping s_live[max_live];
+
+int main()
+{
+    printf("live mappings   ns/cycle (mmap + munmap)\n");
+
+    for (size_t live = 64; live <= max_live; live *= 2) {
+        srand(live);
+        for (size_t i = 0; i < live; ++i) {
+            if (!map_one(s_live[i]))
+                return 1;
+        }
+
+        double start = now_us();
+        for (int i = 0; i < cycles; ++i) {
+            auto& victim = s_live[rand() % live];
+            if (!unmap_one(victim) || !map_one(victim))
+                return 1;
+        }
+        double elapsed = now_us() - start;
+
+        for (size_t i = 0; i < live; ++i) {
+            if (!unmap_one(s_live[i]))
+                return 1;
+        }
+
+        printf("%13zu   %10.1f\n", live, elapsed * 1000 / cycles);
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+//
+//  OpenStatBenchmark.cpp
+//  pranaOS
+//
+//  Created by Krisna Pranav on 14/09/23.
+//
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// every thread resolves the same paths, so each path component meets the
+// others on the VFS mount table lock, which resolve_path takes Shared
+
+static constexpr int max_threads = 8;
+static constexpr double run_seconds = 2.0;
+
+static const char* s_paths[] = {
+    "/etc/passwd",
+    "/usr/lib",
+    "/bin/sh",
+    "/dev/null",
+};
+
+static constexpr size_t path_count = sizeof(s_paths) / sizeof(s_paths[0]);
+
+static volatile bool s_stop;
+
+struct Worker {
+    pthread_t thread;
+    unsigned long operations { 0 };
+    unsigned long failures { 0 };
+};
+
+static double now_seconds()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void* worker_main(void* argument)
+{
+    auto& worker = *static_cast<Worker*>(argument);
+    struct stat st;
+
+    for (size_t i = 0; !s_stop; ++i) {
+        const char* path = s_paths[i % path_count];
+
+        if (stat(path, &st) < 0)
+            worker.failures++;
+
+        int fd = open(path, O_RDONLY);
+        if (fd < 0)
+            worker.failures++;
+        else
+            close(fd);
+
+        worker.operations += 2;
+    }
+    return nullptr;
+}
+
+static double run(int thread_count, unsigned long& failures)
+{
+    Worker workers[max_threads];
+    s_stop = false;
+
+    double start = now_seconds();
+    for (int i = 0; i < thread_count; ++i)
+        pthread_create(&workers[i].thread, nullptr, worker_main, &workers[i]);
+
+    usleep(run_seconds * 1000000);
+    s_stop = true;
+
+    unsigned long operations = 0;
+    for (int i = 0; i < thread_count; ++i) {
+        pthread_join(workers[i].thread, nullptr);
+        operations += workers[i].operations;
+        failures += workers[i].failures;
+    }
+
+    return operations / (now_seconds() - start);
+}
+
+int main()
+{
+    printf("threads  ops/s        per-thread   scaling\n");
+
+    double baseline = 0;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        unsigned long failures = 0;
+        double rate = run(threads, failures);
+        if (threads == 1)
+            baseline = rate;
+
+        printf("%7d  %11.0f  %11.0f  %6.2fx", threads, rate, rate / threads, rate / baseline);
+        if (failures)
+            printf("  (%lu failed lookups)", failures);
+        printf("\n");
+    }
+    return 0;
+}
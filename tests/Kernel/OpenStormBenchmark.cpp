@@ -0,0 +1,110 @@
+//
+//  OpenStormBenchmark.cpp
+//  pranaOS
+//
+//  Created by Krisna Pranav on 19/09/23.
+//
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// builds a deep directory chain and opens a file at the bottom of it over and
+// over, then does the same for a name that doesn't exist, so every component is
+// resolved through the dentry cache and the last one hits a negative entry
+
+static constexpr int depth = 16;
+static constexpr int iterations = 100000;
+static constexpr const char* root = "/tmp/openstorm";
+
+static char s_existing[1024];
+static char s_missing[1024];
+
+static double now_us()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static bool build_tree()
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s", root);
+    if (mkdir(path, 0755) < 0 && errno != EEXIST) {
+        perror("mkdir");
+        return false;
+    }
+
+    for (int i = 0; i < depth; ++i) {
+        size_t length = strlen(path);
+        snprintf(path + length, sizeof(path) - length, "/level%d", i);
+        if (mkdir(path, 0755) < 0 && errno != EEXIST) {
+            perror("mkdir");
+            return false;
+        }
+    }
+
+    snprintf(s_existing, sizeof(s_existing), "%s/file", path);
+    snprintf(s_missing, sizeof(s_missing), "%s/missing", path);
+
+    int fd = open(s_existing, O_CREAT | O_WRONLY, 0644);
+    if (fd < 0) {
+        perror("open");
+        return false;
+    }
+    close(fd);
+    return true;
+}
+
+static void print_cache_statistics()
+{
+    int fd = open("/proc/dentrycache", O_RDONLY);
+    if (fd < 0)
+        return;
+
+    char buffer[512];
+    ssize_t nread = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (nread <= 0)
+        return;
+
+    buffer[nread] = '\0';
+    printf("dentry cache: %s\n", buffer);
+}
+
+int main()
+{
+    if (!build_tree())
+        return 1;
+
+    double start = now_us();
+    for (int i = 0; i < iterations; ++i) {
+        int fd = open(s_existing, O_RDONLY);
+        if (fd < 0) {
+            perror("open");
+            return 1;
+        }
+        close(fd);
+    }
+    double existing_ns = (now_us() - start) * 1000 / iterations;
+
+    start = now_us();
+    for (int i = 0; i < iterations; ++i) {
+        if (open(s_missing, O_RDONLY) >= 0 || errno != ENOENT) {
+            printf("%s should not exist\n", s_missing);
+            return 1;
+        }
+    }
+    double missing_ns = (now_us() - start) * 1000 / iterations;
+
+    printf("depth %d, %d opens each\n", depth, iterations);
+    printf("existing file   %10.1f ns/open\n", existing_ns);
+    printf("missing file    %10.1f ns/open\n", missing_ns);
+    print_cache_statistics();
+    return 0;
+}
@@ -0,0 +1,127 @@
+//
+//  SendfileBenchmark.cpp
+//  pranaOS
+//
+//  Created by Krisna Pranav on 23/09/23.
+//
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// streams one file into a pipe a few times over, once bouncing every chunk through a
+// user buffer with read() + write() and once with sendfile(), while a child drains the
+// other end of the pipe
+
+static constexpr size_t file_size = 16 * 1024 * 1024;
+static constexpr size_t chunk_size = 64 * 1024;
+static constexpr int passes = 8;
+
+static double now_us()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static pid_t start_drain(int read_fd, int write_fd)
+{
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        exit(1);
+    }
+    if (pid == 0) {
+        close(write_fd);
+        static char sink[chunk_size];
+        while (read(read_fd, sink, sizeof(sink)) > 0)
+            ;
+        _exit(0);
+    }
+    close(read_fd);
+    return pid;
+}
+
+static double run(int file_fd, bool use_sendfile)
+{
+    int fds[2];
+    if (pipe(fds) < 0) {
+        perror("pipe");
+        exit(1);
+    }
+    pid_t drain = start_drain(fds[0], fds[1]);
+
+    static char buffer[chunk_size];
+    double start = now_us();
+    for (int pass = 0; pass < passes; ++pass) {
+        off_t offset = 0;
+        while ((size_t)offset < file_size) {
+            ssize_t nmoved;
+            if (use_sendfile) {
+                nmoved = sendfile(fds[1], file_fd, &offset, file_size - offset);
+            } else {
+                ssize_t nread = pread(file_fd, buffer, sizeof(buffer), offset);
+                if (nread <= 0) {
+                    perror("pread");
+                    exit(1);
+                }
+                nmoved = 0;
+                while (nmoved < nread) {
+                    ssize_t nwritten = write(fds[1], buffer + nmoved, nread - nmoved);
+                    if (nwritten < 0) {
+                        perror("write");
+                        exit(1);
+                    }
+                    nmoved += nwritten;
+                }
+                offset += nmoved;
+            }
+            if (nmoved <= 0) {
+                perror("sendfile");
+                exit(1);
+            }
+        }
+    }
+    close(fds[1]);
+    waitpid(drain, nullptr, 0);
+    return now_us() - start;
+}
+
+int main()
+{
+    char path[] = "/tmp/sendfile-bench-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    unlink(path);
+
+    static char block[chunk_size];
+    memset(block, 'x', sizeof(block));
+    for (size_t written = 0; written < file_size; written += sizeof(block)) {
+        if (write(fd, block, sizeof(block)) != (ssize_t)sizeof(block)) {
+            perror("write");
+            return 1;
+        }
+    }
+
+    // one untimed pass of each so both start from a warm cache
+    run(fd, false);
+    run(fd, true);
+
+    double copy_us = run(fd, false);
+    double sendfile_us = run(fd, true);
+
+    double megabytes = (double)file_size * passes / (1024 * 1024);
+    printf("%zu MiB file -> pipe, %d passes\n", file_size / (1024 * 1024), passes);
+    printf("read+write  %10.1f MiB/s\n", megabytes / (copy_us / 1e6));
+    printf("sendfile    %10.1f MiB/s\n", megabytes / (sendfile_us / 1e6));
+    close(fd);
+    return 0;
+}
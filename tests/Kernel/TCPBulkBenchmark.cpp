@@ -0,0 +1,101 @@
+//
+//  TCPBulkBenchmark.cpp
+//  pranaOS
+//
+//  Created by Krisna Pranav on 27/09/23.
+//
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// bulk-sends over a loopback tcp connection with writes of increasing size while a
+// child drains the other end. Small writes pay for header construction and the send
+// path once per segment, large ones let the adapter cut many segments out of one call
+
+static constexpr size_t total_bytes = 256 * 1024 * 1024;
+static constexpr size_t write_sizes[] = { 1024, 16 * 1024, 256 * 1024, 1024 * 1024 };
+
+static double now_us()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void fail(const char* what)
+{
+    perror(what);
+    exit(1);
+}
+
+static double run(int listener, const sockaddr_in& address, size_t write_size)
+{
+    pid_t drain = fork();
+    if (drain < 0)
+        fail("fork");
+    if (drain == 0) {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0)
+            fail("accept");
+        static char sink[256 * 1024];
+        while (read(fd, sink, sizeof(sink)) > 0)
+            ;
+        _exit(0);
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        fail("socket");
+    if (connect(fd, (const sockaddr*)&address, sizeof(address)) < 0)
+        fail("connect");
+
+    auto* buffer = (char*)malloc(write_size);
+    memset(buffer, 'x', write_size);
+
+    double start = now_us();
+    for (size_t sent = 0; sent < total_bytes;) {
+        ssize_t nwritten = write(fd, buffer, write_size);
+        if (nwritten <= 0)
+            fail("write");
+        sent += nwritten;
+    }
+    close(fd);
+    waitpid(drain, nullptr, 0);
+    double elapsed_us = now_us() - start;
+
+    free(buffer);
+    return (double)total_bytes / (1024 * 1024) / (elapsed_us / 1e6);
+}
+
+int main()
+{
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0)
+        fail("socket");
+
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_port = 0;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listener, (const sockaddr*)&address, sizeof(address)) < 0)
+        fail("bind");
+    if (listen(listener, 1) < 0)
+        fail("listen");
+
+    socklen_t address_length = sizeof(address);
+    if (getsockname(listener, (sockaddr*)&address, &address_length) < 0)
+        fail("getsockname");
+
+    printf("%zu MiB over loopback tcp\n", total_bytes / (1024 * 1024));
+    printf("%-12s %12s\n", "write size", "MiB/s");
+    for (size_t write_size : write_sizes)
+        printf("%-12zu %12.1f\n", write_size, run(listener, address, write_size));
+    return 0;
+}
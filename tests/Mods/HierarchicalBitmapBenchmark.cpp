@@ -0,0 +1,83 @@
+//
+//  HierarchicalBitmapBenchmark.cpp
+//  pranaOS
+//
+//  Created by Krisna Pranav on 11/07/23.
+//
+
+#include <mods/bitmap.h>
+#include <mods/hierarchical_bitmap.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Heap-shaped occupancy: first-fit packs allocations at the low end, so the
+// used fraction is a dense prefix with the odd single-chunk hole punched by frees.
+static constexpr size_t chunk_size = 32;
+static constexpr size_t hole_stride = 4093;
+static constexpr int iterations = 200;
+
+static double now_us()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+template<typename BitmapType>
+static void fragment(BitmapType& bitmap, size_t used_chunks)
+{
+    bitmap.set_range(0, used_chunks, true);
+    for (size_t i = hole_stride; i < used_chunks; i += hole_stride)
+        bitmap.set(i, false);
+}
+
+template<typename BitmapType>
+static double time_first_fit(const BitmapType& bitmap, size_t length, size_t& result)
+{
+    double start = now_us();
+    for (int i = 0; i < iterations; ++i)
+        result = bitmap.find_first_fit(length).value();
+    return (now_us() - start) / iterations;
+}
+
+template<typename BitmapType>
+static double time_count(const BitmapType& bitmap, size_t& result)
+{
+    double start = now_us();
+    for (int i = 0; i < iterations; ++i)
+        result = bitmap.count_in_range(0, bitmap.size(), true);
+    return (now_us() - start) / iterations;
+}
+
+int main()
+{
+    printf("%8s %6s %14s %14s %8s %14s %14s %8s\n", "heap", "used", "flat fit us", "hier fit us", "speedup", "flat count us", "hier count us", "speedup");
+
+    for (size_t heap_mib = 1; heap_mib <= 256; heap_mib *= 4) {
+        size_t chunks = heap_mib * 1024 * 1024 / chunk_size;
+        for (int percent = 10; percent <= 90; percent += 20) {
+            size_t used_chunks = chunks * percent / 100;
+
+            auto flat = Bitmap::create(chunks, false);
+            auto hierarchical = HierarchicalBitmap::create(chunks, false);
+            fragment(flat, used_chunks);
+            fragment(hierarchical, used_chunks);
+
+            size_t flat_fit = 0, hierarchical_fit = 0, flat_count = 0, hierarchical_count = 0;
+            double flat_fit_us = time_first_fit(flat, 4, flat_fit);
+            double hierarchical_fit_us = time_first_fit(hierarchical, 4, hierarchical_fit);
+            double flat_count_us = time_count(flat, flat_count);
+            double hierarchical_count_us = time_count(hierarchical, hierarchical_count);
+
+            if (flat_fit != hierarchical_fit || flat_count != hierarchical_count) {
+                fprintf(stderr, "mismatch at %zu MiB / %d%%: fit %zu vs %zu, count %zu vs %zu\n", heap_mib, percent, flat_fit, hierarchical_fit, flat_count, hierarchical_count);
+                return 1;
+            }
+
+            printf("%5zuMiB %5d%% %14.2f %14.2f %7.1fx %14.2f %14.2f %7.1fx\n", heap_mib, percent, flat_fit_us, hierarchical_fit_us, flat_fit_us / hierarchical_fit_us, flat_count_us, hierarchical_count_us, flat_count_us / hierarchical_count_us);
+        }
+    }
+
+    return 0;
+}
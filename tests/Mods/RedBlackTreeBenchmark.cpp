@@ -0,0 +1,100 @@
+//
+//  RedBlackTreeBenchmark.cpp
+//  pranaOS
+//
+//  Created by Krisna Pranav on 15/09/23.
+//
+
+#include <mods/redblacktree.h>
+#include <mods/vector.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Region-shaped workload: n mappings of 1-16 pages with a guard page between
+// them, looked up by random addresses the way the page fault path does.
+static constexpr size_t page_size = 4096;
+static constexpr int lookups = 200000;
+
+struct FakeRegion {
+    FlatPtr base;
+    size_t size;
+
+    bool contains(FlatPtr address) const
+    {
+        return address >= base && address < base + size;
+    }
+};
+
+static double now_us()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static const FakeRegion* linear_find(const Vector<FakeRegion>& regions, FlatPtr address)
+{
+    for (auto& region : regions) {
+        if (region.contains(address))
+            return &region;
+    }
+    return nullptr;
+}
+
+static const FakeRegion* tree_find(const RedBlackTree<FlatPtr, FakeRegion>& regions, FlatPtr address)
+{
+    auto* region = regions.find_largest_not_above(address);
+    if (!region || !region->contains(address))
+        return nullptr;
+    return region;
+}
+
+int main()
+{
+    printf("regions   linear ns/lookup   tree ns/lookup   speedup\n");
+
+    for (size_t count = 16; count <= 16384; count *= 4) {
+        Vector<FakeRegion> vector;
+        RedBlackTree<FlatPtr, FakeRegion> tree;
+
+        srand(count);
+        FlatPtr next = 0x10000000;
+        for (size_t i = 0; i < count; ++i) {
+            FakeRegion region { next, (1 + rand() % 16) * page_size };
+            next += region.size + page_size;
+            vector.append(region);
+            tree.insert(region.base, FakeRegion(region));
+        }
+
+        Vector<FlatPtr> addresses;
+        for (int i = 0; i < lookups; ++i)
+            addresses.append(0x10000000 + (FlatPtr)rand() % (next - 0x10000000));
+
+        size_t linear_hits = 0;
+        double start = now_us();
+        for (auto address : addresses)
+            linear_hits += linear_find(vector, address) != nullptr;
+        double linear_ns = (now_us() - start) * 1000 / lookups;
+
+        size_t tree_hits = 0;
+        start = now_us();
+        for (auto address : addresses)
+            tree_hits += tree_find(tree, address) != nullptr;
+        double tree_ns = (now_us() - start) * 1000 / lookups;
+
+        for (int i = 0; i < lookups; i += 97) {
+            if (linear_find(vector, addresses[i]) != nullptr && tree_find(tree, addresses[i])->base != linear_find(vector, addresses[i])->base) {
+                printf("mismatch at %zx\n", (size_t)addresses[i]);
+                return 1;
+            }
+        }
+        if (linear_hits != tree_hits) {
+            printf("hit count mismatch: %zu vs %zu\n", linear_hits, tree_hits);
+            return 1;
+        }
+
+        printf("%7zu   %16.1f   %14.1f   %6.1fx\n", count, linear_ns, tree_ns, linear_ns / tree_ns);
+    }
+    return 0;
+}